@@ -24,6 +24,8 @@
 #include <seastar/core/future.hh>
 #include <seastar/core/shared_ptr.hh>
 #include <seastar/core/file.hh>
+#include <seastar/core/coroutine.hh>
+#include <seastar/core/gate.hh>
 #include <seastar/core/sleep.hh>
 #include <seastar/core/align.hh>
 #include <seastar/core/timer.hh>
@@ -35,7 +37,9 @@
 #include <seastar/core/io_intent.hh>
 #include <seastar/util/assert.hh>
 #include <seastar/util/later.hh>
+#include <algorithm>
 #include <chrono>
+#include <fstream>
 #include <optional>
 #include <ranges>
 #include <utility>
@@ -72,7 +76,7 @@ static auto random_seed = std::chrono::duration_cast<std::chrono::microseconds>(
 static thread_local std::default_random_engine random_generator(random_seed);
 
 class context;
-enum class request_type { seqread, overwrite, randread, randwrite, append, cpu, unlink };
+enum class request_type { seqread, overwrite, randread, randwrite, append, cpu, unlink, replay };
 
 namespace std {
 
@@ -234,6 +238,35 @@ struct options {
     std::optional<uint64_t> extent_allocation_size_hint;
     bool pre_allocate_blocks = false;
     std::optional<uint64_t> sloppy_size_hint;
+    // replay only: issue the next request when one completes instead of
+    // at the time it was recorded
+    bool closed_loop_replay = false;
+};
+
+// Requests recorded by the io_queue trace logging, see load_io_trace()
+struct io_trace {
+    struct priority_class {
+        unsigned id;
+        unsigned shares;
+        seastar::scheduling_group sg;
+    };
+
+    struct request {
+        // since the first request of the trace, on any shard
+        std::chrono::duration<double> ts;
+        uint64_t pos;
+        uint64_t len;
+        unsigned shard;
+        // index in classes
+        unsigned cls;
+        bool write;
+    };
+
+    std::vector<priority_class> classes;
+    std::vector<request> requests;
+    unsigned nr_shards = 0;
+    // end of the furthest request
+    uint64_t span = 0;
 };
 
 class class_data;
@@ -253,6 +286,9 @@ struct job_config {
     // remaining operations utilize only one file per shard
     std::optional<uint64_t> files_count;
     uint64_t offset_in_bdev;
+    // replay only
+    std::string trace_file;
+    std::shared_ptr<const io_trace> trace;
     std::unique_ptr<class_data> gen_class_data();
 };
 
@@ -390,7 +426,7 @@ class class_data {
     }
 
 public:
-    future<> issue_requests(std::chrono::steady_clock::time_point stop) {
+    virtual future<> issue_requests(std::chrono::steady_clock::time_point stop) {
         _start = std::chrono::steady_clock::now();
         return with_scheduling_group(_sg, [this, stop] {
             if (rps() == 0) {
@@ -451,6 +487,7 @@ class class_data {
             { request_type::append , "APPEND" },
             { request_type::cpu , "CPU" },
             { request_type::unlink, "UNLINK" },
+            { request_type::replay, "REPLAY" },
         }[_config.type];;
     }
 
@@ -533,10 +570,10 @@ class class_data {
 
 class io_class_data : public class_data {
     uint64_t _next_seq_pos = 0;
-    uint64_t _offset = 0;
     unsigned _overflows = 0;
     std::uniform_int_distribution<uint32_t> _pos_distribution;
 protected:
+    uint64_t _offset = 0;
     bool _is_dev_null = false;
     timer<> _queue_length_timer;
     accumulator_type _disk_queue_lengths;
@@ -743,6 +780,161 @@ class write_io_class_data : public io_class_data {
     }
 };
 
+// Replays this shard's part of an io trace against the job's file. Every
+// traced priority class is issued under a scheduling group of its own with
+// the traced shares, so the I/O scheduler sees the same mix of classes as
+// when the trace was recorded.
+//
+// open loop   : each request is issued at its recorded time, no matter how
+//               many requests are still in flight
+// closed loop : requests are issued in the recorded order, the next one
+//               when one of the `parallelism` in flight completes
+class replay_io_class_data : public io_class_data {
+    struct class_stats {
+        accumulator_type latencies = accumulator_type(extended_p_square_probabilities = quantiles);
+        uint64_t requests = 0;
+        uint64_t data = 0;
+    };
+
+    std::shared_ptr<const io_trace> _trace;
+    std::vector<const io_trace::request*> _replay;
+    std::vector<class_stats> _class_stats;
+    uint64_t _max_len = 0;
+    uint64_t _errors = 0;
+    // How late the open loop issued requests, in usec
+    accumulator_type _lag = accumulator_type(extended_p_square_probabilities = quantiles_short);
+
+public:
+    replay_io_class_data(job_config cfg)
+            : io_class_data(std::move(cfg))
+            , _trace(_config.trace)
+            , _class_stats(_trace->classes.size())
+    {
+        // A trace recorded on more shards than we run with folds the
+        // extra shards onto ours
+        for (auto& r : _trace->requests) {
+            if (r.shard % smp::count == this_shard_id()) {
+                _replay.push_back(&r);
+                _max_len = std::max(_max_len, r.len);
+            }
+        }
+    }
+
+    future<size_t> issue_request(char *buf, io_intent* intent) override {
+        return make_exception_future<size_t>(std::logic_error("replay jobs issue the traced requests"));
+    }
+
+    future<> issue_requests(std::chrono::steady_clock::time_point stop) override {
+        _start = std::chrono::steady_clock::now();
+        auto bufptr = allocate_aligned_buffer<char>(std::max(_max_len, _alignment), 4096);
+        if (_config.options.closed_loop_replay) {
+            co_await replay_closed_loop(bufptr.get(), stop);
+        } else {
+            co_await replay_open_loop(bufptr.get(), stop);
+        }
+        _total_duration = std::chrono::steady_clock::now() - _start;
+    }
+
+private:
+    uint64_t replay_pos(const io_trace::request& r) const {
+        uint64_t pos = r.pos;
+        if (pos + r.len > _config.file_size) {
+            // data_size was set smaller than the traced area
+            pos = align_down<uint64_t>(pos % (_config.file_size - std::min(r.len, _config.file_size) + 1), 4096);
+        }
+        return pos + _offset;
+    }
+
+    future<> replay_one(const io_trace::request& r, char* buf, std::chrono::steady_clock::time_point stop) {
+        auto start = std::chrono::steady_clock::now();
+        return with_scheduling_group(_trace->classes[r.cls].sg, [this, &r, buf] {
+            auto pos = replay_pos(r);
+            return r.write ? _file.dma_write(pos, buf, r.len) : _file.dma_read(pos, buf, r.len);
+        }).then([this, &r, start, stop] (size_t) {
+            auto now = std::chrono::steady_clock::now();
+            if (now < stop) {
+                auto latency = std::chrono::duration_cast<std::chrono::microseconds>(now - start);
+                add_result(r.len, latency);
+                auto& cs = _class_stats[r.cls];
+                cs.latencies(latency.count());
+                cs.requests++;
+                cs.data += r.len;
+            }
+        }).handle_exception([this] (std::exception_ptr) {
+            _errors++;
+        });
+    }
+
+    future<> replay_open_loop(char* buf, std::chrono::steady_clock::time_point stop) {
+        gate g;
+        for (auto* r : _replay) {
+            auto due = _start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(r->ts);
+            if (due > stop) {
+                break;
+            }
+            auto now = std::chrono::steady_clock::now();
+            if (due > now) {
+                co_await _sleep_fn(due, now);
+                now = std::chrono::steady_clock::now();
+            }
+            _lag(std::chrono::duration_cast<std::chrono::microseconds>(now - due).count());
+            (void)with_gate(g, [this, r, buf, stop] {
+                return replay_one(*r, buf, stop);
+            });
+        }
+        co_await g.close();
+    }
+
+    future<> replay_closed_loop(char* buf, std::chrono::steady_clock::time_point stop) {
+        size_t next = 0;
+        co_await parallel_for_each(std::views::iota(0u, std::max(parallelism(), 1u)), [this, buf, stop, &next] (unsigned) {
+            return do_until([this, stop, &next] { return next >= _replay.size() || std::chrono::steady_clock::now() > stop; }, [this, buf, stop, &next] {
+                return replay_one(*_replay[next++], buf, stop);
+            });
+        });
+    }
+
+public:
+    virtual void emit_results(YAML::Emitter& out) override {
+        io_class_data::emit_results(out);
+        out << YAML::Key << "replay" << YAML::BeginMap;
+        out << YAML::Key << "mode" << YAML::Value << (_config.options.closed_loop_replay ? "closed" : "open");
+        out << YAML::Key << "traced_requests" << YAML::Value << _replay.size();
+        out << YAML::Key << "errors" << YAML::Value << _errors;
+        if (!_config.options.closed_loop_replay && boost::accumulators::count(_lag)) {
+            out << YAML::Key << "lag" << YAML::Comment("usec");
+            out << YAML::BeginMap;
+            for (auto& q: quantiles_short) {
+                out << YAML::Key << fmt::format("p{}", q) << YAML::Value << (uint64_t)quantile(_lag, quantile_probability = q);
+            }
+            out << YAML::Key << "max" << YAML::Value << (uint64_t)max(_lag);
+            out << YAML::EndMap;
+        }
+        out << YAML::Key << "classes" << YAML::BeginMap;
+        for (unsigned i = 0; i < _class_stats.size(); i++) {
+            auto& cs = _class_stats[i];
+            if (!cs.requests) {
+                continue;
+            }
+            out << YAML::Key << _trace->classes[i].id << YAML::BeginMap;
+            out << YAML::Key << "shares" << YAML::Value << _trace->classes[i].shares;
+            out << YAML::Key << "throughput" << YAML::Value << (cs.data >> 10) / total_duration().count() << YAML::Comment("kB/s");
+            out << YAML::Key << "IOPS" << YAML::Value << cs.requests / total_duration().count();
+            out << YAML::Key << "latencies" << YAML::Comment("usec");
+            out << YAML::BeginMap;
+            out << YAML::Key << "average" << YAML::Value << (uint64_t)mean(cs.latencies);
+            for (auto& q: quantiles) {
+                out << YAML::Key << fmt::format("p{}", q) << YAML::Value << (uint64_t)quantile(cs.latencies, quantile_probability = q);
+            }
+            out << YAML::Key << "max" << YAML::Value << (uint64_t)max(cs.latencies);
+            out << YAML::EndMap;
+            out << YAML::EndMap;
+        }
+        out << YAML::EndMap;
+        out << YAML::EndMap;
+    }
+};
+
 class unlink_class_data : public class_data {
 private:
     sstring _dir_path{};
@@ -870,6 +1062,8 @@ std::unique_ptr<class_data> job_config::gen_class_data() {
         return std::make_unique<cpu_class_data>(*this);
     } else if (type == request_type::unlink) {
         return std::make_unique<unlink_class_data>(*this);
+    } else if (type == request_type::replay) {
+        return std::make_unique<replay_io_class_data>(*this);
     } else if ((type == request_type::seqread) || (type == request_type::randread)) {
         return std::make_unique<read_io_class_data>(*this);
     } else {
@@ -952,6 +1146,7 @@ struct convert<request_type> {
             { "append", request_type::append},
             { "cpu", request_type::cpu},
             { "unlink", request_type::unlink },
+            { "replay", request_type::replay },
         };
         auto reqstr = node.as<std::string>();
         if (!mappings.count(reqstr)) {
@@ -1041,6 +1236,16 @@ struct convert<options> {
         if (node["fallocate"]) {
             op.pre_allocate_blocks = node["fallocate"].as<bool>();
         }
+        if (node["replay"]) {
+            auto mode = node["replay"].as<std::string>();
+            if (mode == "open") {
+                op.closed_loop_replay = false;
+            } else if (mode == "closed") {
+                op.closed_loop_replay = true;
+            } else {
+                throw std::runtime_error(seastar::format("Unknown replay mode {}", mode));
+            }
+        }
 
         return true;
     }
@@ -1060,6 +1265,8 @@ struct convert<job_config> {
             cl.file_size = align_up<uint64_t>(per_shard_bytes, extent_size_hint_alignment);
         } else if (cl.type == request_type::append) {
             cl.file_size = 0;
+        } else if (cl.type == request_type::replay) {
+            cl.file_size = 0; // sized after the trace once it's loaded
         } else {
             cl.file_size = 1ull << 30; // 1G by default
         }
@@ -1071,6 +1278,12 @@ struct convert<job_config> {
             cl.files_count = node["files_count"].as<uint64_t>();
         }
 
+        if (node["trace"]) {
+            cl.trace_file = node["trace"].as<std::string>();
+        } else if (cl.type == request_type::replay) {
+            throw std::runtime_error(seastar::format("Replay job {} requires specifying 'trace'", cl.name));
+        }
+
         if (node["shard_info"]) {
             cl.shard_info = node["shard_info"].as<shard_info>();
         }
@@ -1171,6 +1384,80 @@ static void show_results(sharded<context>& ctx) {
     std::cout << out.c_str();
 }
 
+// Loads the requests queued in an io_queue trace, i.e. the output of an
+// application run with --logger-log-level io=trace --logger-ts-style boot.
+// The lines of interest look like
+//
+//   TRACE  12.345678 [shard 0:main] io - dev 0 : req 0x6000002e0c00 queue  len 4096 capacity 12 dir read class 2 shares 200 pos 1048576
+//
+// Lines of other kinds, as well as queue lines of older versions that lack
+// the fields after the capacity, are skipped.
+static std::shared_ptr<io_trace> load_io_trace(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error(format("Cannot open trace {}", path));
+    }
+
+    auto trace = std::make_shared<io_trace>();
+    std::optional<double> first_ts;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::vector<std::string> tok;
+        boost::trim(line);
+        boost::split(tok, line, boost::is_space(), boost::token_compress_on);
+        if (tok.empty() || tok[0] != "TRACE") {
+            continue;
+        }
+        // The scheduling group name is padded and may split into two tokens
+        auto shard = std::find(tok.begin(), tok.end(), "[shard");
+        auto queue = std::find(tok.begin(), tok.end(), "queue");
+        auto i = shard - tok.begin();
+        auto q = queue - tok.begin();
+        if (shard == tok.end() || queue == tok.end() || i < 2 || q < i + 8 || tok[q - 7] != "io" || tok[q - 2] != "req") {
+            continue;
+        }
+
+        std::unordered_map<std::string, std::string> fields;
+        for (auto k = q + 1; k + 1 < ssize_t(tok.size()); k += 2) {
+            fields[tok[k]] = tok[k + 1];
+        }
+        if (!fields.contains("dir") || !fields.contains("class") || !fields.contains("shares") || !fields.contains("pos") || !fields.contains("len")) {
+            continue;
+        }
+
+        auto& ts_str = tok[i - 1];
+        if (ts_str.find(':') != std::string::npos || ts_str.find('.') == std::string::npos) {
+            throw std::runtime_error(format("Trace {} must be recorded with --logger-ts-style boot", path));
+        }
+        auto ts = std::stod(ts_str);
+        if (!first_ts) {
+            first_ts = ts;
+        }
+
+        io_trace::request r;
+        r.ts = std::chrono::duration<double>(std::max(ts - *first_ts, 0.0));
+        r.shard = std::stoul(tok[i + 1]);
+        r.pos = std::stoull(fields["pos"]);
+        r.len = std::stoull(fields["len"]);
+        r.write = fields["dir"] == "write";
+
+        unsigned id = std::stoul(fields["class"]);
+        auto cls = std::find_if(trace->classes.begin(), trace->classes.end(), [id] (auto& c) { return c.id == id; });
+        if (cls == trace->classes.end()) {
+            cls = trace->classes.insert(cls, io_trace::priority_class{ .id = id, .shares = unsigned(std::stoul(fields["shares"])) });
+        }
+        r.cls = cls - trace->classes.begin();
+
+        trace->nr_shards = std::max(trace->nr_shards, r.shard + 1);
+        trace->span = std::max(trace->span, r.pos + r.len);
+        trace->requests.push_back(r);
+    }
+
+    // Shards log independently, so their lines may interleave out of order
+    std::stable_sort(trace->requests.begin(), trace->requests.end(), [] (auto& a, auto& b) { return a.ts < b.ts; });
+    return trace;
+}
+
 int main(int ac, char** av) {
     namespace bpo = boost::program_options;
 
@@ -1264,8 +1551,27 @@ int main(int ac, char** av) {
                 }).get();
             }
 
+            for (job_config& r : reqs) {
+                if (r.type != request_type::replay) {
+                    continue;
+                }
+
+                auto trace = load_io_trace(r.trace_file);
+                if (trace->requests.empty()) {
+                    throw std::runtime_error(format("No requests to replay in {}", r.trace_file));
+                }
+                fmt::print("Job {} replays {} requests of {} classes from {} shards\n", r.name, trace->requests.size(), trace->classes.size(), trace->nr_shards);
+                for (auto& c : trace->classes) {
+                    c.sg = seastar::create_scheduling_group(format("{}.{}", r.name, c.id), c.shares).get();
+                }
+                if (r.file_size == 0) {
+                    r.file_size = align_up<uint64_t>(trace->span, extent_size_hint_alignment);
+                }
+                r.trace = std::move(trace);
+            }
+
             parallel_for_each(reqs, [&sched_classes] (auto& r) {
-                if (r.shard_info.sched_class != "") {
+                if (r.shard_info.sched_class != "" || r.type == request_type::replay) {
                     return make_ready_future<>();
                 }
 
@@ -1278,6 +1584,9 @@ int main(int ac, char** av) {
             }).get();
 
             for (job_config& r : reqs) {
+                if (r.type == request_type::replay) {
+                    continue;
+                }
                 auto cname = r.shard_info.sched_class != "" ? r.shard_info.sched_class : r.name;
                 fmt::print("Job {} -> sched class {}\n", r.name, cname);
                 auto& sc = sched_classes.at(cname);
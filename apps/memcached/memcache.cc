@@ -1269,15 +1269,18 @@ class udp_server {
         {}
 
         future<> respond(udp_channel& chan) {
+            std::vector<outgoing_datagram> batch;
+            batch.reserve(_out_bufs.size());
             int i = 0;
-            return do_for_each(_out_bufs.begin(), _out_bufs.end(), [this, i, &chan] (packet& p) mutable {
+            for (packet& p : _out_bufs) {
                 header* out_hdr = p.prepend_header<header>(0);
                 out_hdr->_request_id = _request_id;
                 out_hdr->_sequence_number = i++;
                 out_hdr->_n = _out_bufs.size();
                 *out_hdr = hton(*out_hdr);
-                return chan.send(_src, std::move(p));
-            });
+                batch.push_back({_src, std::move(p)});
+            }
+            return chan.send_batch(std::move(batch));
         }
     };
 
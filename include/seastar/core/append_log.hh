@@ -0,0 +1,111 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2026 ScyllaDB
+ */
+
+#pragma once
+
+#ifndef SEASTAR_MODULE
+#include <seastar/core/file.hh>
+#include <seastar/core/future.hh>
+#include <seastar/core/temporary_buffer.hh>
+#include <seastar/util/modules.hh>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#endif
+
+namespace seastar {
+
+/// \addtogroup fileio-module
+/// @{
+
+/// Options for \ref make_append_log()
+SEASTAR_MODULE_EXPORT
+struct append_log_options {
+    /// Upper bound on the records packed into one write. A record larger
+    /// than that is written in a group of its own
+    size_t max_group_size = 1 << 20;
+    /// Upper bound on the bytes of records appended but not yet durable.
+    /// append() waits when it's exceeded
+    size_t max_pending_bytes = 4 << 20;
+    /// Extents are allocated in chunks of that size ahead of the writes.
+    /// Zero disables preallocation
+    uint64_t preallocation_size = 32 << 20;
+};
+
+/// Append-only file with group commit
+///
+/// Records appended by any number of fibers are packed back to back into
+/// DMA-aligned buffers. Each group of records is written with a single
+/// write followed by a single \ref file::flush() "flush()". Records that
+/// arrive while a group is being committed form the next group, so the
+/// group size grows with the sync latency instead of a fixed timer.
+///
+/// The log adds no framing, records are laid out exactly as appended.
+/// Until the log is closed the file may extend past the last record with
+/// zero padding up to the write alignment; close() truncates it to the
+/// logical size.
+///
+/// If a write or a flush fails, the records of the group and all the
+/// following ones fail with the same error, as the on-disk state is no
+/// longer known.
+SEASTAR_MODULE_EXPORT
+class append_log {
+public:
+    class impl;
+private:
+    std::unique_ptr<impl> _impl;
+    explicit append_log(std::unique_ptr<impl> impl) noexcept;
+    friend append_log make_append_log(file f, uint64_t size, append_log_options options);
+public:
+    append_log(append_log&&) noexcept;
+    append_log& operator=(append_log&&) noexcept;
+    ~append_log();
+
+    /// Appends a record
+    ///
+    /// \returns the offset of the record in the file, once the record and
+    ///          all those appended before it are durable
+    future<uint64_t> append(temporary_buffer<char> record);
+    /// \overload
+    future<uint64_t> append(std::string_view record);
+
+    /// Size of the log, including the records that are not yet durable
+    uint64_t size() const noexcept;
+    /// Size of the prefix of the log that is durable
+    uint64_t durable_size() const noexcept;
+
+    /// Waits for the records appended so far, truncates the file to the
+    /// log size and closes it
+    future<> close() noexcept;
+};
+
+/// Makes an append log over a file
+///
+/// \param f the file to append to, opened for writing with DMA
+/// \param size the size of the log data already in the file; new records
+///             are appended after it
+/// \param options the options controlling batching and preallocation
+SEASTAR_MODULE_EXPORT
+append_log make_append_log(file f, uint64_t size = 0, append_log_options options = {});
+
+/// @}
+
+}
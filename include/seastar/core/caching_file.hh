@@ -0,0 +1,107 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2026 ScyllaDB
+ */
+
+#pragma once
+
+#ifndef SEASTAR_MODULE
+#include <seastar/core/file.hh>
+#include <seastar/core/sstring.hh>
+#include <seastar/util/modules.hh>
+#include <cstdint>
+#include <memory>
+#endif
+
+namespace seastar {
+
+/// \addtogroup fileio-module
+/// @{
+
+/// Shard-local cache of file blocks, see \ref make_caching_file()
+///
+/// All files made caching with the same cache share its capacity. When
+/// it's exceeded, or when the shard runs low on memory, the least recently
+/// used blocks are evicted. Blocks are allocated from the seastar memory
+/// like any other buffer, so they count against the shard's memory.
+///
+/// The cache must outlive the files that use it.
+SEASTAR_MODULE_EXPORT
+class file_block_cache {
+public:
+    struct config {
+        /// Size of the cached blocks. Must be a multiple of the read
+        /// alignment of the files used with the cache, \ref make_caching_file()
+        /// throws std::invalid_argument otherwise
+        size_t block_size = 16 << 10;
+        /// Upper bound on the memory held by cached blocks
+        size_t max_size = 64 << 20;
+        /// Value of the "cache" label of the cache metrics. If empty,
+        /// no metrics are registered
+        sstring metrics_name = "";
+    };
+
+    struct stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        /// Misses served by a read already in flight for the same block
+        uint64_t coalesced_misses = 0;
+        uint64_t evictions = 0;
+    };
+
+    class impl;
+private:
+    std::unique_ptr<impl> _impl;
+    friend file make_caching_file(file f, file_block_cache& cache);
+public:
+    file_block_cache();
+    explicit file_block_cache(config cfg);
+    file_block_cache(file_block_cache&&) noexcept;
+    ~file_block_cache();
+
+    /// Memory held by cached blocks, in bytes
+    size_t memory_used() const noexcept;
+    stats get_stats() const noexcept;
+    /// Drops all cached blocks
+    void clear() noexcept;
+};
+
+/// Wraps a file so that reads are served from a block cache
+///
+/// Reads are split into cache blocks, blocks that are not cached are read
+/// from the underlying file and inserted into the cache, and concurrent
+/// reads of the same missing block wait for a single underlying read.
+/// dma_read_bulk() of a range within one block is copied out of the
+/// cached block, so that the caller may write to the buffer it gets.
+///
+/// Writes, truncation and discards go to the underlying file and drop the
+/// affected blocks. Reads don't have to be aligned, but writes are subject
+/// to the underlying file's alignment rules as usual.
+///
+/// Block reads are shared between callers, so they are not tied to any
+/// caller's \ref io_intent.
+///
+/// \param f the file to cache
+/// \param cache the shard-local cache to use; it must outlive the returned file
+SEASTAR_MODULE_EXPORT
+file make_caching_file(file f, file_block_cache& cache);
+
+/// @}
+
+}
@@ -58,6 +58,10 @@ class disk_config_params {
     std::chrono::duration<double> _latency_goal;
     std::chrono::milliseconds _stall_threshold;
     double _flow_ratio_backpressure_threshold;
+    bool _adaptive_cost_model = false;
+    bool _calendar_class_selection = false;
+    bool _capacity_lending = false;
+    bool _merge_reads = false;
 
 public:
     explicit disk_config_params(unsigned max_queues) noexcept
@@ -28,6 +28,7 @@
 #include <seastar/core/metrics_registration.hh>
 #include <seastar/util/assert.hh>
 
+#include <array>
 #include <chrono>
 #include <cstdint>
 #include <functional>
@@ -112,11 +113,13 @@ class fair_queue_entry {
     // a 'normalized' form -- converted from floating-point to fixed-point number
     // and scaled accrding to fair-group's token-bucket duration
     using capacity_t = uint64_t;
+    using clock_type = std::chrono::steady_clock;
     friend class fair_queue;
 
 private:
     capacity_t _capacity;
     bi::slist_member_hook<> _hook;
+    clock_type::time_point _deadline = clock_type::time_point::max();
 
 public:
     explicit fair_queue_entry(capacity_t c) noexcept
@@ -127,6 +130,12 @@ class fair_queue_entry {
             bi::member_hook<fair_queue_entry, bi::slist_member_hook<>, &fair_queue_entry::_hook>>;
 
     capacity_t capacity() const noexcept { return _capacity; }
+
+    // Entries with a deadline are queued ahead of the ones of the same class
+    // with a later one or none. Must be set before the entry is queued.
+    void set_deadline(clock_type::time_point d) noexcept { _deadline = d; }
+    clock_type::time_point deadline() const noexcept { return _deadline; }
+    bool has_deadline() const noexcept { return _deadline != clock_type::time_point::max(); }
 };
 
 /// \brief Fair queuing class
@@ -148,6 +157,11 @@ class fair_queue_entry {
 /// When the classes that lag behind start seeing requests, the fair queue will serve
 /// them first, until balance is restored. This balancing is expected to happen within
 /// a certain time window that obeys an exponential decay.
+///
+/// Picking the next class to serve costs O(log n) in the number of active classes
+/// by default. With \ref config::class_selection set to \c calendar it's O(1), at
+/// the price of serving classes whose costs differ by less than the calendar
+/// resolution in round-robin order instead of strictly by cost.
 class fair_queue {
 public:
     /// \brief Fair Queue configuration structure.
@@ -155,8 +169,14 @@ class fair_queue {
     /// \sets the operation parameters of a \ref fair_queue
     /// \related fair_queue
     struct config {
+        enum class class_selection { heap, calendar };
+
         sstring label = "";
         uint64_t forgiving_factor = 0;
+        class_selection selection = class_selection::heap;
+        /// For the calendar selection, classes whose accumulated costs fall
+        /// into the same 2^calendar_resolution_shift range are equal
+        unsigned calendar_resolution_shift = 6;
     };
 
     using class_id = unsigned int;
@@ -175,6 +195,7 @@ class fair_queue {
         bool _queued = false;
         uint32_t _activations = 0;
         priority_class_group_data* _parent = nullptr;
+        bi::slist_member_hook<> _calendar_hook;
         priority_entry(uint32_t shares, priority_class_group_data* p) noexcept
                 : _shares(std::max(shares, 1u))
                 , _parent(p)
@@ -207,15 +228,88 @@ class fair_queue {
         }
     };
 
+    // Timing wheel of active entries keyed by accumulated cost. Each bucket
+    // holds the entries of one resolution unit, the wheel covers nr_buckets
+    // units starting from _base, which moves forward as entries are served.
+    // Entries that don't fit the window are parked in its last bucket and
+    // re-inserted when the wheel gets there.
+    class calendar_queue {
+    public:
+        static constexpr unsigned nr_buckets = 256;
+    private:
+        using bucket_t = bi::slist<priority_entry,
+                bi::constant_time_size<false>,
+                bi::cache_last<true>,
+                bi::member_hook<priority_entry, bi::slist_member_hook<>, &priority_entry::_calendar_hook>>;
+        std::array<bucket_t, nr_buckets> _buckets;
+        std::array<uint32_t, nr_buckets> _sizes = {};
+        std::array<uint64_t, nr_buckets / 64> _nonempty = {};
+        capacity_t _base = 0;
+        size_t _size = 0;
+        const unsigned _shift;
+
+        capacity_t key(const priority_entry& e) const noexcept { return e._accumulated >> _shift; }
+        unsigned bucket(capacity_t key) const noexcept { return key % nr_buckets; }
+        unsigned first_nonempty() const noexcept;
+        void insert(unsigned idx, priority_entry& e, bool front) noexcept;
+        void place(priority_entry& e) noexcept;
+        priority_entry& remove_front(unsigned idx) noexcept;
+    public:
+        explicit calendar_queue(unsigned resolution_shift) noexcept : _shift(resolution_shift) {}
+        bool empty() const noexcept { return _size == 0; }
+        priority_entry_ptr top() noexcept;
+        void pop() noexcept;
+        void push(priority_entry_ptr e) noexcept;
+    };
+
+    class children_queue {
+        priority_queue _heap;
+        std::unique_ptr<calendar_queue> _calendar;
+    public:
+        explicit children_queue(const config& cfg);
+
+        bool empty() const noexcept {
+            return _calendar ? _calendar->empty() : _heap.empty();
+        }
+        priority_entry_ptr top() noexcept {
+            return _calendar ? _calendar->top() : _heap.top();
+        }
+        void pop() noexcept {
+            if (_calendar) {
+                _calendar->pop();
+            } else {
+                _heap.pop();
+            }
+        }
+        void push(priority_entry_ptr e) noexcept {
+            if (_calendar) {
+                _calendar->push(e);
+            } else {
+                _heap.push(e);
+            }
+        }
+        void reserve(size_t len) {
+            if (!_calendar) {
+                _heap.reserve(len);
+            }
+        }
+        void assert_enough_capacity() const noexcept {
+            if (!_calendar) {
+                _heap.assert_enough_capacity();
+            }
+        }
+    };
+
     class priority_class_group_data final : public priority_entry {
         friend class fair_queue;
         friend testing::fair_queue_test;
-        priority_queue _children;
+        children_queue _children;
         capacity_t _last_accumulated = 0;
         size_t _nr_children = 0;
     public:
-        priority_class_group_data(uint32_t shares, priority_class_group_data* p) noexcept
+        priority_class_group_data(uint32_t shares, priority_class_group_data* p, const config& cfg)
                 : priority_entry(shares, p)
+                , _children(cfg)
         {
             if (_parent == nullptr) {
                 _queued = true;
@@ -283,6 +377,9 @@ class fair_queue {
 
     /// Queue the entry \c ent through this class' \ref fair_queue
     ///
+    /// Entries of a class are dispatched in the order they are queued, except that
+    /// ones with a deadline go ahead of ones with a later deadline or without one.
+    ///
     /// The user of this interface is supposed to call \ref notify_requests_finished when the
     /// request finishes executing - regardless of success or failure.
     void queue(class_id c, fair_queue_entry& ent) noexcept;
@@ -295,6 +392,10 @@ class fair_queue {
     void notify_request_finished(fair_queue_entry::capacity_t cap) noexcept;
     void notify_request_cancelled(fair_queue_entry& ent) noexcept;
 
+    /// Changes the capacity of a request that's still queued, e.g. when it
+    /// absorbs another one
+    void update_capacity(fair_queue_entry& ent, capacity_t cap) noexcept;
+
     fair_queue_entry* top();
     void pop_front();
 
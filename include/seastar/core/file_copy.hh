@@ -0,0 +1,79 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2026 ScyllaDB
+ */
+
+#pragma once
+
+#ifndef SEASTAR_MODULE
+#include <seastar/core/file.hh>
+#include <seastar/core/future.hh>
+#include <seastar/core/scheduling.hh>
+#include <seastar/util/modules.hh>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#endif
+
+namespace seastar {
+
+/// \addtogroup fileio-module
+/// @{
+
+/// Options for \ref copy_file_contents() and \ref checksum_file()
+SEASTAR_MODULE_EXPORT
+struct file_copy_options {
+    /// Size of the chunks read and written, rounded up to the files' DMA alignment
+    size_t chunk_size = 1 << 20;
+    /// Number of chunks in flight
+    unsigned concurrency = 4;
+    /// Group to run the I/O under. Defaults to the caller's group
+    std::optional<scheduling_group> sched_group;
+    /// Let copy_file_contents() ask the kernel to copy the data, which
+    /// avoids moving it through memory and may share the extents between
+    /// the files (reflink) on filesystems that support it. The kernel copy
+    /// runs as blocking syscalls on the reactor's syscall thread, one at a
+    /// time, and bypasses the IO scheduler, so it is not subject to the
+    /// bandwidth and shares of \c sched_group
+    bool kernel_copy = false;
+    /// Called with the number of bytes processed so far and the total
+    std::function<void (uint64_t done, uint64_t total)> progress;
+};
+
+/// Copies the contents of a file into another one
+///
+/// \c out is overwritten from offset zero, truncated to the size of \c in
+/// and flushed. \c in is read and \c out is written through the IO scheduler
+/// in aligned chunks with several of them in flight, unless
+/// \ref file_copy_options::kernel_copy asks the kernel to copy the data.
+///
+/// \returns the number of bytes copied
+SEASTAR_MODULE_EXPORT
+future<uint64_t> copy_file_contents(file in, file out, file_copy_options options = {});
+
+/// Computes the CRC32C of the contents of a file
+///
+/// The file is read in aligned chunks with several of them in flight, and
+/// the chunks are folded into the checksum in order.
+SEASTAR_MODULE_EXPORT
+future<uint32_t> checksum_file(file in, file_copy_options options = {});
+
+/// @}
+
+}
@@ -61,6 +61,13 @@ struct file_input_stream_options {
     size_t buffer_size = 8192;    ///< I/O buffer size
     unsigned read_ahead = 0;      ///< Maximum number of extra read-ahead operations
     lw_shared_ptr<file_input_stream_history> dynamic_adjustments = { }; ///< Input stream history, if null dynamic adjustments are disabled
+    /// Adapt the read-ahead to the access pattern, with \c read_ahead as the upper bound.
+    ///
+    /// Sequential reads get a window sized from the consumer rate and the
+    /// observed I/O latency, strided reads (fixed-size records separated by
+    /// fixed-size skips) only read the records, and random reads are not read
+    /// ahead. Read-ahead dropped by a skip is cancelled if still queued.
+    bool adaptive_read_ahead = false;
 };
 
 /// \brief Creates an input_stream to read a portion of a file.
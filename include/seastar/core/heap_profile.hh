@@ -0,0 +1,67 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2026 ScyllaDB
+ */
+
+#pragma once
+
+#ifndef SEASTAR_MODULE
+#include <seastar/http/httpd.hh>
+#include <seastar/core/iostream.hh>
+#include <seastar/core/memory.hh>
+#include <seastar/core/sharded.hh>
+#include <seastar/util/modules.hh>
+#include <vector>
+#endif
+
+namespace seastar {
+
+namespace heap_profile {
+
+SEASTAR_MODULE_EXPORT_BEGIN
+
+/*!
+ * Holds heap profile endpoint configuration
+ */
+struct config {
+    sstring path = "/debug/pprof/heap"; //!< URL path the profile is served on
+};
+
+/// Writes allocation sites, e.g. from \ref memory::sampled_memory_profile(),
+/// in the legacy heap profile format that `pprof` reads.
+///
+/// Each site is reported with its live objects and bytes, followed by the
+/// memory map of the process which pprof needs to symbolize the addresses.
+future<> write_pprof(const std::vector<memory::allocation_site>& sites, output_stream<char>& out);
+
+/// \defgroup add_heap_profile_routes adds an endpoint that returns the sampled
+///    heap profile in pprof format
+///
+/// The profile only holds data while heap profiling is on, see
+/// \ref memory::set_heap_profiling_sampling_rate(). It covers all shards,
+/// unless the `shard` query parameter selects one, and all scheduling
+/// groups, unless the `group` query parameter names one.
+/// @{
+future<> add_heap_profile_routes(sharded<httpd::http_server>& server, config ctx = {});
+future<> add_heap_profile_routes(httpd::http_server& server, config ctx = {});
+/// @}
+
+SEASTAR_MODULE_EXPORT_END
+}
+}
@@ -94,6 +94,7 @@ class pollable_fd_state {
     int events_requested = 0; // wanted by pollin/pollout promises
     int events_epoll = 0;     // installed in epoll
     int events_known = 0;     // returned from epoll
+    bool no_zerocopy_send = false; // the socket refused a zero-copy send (kTLS sockets do)
 
     friend class reactor;
     friend class pollable_fd;
@@ -115,6 +116,8 @@ class pollable_fd_state {
     future<temporary_buffer<char>> recv_some(internal::buffer_allocator* ba);
     future<size_t> sendmsg(struct msghdr *msg);
     future<size_t> recvmsg(struct msghdr *msg);
+    future<size_t> sendmmsg(struct mmsghdr* msgs, size_t n);
+    future<size_t> recvmmsg(struct mmsghdr* msgs, size_t n);
     future<size_t> sendto(socket_address addr, const void* buf, size_t len);
     future<> poll_rdhup();
     void shutdown(int how);
@@ -188,6 +191,12 @@ class pollable_fd {
     future<size_t> recvmsg(struct msghdr *msg) {
         return _s->recvmsg(msg);
     }
+    future<size_t> sendmmsg(struct mmsghdr* msgs, size_t n) {
+        return _s->sendmmsg(msgs, n);
+    }
+    future<size_t> recvmmsg(struct mmsghdr* msgs, size_t n) {
+        return _s->recvmmsg(msgs, n);
+    }
     future<size_t> sendto(socket_address addr, const void* buf, size_t len) {
         return _s->sendto(addr, buf, len);
     }
@@ -0,0 +1,149 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2026 ScyllaDB
+ */
+
+#pragma once
+
+#include <seastar/core/bitops.hh>
+#include <seastar/core/cacheline.hh>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+namespace seastar::internal {
+
+/// Bounded single-producer, single-consumer ring of trivially copyable items.
+///
+/// The producer and consumer indexes live on separate cache lines, and each
+/// side keeps a private copy of the other side's index which it only
+/// refreshes when the ring looks full (producer) or empty (consumer). So in
+/// the common case pushing or popping a batch touches no line written by the
+/// other side except for the slots themselves.
+///
+/// The capacity is rounded up to a power of two.
+template <typename T>
+requires std::is_trivially_copyable_v<T>
+class spsc_ring {
+    struct alignas(seastar::cache_line_size) producer_side {
+        std::atomic<size_t> tail = 0;
+        size_t cached_head = 0;
+    };
+    struct alignas(seastar::cache_line_size) consumer_side {
+        std::atomic<size_t> head = 0;
+        size_t cached_tail = 0;
+    };
+    producer_side _producer;
+    consumer_side _consumer;
+    size_t _mask;
+    std::unique_ptr<T[]> _slots;
+public:
+    explicit spsc_ring(size_t capacity)
+        : _mask((size_t(1) << log2ceil(std::max<size_t>(capacity, 2))) - 1)
+        , _slots(std::make_unique<T[]>(_mask + 1))
+    {}
+
+    size_t capacity() const noexcept {
+        return _mask + 1;
+    }
+
+    /// Pushes items from [begin, end) until the ring is full.
+    ///
+    /// Producer side only.
+    /// \returns an iterator past the last item pushed.
+    template <typename Iterator>
+    Iterator push(Iterator begin, Iterator end) noexcept {
+        auto tail = _producer.tail.load(std::memory_order_relaxed);
+        size_t want = std::distance(begin, end);
+        if (tail + want - _producer.cached_head > capacity()) {
+            _producer.cached_head = _consumer.head.load(std::memory_order_acquire);
+        }
+        auto n = std::min(want, capacity() - (tail - _producer.cached_head));
+        for (size_t i = 0; i < n; ++i) {
+            _slots[(tail + i) & _mask] = *begin++;
+        }
+        if (n) {
+            _producer.tail.store(tail + n, std::memory_order_release);
+        }
+        return begin;
+    }
+
+    /// Producer side only.
+    bool push(const T& item) noexcept {
+        return push(&item, &item + 1) != &item;
+    }
+
+    /// Checks whether the consumer has popped everything pushed so far.
+    ///
+    /// Producer side only. Unlike push(), this always reads the consumer's
+    /// index, so it costs a cache miss if the consumer has moved on.
+    bool drained() const noexcept {
+        return _consumer.head.load(std::memory_order_relaxed) == _producer.tail.load(std::memory_order_relaxed);
+    }
+
+    /// Pops up to \c max items into \c out.
+    ///
+    /// Consumer side only.
+    /// \returns the number of items popped.
+    size_t pop(T* out, size_t max) noexcept {
+        auto head = _consumer.head.load(std::memory_order_relaxed);
+        if (head + max > _consumer.cached_tail) {
+            _consumer.cached_tail = _producer.tail.load(std::memory_order_acquire);
+        }
+        auto n = std::min(max, _consumer.cached_tail - head);
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = _slots[(head + i) & _mask];
+        }
+        if (n) {
+            _consumer.head.store(head + n, std::memory_order_release);
+        }
+        return n;
+    }
+
+    /// Consumer side only.
+    bool pop(T& out) noexcept {
+        return pop(&out, 1);
+    }
+
+    /// Pops all available items, calling \c func on each.
+    ///
+    /// Consumer side only.
+    /// \returns the number of items consumed.
+    template <typename Func>
+    size_t consume_all(Func func) noexcept(std::is_nothrow_invocable_v<Func, T>) {
+        size_t nr = 0;
+        T item;
+        while (pop(item)) {
+            func(item);
+            ++nr;
+        }
+        return nr;
+    }
+
+    /// Checks whether there is nothing to pop.
+    ///
+    /// Consumer side only.
+    bool empty() const noexcept {
+        return _consumer.head.load(std::memory_order_relaxed) == _producer.tail.load(std::memory_order_acquire);
+    }
+};
+
+}
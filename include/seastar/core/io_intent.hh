@@ -26,6 +26,7 @@
 #include <seastar/util/modules.hh>
 #ifndef SEASTAR_MODULE
 #include <boost/container/small_vector.hpp>
+#include <chrono>
 #endif
 
 namespace seastar {
@@ -40,8 +41,17 @@ namespace seastar {
 ///
 /// If no intent is provided, then the request is processed till its
 /// completion be it success or error
+///
+/// An intent may also carry a deadline. Requests pinned to it are then
+/// dispatched earliest-deadline-first within their class, and the ones
+/// still queued when the deadline passes are dropped without being
+/// charged to the disk and resolved into the \ref timed_out_error
+/// "timed_out_error"
 SEASTAR_MODULE_EXPORT
 class io_intent {
+public:
+    using clock_type = std::chrono::steady_clock;
+private:
     struct intents_for_queue {
         unsigned qid;
         io_priority_class_id cid;
@@ -72,16 +82,19 @@ class io_intent {
 
     boost::container::small_vector<intents_for_queue, 1> _intents;
     references _refs;
+    clock_type::time_point _deadline = clock_type::time_point::max();
     friend internal::intent_reference::intent_reference(io_intent*) noexcept;
 
 public:
     io_intent() = default;
+    /// Constructs an intent whose requests time out if not dispatched by \c deadline
+    explicit io_intent(clock_type::time_point deadline) noexcept : _deadline(deadline) {}
     ~io_intent() = default;
 
     io_intent(const io_intent&) = delete;
     io_intent& operator=(const io_intent&) = delete;
     io_intent& operator=(io_intent&&) = delete;
-    io_intent(io_intent&& o) noexcept : _intents(std::move(o._intents)), _refs(std::move(o._refs)) {
+    io_intent(io_intent&& o) noexcept : _intents(std::move(o._intents)), _refs(std::move(o._refs)), _deadline(o._deadline) {
         for (auto&& r : _refs.list) {
             r._intent = this;
         }
@@ -95,6 +108,11 @@ class io_intent {
         _intents.clear();
     }
 
+    /// The time by which the requests must be dispatched
+    clock_type::time_point deadline() const noexcept {
+        return _deadline;
+    }
+
     /// @private
     internal::cancellable_queue& find_or_create_cancellable_queue(unsigned qid, io_priority_class_id cid) {
         for (auto&& i : _intents) {
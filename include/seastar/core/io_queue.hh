@@ -23,8 +23,10 @@
 
 #ifndef SEASTAR_MODULE
 #include <boost/container/static_vector.hpp>
+#include <atomic>
 #include <chrono>
 #include <memory>
+#include <optional>
 #include <vector>
 #include <sys/uio.h>
 #endif
@@ -66,6 +68,20 @@ class io_group;
 using io_group_ptr = std::shared_ptr<io_group>;
 using iovec_keeper = std::vector<::iovec>;
 
+namespace internal {
+// Completions observed by an io_queue, feeding the group's adaptive cost model.
+// Indexed by io_direction_and_length::rw_idx().
+struct io_cost_model_stats {
+    uint64_t completed[2] = {0, 0};
+    // Sum of request execution times (dispatch to completion)
+    uint64_t latency_ns[2] = {0, 0};
+    // Sum of request costs as predicted by the static model, in micro-tokens
+    uint64_t micro_tokens[2] = {0, 0};
+    // Number of times dispatching stopped because the token bucket ran dry
+    uint64_t throttled = 0;
+};
+}
+
 namespace internal {
 class priority_class {
     unsigned _id;
@@ -107,11 +123,18 @@ class io_queue {
             capacity_t cap = 0;
         };
         pending _pending;
+        // Whether this queue counts as backlogged in the throttler, and
+        // when it last had requests it couldn't get capacity for
+        bool _backlogged = false;
+        clock_type::time_point _backlogged_ts;
+        // Capacity reserved over the per-tick threshold thanks to idle shards
+        capacity_t _borrowed = 0;
         stream(io_throttler& t, fair_queue::config cfg)
             : fq(std::move(cfg))
             , replenish(clock_type::now())
             , out(t)
         {}
+        ~stream();
 
         // Shaves off the fulfilled frontal part from `_pending` (if any),
         // and returns the fulfilled tokens in `ready_tokens`.
@@ -128,6 +151,8 @@ class io_queue {
         clock_type::time_point next_pending_aio() const noexcept;
         reap_result reap_pending_capacity() noexcept;
         grab_result grab_capacity(capacity_t cap, reap_result& available);
+        void mark_backlogged() noexcept;
+        void maybe_mark_idle() noexcept;
 
         std::vector<seastar::metrics::impl::metric_definition_impl> metrics(const priority_class_data&);
     };
@@ -138,6 +163,9 @@ class io_queue {
     friend const io_throttler& internal::get_throttler(const io_queue& ioq, unsigned stream);
 
     priority_class_data& find_or_create_class(internal::priority_class pc);
+    std::optional<future<size_t>> try_merge_read(priority_class_data& pclass, internal::io_direction_and_length dnl, const internal::io_request& req, iovec_keeper& iovs);
+    void update_queued_capacity(queued_io_request& req, fair_queue_entry::capacity_t cap) noexcept;
+    friend class queued_io_request;
     future<size_t> queue_request(internal::priority_class pc, internal::io_direction_and_length dnl, internal::io_request req, io_intent* intent, iovec_keeper iovs) noexcept;
     future<size_t> queue_one_request(internal::priority_class pc, internal::io_direction_and_length dnl, internal::io_request req, io_intent* intent, iovec_keeper iovs) noexcept;
 
@@ -155,6 +183,9 @@ class io_queue {
     uint64_t _prev_completed = 0;
     double _flow_ratio = 1.0;
 
+    // Accumulated locally, folded into the group on every averaging tick
+    internal::io_cost_model_stats _cost_model_stats;
+
     timer<lowres_clock> _averaging_decay_timer;
 
     const std::chrono::milliseconds _stall_threshold_min;
@@ -162,6 +193,7 @@ class io_queue {
 
     void update_flow_ratio() noexcept;
     void lower_stall_threshold() noexcept;
+    void update_cost_model() noexcept;
 
     metrics::metric_groups _metric_groups;
 public:
@@ -194,6 +226,22 @@ class io_queue {
         double flow_ratio_backpressure_threshold = 1.1;
         std::chrono::milliseconds stall_threshold = std::chrono::milliseconds(100);
         std::chrono::microseconds tau = std::chrono::milliseconds(5);
+        // Continuously re-estimate the device cost model from completion
+        // latencies instead of relying on the static io-properties only.
+        bool adaptive_cost_model = false;
+        // Bounds for the adaptive replenish rate, relative to the static model
+        double adaptive_min_rate_ratio = 0.1;
+        double adaptive_max_rate_ratio = 4.0;
+        // Merge reads queued back-to-back on adjacent file ranges into one
+        // vectored read, up to this many extra requests per read
+        bool merge_reads = false;
+        unsigned max_merged_requests = 16;
+        // Pick the next class to dispatch from in O(1) rather than O(log n),
+        // for setups with very many classes
+        bool calendar_class_selection = false;
+        // Let shards with backlog reserve the per-tick capacity of the
+        // shards of the same group that have none
+        bool capacity_lending = false;
     };
 
     io_queue(io_group_ptr group, internal::io_sink& sink);
@@ -205,9 +253,12 @@ class io_queue {
     future<size_t> submit_io_write(size_t len, internal::io_request req, io_intent* intent, iovec_keeper iovs = {}) noexcept;
 
     void submit_request(io_desc_read_write* desc, internal::io_request req) noexcept;
+    // Submits a part of a failed merged read on its own, bypassing the queue
+    void resubmit_request(io_desc_read_write* desc, internal::io_request req) noexcept;
     void cancel_request(queued_io_request& req) noexcept;
     void complete_cancelled_request(queued_io_request& req) noexcept;
     void complete_request(io_desc_read_write& desc, std::chrono::duration<double> delay) noexcept;
+    void account_completion(internal::io_direction_and_length dnl, std::chrono::duration<double> delay) noexcept;
 
     // Dispatch requests that are pending in the I/O queue
     void poll_io_queue();
@@ -330,6 +381,10 @@ class io_throttler {
 
     token_bucket_t _token_bucket;
     const capacity_t _per_tick_threshold;
+    const bool _capacity_lending;
+    // Queues that have requests waiting for capacity, only maintained
+    // with capacity lending on
+    std::atomic<unsigned> _nr_backlogged = 0;
 
 public:
 
@@ -359,6 +414,7 @@ class io_throttler {
         double min_tokens = 0.0;
         double limit_min_tokens = 0.0;
         std::chrono::duration<double> rate_limit_duration = std::chrono::milliseconds(1);
+        bool capacity_lending = false;
     };
 
     explicit io_throttler(config cfg, unsigned nr_queues);
@@ -366,6 +422,19 @@ class io_throttler {
 
     capacity_t maximum_capacity() const noexcept { return _token_bucket.limit(); }
     capacity_t per_tick_grab_threshold() const noexcept { return _per_tick_threshold; }
+    // The per-tick threshold of a backlogged queue, which grows as other
+    // queues run out of requests and leave their share of the bucket unused
+    capacity_t lending_grab_threshold() const noexcept {
+        if (!_capacity_lending) {
+            return _per_tick_threshold;
+        }
+        auto nr = _nr_backlogged.load(std::memory_order_relaxed);
+        return nr > 1 ? std::max(_token_bucket.limit() / nr, _per_tick_threshold) : _token_bucket.limit();
+    }
+    bool capacity_lending() const noexcept { return _capacity_lending; }
+    unsigned nr_backlogged() const noexcept { return _nr_backlogged.load(std::memory_order_relaxed); }
+    void on_backlog_start() noexcept { _nr_backlogged.fetch_add(1, std::memory_order_relaxed); }
+    void on_backlog_end() noexcept { _nr_backlogged.fetch_sub(1, std::memory_order_relaxed); }
     capacity_t grab_capacity(capacity_t cap) noexcept;
     clock_type::time_point replenished_ts() const noexcept { return _token_bucket.replenished_ts(); }
     void refund_tokens(capacity_t) noexcept;
@@ -380,6 +449,9 @@ class io_throttler {
     }
 
     const token_bucket_t& token_bucket() const noexcept { return _token_bucket; }
+
+    // Scales the replenish rate relative to the one the throttler was configured with
+    void update_rate_ratio(double ratio) noexcept;
 };
 
 class io_group {
@@ -390,6 +462,10 @@ class io_group {
 
     std::chrono::duration<double> io_latency_goal() const noexcept;
 
+    // Current corrections applied by the adaptive cost model (1.0 when disabled)
+    double rate_ratio() const noexcept { return _cost_model.rate_ratio.load(std::memory_order_relaxed); }
+    double cost_factor(unsigned rw_idx) const noexcept { return _cost_model.cost_factor[rw_idx].load(std::memory_order_relaxed); }
+
 private:
     friend class io_queue;
     friend struct ::io_queue_for_tests;
@@ -411,10 +487,38 @@ class io_group {
     std::vector<std::unique_ptr<priority_class_data>> _priority_classes;
     util::spinlock _lock;
     const shard_id _allocated_on;
+    std::chrono::duration<double> _latency_goal;
+
+    /*
+     * Adaptive cost model. Queues fold the latencies of their completed
+     * requests into `pending` periodically, and whichever queue gets to it
+     * first after `period` has passed runs adapt_cost_model() on the sum.
+     *
+     * The replenish rate of the throttlers is scaled down when requests take
+     * longer than the latency goal and up when the model holds requests back
+     * while the device has latency headroom. Independently, each direction's
+     * request cost is scaled by how its latency per (statically predicted)
+     * token compares to the other direction's.
+     */
+    struct adaptive_cost_model {
+        std::atomic<uint64_t> completed[2] = {0, 0};
+        std::atomic<uint64_t> latency_ns[2] = {0, 0};
+        std::atomic<uint64_t> micro_tokens[2] = {0, 0};
+        std::atomic<uint64_t> throttled = 0;
+        std::atomic<double> rate_ratio = 1.0;
+        std::atomic<double> cost_factor[2] = {1.0, 1.0};
+        util::spinlock lock;
+        io_queue::clock_type::time_point last_update;
+    };
+    adaptive_cost_model _cost_model;
 
     static io_throttler::config configure_throttler(const io_queue::config& qcfg) noexcept;
     priority_class_data& find_or_create_class(internal::priority_class pc);
 
+    void account_cost_model_stats(const internal::io_cost_model_stats& st) noexcept;
+    void maybe_adapt_cost_model(io_queue::clock_type::duration period) noexcept;
+    void adapt_cost_model(const internal::io_cost_model_stats& st) noexcept;
+
     inline size_t max_request_length(int dnl_idx) const noexcept {
         return _max_request_length[dnl_idx];
     }
@@ -37,6 +37,8 @@
 
 namespace seastar {
 
+class scheduling_group;
+
 /// \defgroup memory-module Memory management
 ///
 /// Functions and classes for managing memory.
@@ -307,16 +309,19 @@ class statistics {
     uint64_t _foreign_mallocs;
     uint64_t _foreign_frees;
     uint64_t _foreign_cross_frees;
+    uint64_t _cross_cpu_free_batches;
 private:
     statistics(uint64_t mallocs, uint64_t frees, uint64_t cross_cpu_frees,
             uint64_t total_memory, uint64_t free_memory, uint64_t reclaims,
             uint64_t large_allocs, uint64_t failed_allocs,
-            uint64_t foreign_mallocs, uint64_t foreign_frees, uint64_t foreign_cross_frees)
+            uint64_t foreign_mallocs, uint64_t foreign_frees, uint64_t foreign_cross_frees,
+            uint64_t cross_cpu_free_batches)
         : _mallocs(mallocs), _frees(frees), _cross_cpu_frees(cross_cpu_frees)
         , _total_memory(total_memory), _free_memory(free_memory), _reclaims(reclaims)
         , _large_allocs(large_allocs), _failed_allocs(failed_allocs)
         , _foreign_mallocs(foreign_mallocs), _foreign_frees(foreign_frees)
-        , _foreign_cross_frees(foreign_cross_frees) {}
+        , _foreign_cross_frees(foreign_cross_frees)
+        , _cross_cpu_free_batches(cross_cpu_free_batches) {}
 public:
     /// Total number of memory allocations calls since the system was started.
     uint64_t mallocs() const { return _mallocs; }
@@ -325,6 +330,10 @@ class statistics {
     /// Total number of memory deallocations that occured on a different lcore
     /// than the one on which they were allocated.
     uint64_t cross_cpu_frees() const { return _cross_cpu_frees; }
+    /// Total number of batches in which this lcore handed memory it freed
+    /// back to the lcores that allocated it. Each batch costs one atomic
+    /// operation on the owner's free list.
+    uint64_t cross_cpu_free_batches() const { return _cross_cpu_free_batches; }
     /// Total number of objects which were allocated but not freed.
     size_t live_objects() const { return mallocs() - frees(); }
     /// Total free memory (in bytes)
@@ -431,6 +440,7 @@ struct allocation_site {
     mutable size_t count = 0; /// number of live objects allocated at backtrace.
     mutable size_t size = 0; /// amount of bytes in live objects allocated at backtrace.
     simple_backtrace backtrace; /// call site for this allocation
+    unsigned scheduling_group_index = 0; /// index of the scheduling group the allocations were made in
 
     // All allocation sites are linked to each other. This can be used for easy
     // iteration across them in gdb scripts where it's difficult to work with
@@ -439,7 +449,7 @@ struct allocation_site {
     mutable const allocation_site* prev = nullptr; // previous allocation site in the chain
 
     bool operator==(const allocation_site& o) const {
-        return backtrace == o.backtrace;
+        return backtrace == o.backtrace && scheduling_group_index == o.scheduling_group_index;
     }
 
     bool operator!=(const allocation_site& o) const {
@@ -470,6 +480,24 @@ std::vector<allocation_site> sampled_memory_profile();
 /// @return number of \ref allocation_site copied to the vector
 size_t sampled_memory_profile(allocation_site* output, size_t size);
 
+/// @brief Sampled heap usage attributed to one scheduling group
+///
+/// Like \ref allocation_site sizes, byte counts are extrapolated from the
+/// sampled allocations and approximate the real usage.
+struct scheduling_group_heap_stats {
+    size_t live_bytes = 0; /// bytes in live allocations made in the group
+    uint64_t allocated_bytes = 0; /// bytes allocated in the group since startup
+    uint64_t sampled_allocations = 0; /// number of sampled allocations made in the group since startup
+};
+
+/// @brief Returns the sampled heap usage of a scheduling group on this shard
+///
+/// Only allocations sampled while heap profiling was on are accounted; see
+/// \ref set_heap_profiling_sampling_rate(). Allocation sites in
+/// \ref sampled_memory_profile() carry the same attribution in
+/// allocation_site::scheduling_group_index.
+scheduling_group_heap_stats sampled_heap_stats(scheduling_group sg);
+
 /// @brief Enable sampled heap profiling by setting a sample rate
 ///
 /// @param sample_rate the sample rate to use. Disable heap profiling by setting
@@ -508,6 +536,40 @@ class scoped_heap_profiling {
     ~scoped_heap_profiling();
 };
 
+/// Sets how much memory the calling shard may keep in its cache of freed
+/// 64k-2M buffers.
+///
+/// Freed buffers in that size range are reused as-is by later allocations of
+/// the same size, instead of being coalesced with neighbouring free memory
+/// and split again. The cache counts as free memory and is returned to the
+/// general pool before any reclaimer runs. By default up to 1/32 of the
+/// shard's memory is cached; 0 disables the cache.
+void set_large_span_cache_size(size_t bytes);
+
+/// Returns the limit set by \ref set_large_span_cache_size().
+size_t large_span_cache_size();
+
+/// Tuning of one small-object size class of the seastar allocator.
+struct size_class_tuning {
+    /// Any object size served by the size class.
+    size_t object_size;
+    /// Number of free objects the size class keeps for reuse before
+    /// returning memory to the page allocator.
+    unsigned max_free;
+};
+
+/// Derives size class tuning from the calling shard's current usage.
+///
+/// Size classes holding many live objects get deeper free lists, so that
+/// bursts of allocation and deallocation are served from the free list. The
+/// result can be stored and applied on startup with \ref tune_size_classes().
+std::vector<size_class_tuning> profile_size_classes();
+
+/// Applies size class tuning, e.g. from \ref profile_size_classes(), to the
+/// calling shard. Entries for sizes not served by small-object size classes
+/// are ignored.
+void tune_size_classes(const std::vector<size_class_tuning>& tuning);
+
 SEASTAR_MODULE_EXPORT_END
 
 }
@@ -518,7 +580,7 @@ namespace std {
 template<>
 struct hash<seastar::memory::allocation_site> {
     size_t operator()(const seastar::memory::allocation_site& bi) const {
-        return std::hash<seastar::simple_backtrace>()(bi.backtrace);
+        return std::hash<seastar::simple_backtrace>()(bi.backtrace) ^ bi.scheduling_group_index;
     }
 };
 
@@ -111,6 +111,10 @@ namespace seastar {
 class thread_pool;
 class smp;
 
+namespace tls {
+class session;
+}
+
 class reactor_backend_selector;
 
 class reactor_backend;
@@ -198,6 +202,9 @@ class reactor {
         uint64_t aio_outsizes = 0;
         uint64_t aio_errors = 0;
         uint64_t aio_retries = 0;
+        uint64_t submit_syscalls = 0;
+        uint64_t submitted_requests = 0;
+        uint64_t sqpoll_wakeups = 0;
         uint64_t fstream_reads = 0;
         uint64_t fstream_read_bytes = 0;
         uint64_t fstream_reads_blocked = 0;
@@ -435,6 +442,7 @@ class reactor {
     signals _signals;
     std::unique_ptr<thread_pool> _thread_pool;
     friend class internal::cpu_stall_detector;
+    friend class tls::session;
 
     friend void handle_signal(int signo, noncopyable_function<void ()>&& handler, bool once);
 
@@ -691,6 +699,10 @@ template <typename Func>
     future<> send_all_part(pollable_fd_state& fd, const void* buffer, size_t size, size_t completed);
 
     future<> fdatasync(int fd) noexcept;
+    // Tell the backend about descriptors used for disk I/O, so that it
+    // can register them with the kernel (see --io-uring-fixed-io).
+    void register_file(int fd) noexcept;
+    void unregister_file(int fd) noexcept;
 
     void add_timer(timer<steady_clock_type>*) noexcept;
     bool queue_timer(timer<steady_clock_type>*) noexcept;
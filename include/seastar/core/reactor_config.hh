@@ -25,6 +25,7 @@
 #include <seastar/util/memory_diagnostics.hh>
 #include <seastar/util/modules.hh>
 #include <seastar/core/scheduling.hh>
+#include <vector>
 
 namespace seastar {
 
@@ -43,6 +44,14 @@ struct reactor_config {
     bool bypass_fsync = false;
     bool no_poll_aio = false;
     bool aio_nowait_works = false;
+    bool uring_fixed_io = false;
+    bool uring_sqpoll = false;
+    // CPUs the process may run on that no shard is pinned to, where the
+    // SQPOLL thread can run without competing with a reactor
+    std::vector<unsigned> uring_sqpoll_cpus;
+    unsigned uring_submit_batch = 0;
+    bool uring_multishot_net = false;
+    unsigned uring_zerocopy_send_threshold = 0;
 };
 /// \endcond
 
@@ -86,6 +95,38 @@ struct reactor_options : public program_options::option_group {
     ///
     /// Default: 1.1
     program_options::value<double> io_flow_ratio_threshold;
+    /// \brief Continuously adapt the IO cost model to observed latencies
+    ///
+    /// When enabled, the IO scheduler scales the disk capacity and the
+    /// per-direction request costs derived from io-properties according to
+    /// how request latencies compare to the latency goal.
+    ///
+    /// Default: false
+    program_options::value<bool> io_adaptive_cost_model;
+    /// \brief Select the next IO class to dispatch from in constant time
+    ///
+    /// Worth enabling with hundreds of scheduling groups doing IO. Classes
+    /// with close enough accumulated costs are then served round-robin.
+    ///
+    /// Default: false
+    program_options::value<bool> io_calendar_class_selection;
+    /// \brief Let shards with IO backlog use the disk capacity idle shards leave unused
+    ///
+    /// By default each shard may reserve at most its own share of the disk
+    /// capacity at a time, even if other shards of the same IO group have
+    /// nothing to dispatch. With this option backlogged shards split the
+    /// whole capacity among themselves.
+    ///
+    /// Default: false
+    program_options::value<bool> io_capacity_lending;
+    /// \brief Merge reads queued back-to-back on adjacent ranges of a file
+    /// into one vectored read.
+    ///
+    /// Saves per-request overhead for sequential readers issuing small
+    /// reads. If a merged read fails, its parts are retried separately.
+    ///
+    /// Default: false
+    program_options::value<bool> io_merge_reads;
     /// \brief If an IO request is executed longer than that, this is printed to
     /// logs with extra debugging
     ///
@@ -159,6 +200,57 @@ struct reactor_options : public program_options::option_group {
     ///
     /// Default: \p linux-aio (if available).
     program_options::selection_value<reactor_backend_selector> reactor_backend;
+    /// \brief Register DMA buffers and file descriptors with io_uring.
+    ///
+    /// Each shard registers its memory and the descriptors of files it opens
+    /// with the kernel, and submits disk I/O as fixed-buffer, fixed-file
+    /// requests. This saves pinning pages and looking up the file on every
+    /// request, at the cost of pinning all shard memory up front (subject to
+    /// \p RLIMIT_MEMLOCK). Only valid for the \p io_uring reactor backend
+    /// (see \ref reactor_backend).
+    ///
+    /// Default: \p false.
+    program_options::value<bool> io_uring_fixed_io;
+    /// \brief Let a kernel thread poll the io_uring submission queue.
+    ///
+    /// Submitting I/O then needs no system calls while the thread is
+    /// awake. All the shards share one thread, which is pinned to a CPU
+    /// no shard runs on when there is one, preferably a hyperthread sibling
+    /// of shard 0's CPU, and left unpinned otherwise. Requires Linux 5.11
+    /// (or \p CAP_SYS_ADMIN),
+    /// otherwise the reactor falls back to submitting I/O itself. Only
+    /// valid for the \p io_uring reactor backend (see \ref reactor_backend).
+    ///
+    /// Default: \p false.
+    program_options::value<bool> io_uring_sqpoll;
+    /// \brief Minimal io_uring submission batch.
+    ///
+    /// While the reactor has tasks to run, hold back submitting fewer
+    /// requests than this, for at most one task quota. Ignored with
+    /// \ref io_uring_sqpoll. Only valid for the \p io_uring reactor
+    /// backend (see \ref reactor_backend).
+    ///
+    /// Default: 0 (submit on every poll).
+    program_options::value<unsigned> io_uring_submit_batch;
+    /// \brief Use multishot accept and receive on posix-stack sockets.
+    ///
+    /// Listening sockets keep one multishot accept armed, and connected
+    /// sockets one multishot receive into a per-shard ring of kernel-provided
+    /// buffers (16MB per shard), which are passed to input streams without
+    /// copying. Requires Linux 6.0. Only valid for the \p io_uring reactor
+    /// backend (see \ref reactor_backend).
+    ///
+    /// Default: \p false.
+    program_options::value<bool> io_uring_multishot_net;
+    /// \brief Send socket data of at least this many bytes without copying.
+    ///
+    /// Such sends are submitted as \p IORING_OP_SENDMSG_ZC, and the data
+    /// (the output stream's buffers) is kept alive until the kernel reports
+    /// it no longer needs it. Requires Linux 6.1. Only valid for the
+    /// \p io_uring reactor backend (see \ref reactor_backend).
+    ///
+    /// Default: 0 (disabled).
+    program_options::value<unsigned> io_uring_zerocopy_send_threshold;
     /// \brief Use Linux aio for fsync() calls.
     ///
     /// This reduces latency. Requires Linux 4.18 or later.
@@ -25,6 +25,8 @@
 #include <seastar/core/loop.hh>
 #include <seastar/core/semaphore.hh>
 #include <seastar/core/metrics_registration.hh>
+#include <seastar/core/internal/estimated_histogram.hh>
+#include <seastar/core/internal/spsc_ring.hh>
 #include <seastar/core/posix.hh>
 #include <seastar/core/reactor_config.hh>
 #include <seastar/core/resource.hh>
@@ -32,7 +34,9 @@
 #include <seastar/util/modules.hh>
 
 #ifndef SEASTAR_MODULE
-#include <boost/lockfree/spsc_queue.hpp>
+#include <boost/lockfree/queue.hpp>
+#include <atomic>
+#include <chrono>
 #include <deque>
 #include <optional>
 #include <thread>
@@ -185,23 +189,38 @@ void init_default_smp_service_group(shard_id cpu);
 smp_service_group_semaphore& get_smp_service_groups_semaphore(unsigned ssg_id, shard_id t) noexcept;
 
 class smp_message_queue {
-    static constexpr size_t queue_length = 128;
+public:
+    using clock_type = std::chrono::steady_clock;
+    struct config {
+        /// Capacity of each direction of the queue, rounded up to a power of two.
+        size_t queue_length = 128;
+        /// How long a message may be held back to be batched with others
+        /// while the remote shard is still busy with a previous batch.
+        std::chrono::microseconds max_batch_delay = std::chrono::microseconds(50);
+    };
+private:
+    // Upper bound on the number of messages batched before a flush,
+    // and on the number of messages processed in one go.
     static constexpr size_t batch_size = 16;
+    static constexpr size_t process_batch_size = 128;
     static constexpr size_t prefetch_cnt = 2;
     struct work_item;
     struct lf_queue_remote {
         reactor* remote;
     };
-    using lf_queue_base = boost::lockfree::spsc_queue<work_item*,
-                            boost::lockfree::capacity<queue_length>>;
+    using lf_queue_base = internal::spsc_ring<work_item*>;
     // use inheritence to control placement order
     struct lf_queue : lf_queue_remote, lf_queue_base {
-        lf_queue(reactor* remote) : lf_queue_remote{remote} {}
+        lf_queue(reactor* remote, size_t capacity) : lf_queue_remote{remote}, lf_queue_base(capacity) {}
         void maybe_wakeup();
         ~lf_queue();
     };
     lf_queue _pending;
     lf_queue _completed;
+    clock_type::duration _max_batch_delay;
+    // Round trip latency, in nanoseconds, from the moment a message is
+    // queued until its completion is processed on the sending shard.
+    using latency_histogram = metrics::internal::approximate_exponential_histogram<512, (512 << 18), 4>;
     struct alignas(seastar::cache_line_size) {
         size_t _sent = 0;
         size_t _compl = 0;
@@ -209,6 +228,8 @@ class smp_message_queue {
         size_t _last_cmpl_batch = 0;
         size_t _current_queue_length = 0;
     };
+    // updated on the sending side, like the counters above
+    latency_histogram _latency;
     // keep this between two structures with statistics
     // this makes sure that they have at least one cache line
     // between them, so hw prefetcher will not accidentally prefetch
@@ -221,6 +242,7 @@ class smp_message_queue {
     struct work_item : public task {
         explicit work_item(smp_service_group ssg) : task(current_scheduling_group()), ssg(ssg) {}
         smp_service_group ssg;
+        clock_type::time_point queued_at;
         virtual ~work_item() {}
         virtual void fail_with(std::exception_ptr) = 0;
         void process();
@@ -274,11 +296,13 @@ class smp_message_queue {
         void init() { new (&a) aa; }
         struct aa {
             std::deque<work_item*> pending_fifo;
+            clock_type::time_point oldest_pending;
         } a;
     } _tx;
     std::vector<work_item*> _completed_fifo;
+    clock_type::time_point _oldest_completed;
 public:
-    smp_message_queue(reactor* from, reactor* to);
+    smp_message_queue(reactor* from, reactor* to, const config& cfg);
     ~smp_message_queue();
     template <typename Func>
     futurize_t<std::invoke_result_t<Func>> submit(shard_id t, smp_submit_to_options options, Func&& func) noexcept {
@@ -302,12 +326,111 @@ class smp_message_queue {
     void flush_request_batch();
     void flush_response_batch();
     bool has_unflushed_responses() const;
+    bool should_flush(const lf_queue& q, size_t batched, clock_type::time_point oldest, clock_type::time_point now) const noexcept;
     bool pure_poll_rx() const;
     bool pure_poll_tx() const;
 
     friend class smp;
 };
 
+/// Queue of work items submitted through \ref smp::submit_anywhere().
+///
+/// Each shard owns one queue. Items are pushed by the owner and popped
+/// either by the owner or by one of its siblings (the shards next to it)
+/// that is idle and steals them before going to sleep. A busy owner leaves
+/// its items to the siblings for a while before running them itself.
+/// Results are always delivered on the owner.
+class stealable_work_queue {
+    static constexpr size_t queue_length = 1024;
+    static constexpr size_t batch_size = 16;
+    static constexpr size_t steal_batch_size = 4;
+    // Shards on each side of the owner that may steal from it
+    static constexpr unsigned sibling_distance = 2;
+    // How long a busy owner leaves its items to the siblings
+    static constexpr std::chrono::microseconds steal_window{100};
+    struct work_item : public task {
+        explicit work_item(scheduling_group sg) noexcept : task(sg), origin(this_shard_id()) {}
+        shard_id origin;
+        work_item* next_completed = nullptr;
+        virtual ~work_item() {}
+        virtual void complete() noexcept = 0;
+        virtual task* waiting_task() noexcept override {
+            // Like smp_message_queue::work_item, waiting_task across shards is not supported.
+            return nullptr;
+        }
+        // Called on the shard which ran the item; completes it on the origin shard.
+        void respond() noexcept;
+    };
+    template <typename Func>
+    struct async_work_item final : work_item {
+        using result_type = std::invoke_result_t<Func>;
+        Func _func;
+        std::optional<std::conditional_t<std::is_void_v<result_type>, std::monostate, result_type>> _result;
+        promise<result_type> _promise; // used on the origin shard only
+        async_work_item(scheduling_group sg, Func&& func) : work_item(sg), _func(std::move(func)) {}
+        virtual void run_and_dispose() noexcept override {
+            if constexpr (std::is_void_v<result_type>) {
+                _func();
+                _result.emplace();
+            } else {
+                _result.emplace(_func());
+            }
+            // The item is deleted on the origin shard once it completes.
+            respond();
+        }
+        virtual void complete() noexcept override {
+            if constexpr (std::is_void_v<result_type>) {
+                _promise.set_value();
+            } else {
+                _promise.set_value(std::move(*_result));
+            }
+        }
+        future<result_type> get_future() noexcept { return _promise.get_future(); }
+    };
+    using lf_queue = boost::lockfree::queue<work_item*, boost::lockfree::capacity<queue_length>>;
+    lf_queue _pending;
+    // Approximate number of items in _pending, so that idle siblings can
+    // skip the queue when there is nothing to steal.
+    alignas(seastar::cache_line_size) std::atomic<int64_t> _nr_pending = 0;
+    // Intrusive list of items run by other shards, waiting to be completed here.
+    alignas(seastar::cache_line_size) std::atomic<work_item*> _completed = nullptr;
+    // Cleared when the owner stops, so that late completions don't wake it
+    std::atomic<reactor*> _owner = nullptr;
+    metrics::metric_groups _metrics;
+    struct alignas(seastar::cache_line_size) {
+        uint64_t _submitted = 0;
+        uint64_t _stolen = 0;
+        uint64_t _executed_for_others = 0;
+    };
+    // Owner only: when _pending last became non-empty
+    std::chrono::steady_clock::time_point _pending_since;
+    std::vector<shard_id> _siblings;
+    unsigned _next_sibling = 0;
+public:
+    ~stealable_work_queue();
+    template <typename Func>
+    future<std::invoke_result_t<Func>> submit(scheduling_group sg, Func&& func) noexcept {
+        memory::scoped_critical_alloc_section _;
+        auto wi = new async_work_item<Func>(sg, std::move(func));
+        auto fut = wi->get_future();
+        enqueue(wi);
+        return fut;
+    }
+    void start();
+    void stop();
+    // \c busy: the owner has other tasks to run
+    size_t process_pending(bool busy);
+    size_t process_completions();
+    bool pure_poll() const noexcept;
+private:
+    void enqueue(work_item* wi) noexcept;
+    void wakeup_sibling() noexcept;
+    size_t steal_into(stealable_work_queue& thief) noexcept;
+    void push_completed(work_item* wi) noexcept;
+
+    friend class smp;
+};
+
 class smp_message_queue;
 struct reactor_options;
 struct smp_options;
@@ -323,6 +446,8 @@ class smp : public std::enable_shared_from_this<smp> {
     };
     std::unique_ptr<smp_message_queue*[], qs_deleter> _qs_owner;
     static thread_local smp_message_queue**_qs;
+    std::unique_ptr<stealable_work_queue[]> _stealable_qs_owner;
+    static thread_local stealable_work_queue* _stealable_qs;
     static thread_local std::thread::id _tmain;
     bool _using_dpdk = false;
     std::vector<unsigned> _shard_to_numa_node_mapping;
@@ -398,6 +523,29 @@ class smp : public std::enable_shared_from_this<smp> {
     static futurize_t<std::invoke_result_t<Func>> submit_to(unsigned t, Func&& func) noexcept {
         return submit_to(t, default_smp_service_group(), std::forward<Func>(func));
     }
+    /// Runs a stateless, CPU-bound function on whichever shard gets to it first.
+    ///
+    /// The function is queued on the current shard and is run either by the
+    /// current shard or by an idle shard that steals it before going to
+    /// sleep, in scheduling group \c sg of the shard that runs it. This suits
+    /// embarrassingly parallel work such as compression or checksumming,
+    /// which would otherwise be bound to an overloaded shard.
+    ///
+    /// \c func may run on any shard, so it must not touch shard-local state
+    /// (of any shard), and it must capture and return only objects that are
+    /// safe to create on one shard and destroy on another.
+    ///
+    /// \param sg scheduling group to run \c func in
+    /// \param func a noexcept callable returning a value (not a future);
+    ///        it is moved into the queue.
+    /// \return a future, resolved on the current shard, holding the value
+    ///         returned by \c func.
+    template <typename Func>
+    requires std::is_nothrow_invocable_v<Func&> && std::is_nothrow_move_constructible_v<Func>
+            && (!is_future<std::invoke_result_t<Func&>>::value) && (!std::is_reference_v<Func>)
+    static future<std::invoke_result_t<Func&>> submit_anywhere(scheduling_group sg, Func&& func) noexcept {
+        return _stealable_qs[this_shard_id()].submit(sg, std::move(func));
+    }
     static bool poll_queues();
     static bool pure_poll_queues();
     static std::ranges::range auto all_cpus() noexcept {
@@ -480,11 +628,14 @@ class smp : public std::enable_shared_from_this<smp> {
     }
 private:
     void start_all_queues();
+    static size_t steal_work() noexcept;
     void pin(unsigned cpu_id);
     void allocate_reactor(unsigned id, reactor_backend_selector rbs, reactor_config cfg);
     void create_thread(std::function<void ()> thread_loop);
     unsigned adjust_max_networking_aio_io_control_blocks(unsigned network_iocbs, unsigned reserve_iocbs);
     static void log_aiocbs(log_level level, unsigned storage, unsigned preempt, unsigned network, unsigned reserve);
+
+    friend class stealable_work_queue;
 public:
     static unsigned count;
 };
@@ -85,6 +85,16 @@ struct smp_options : public program_options::option_group {
     /// them to remote ones.
     /// \note Unused when seastar is compiled without \p HWLOC support.
     program_options::value<bool> allow_cpus_in_remote_numa_nodes;
+    /// Capacity of each cross-shard message queue, rounded up to a power of two.
+    ///
+    /// Default: 128.
+    program_options::value<unsigned> smp_queue_length;
+    /// Maximum time, in microseconds, a cross-shard message is held back to
+    /// be batched with others while the remote shard is still busy.
+    /// Messages are sent right away when the remote shard is idle.
+    ///
+    /// Default: 50.
+    program_options::value<unsigned> smp_max_batch_delay;
 
     /// Memory allocator to use.
     ///
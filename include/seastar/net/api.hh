@@ -113,6 +113,12 @@ class datagram final {
 
 using udp_datagram = datagram;
 
+/// A datagram queued for transmission with datagram_channel::send_batch().
+struct outgoing_datagram {
+    socket_address dst;
+    packet data;
+};
+
 class datagram_channel {
 private:
     std::unique_ptr<datagram_channel_impl> _impl;
@@ -129,6 +135,20 @@ class datagram_channel {
     future<datagram> receive();
     future<> send(const socket_address& dst, const char* msg);
     future<> send(const socket_address& dst, packet p);
+    /// Waits for at least one datagram and returns it together with any others
+    /// that are already queued on the channel.
+    ///
+    /// At most \c max datagrams are read from the network in one go. On stacks
+    /// that coalesce consecutive datagrams in the kernel (UDP GRO) each of
+    /// them is split back into its original datagrams, so the result may hold
+    /// more than \c max entries.
+    future<std::vector<datagram>> receive_batch(size_t max);
+    /// Sends all datagrams in \c batch, in order, using as few system calls as
+    /// the stack allows.
+    ///
+    /// The returned future resolves once every datagram has been handed to the
+    /// network stack.
+    future<> send_batch(std::vector<outgoing_datagram> batch);
     bool is_closed() const;
     /// Causes a pending receive() to complete (possibly with an exception)
     void shutdown_input();
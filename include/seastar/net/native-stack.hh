@@ -76,6 +76,19 @@ struct native_stack_options : public program_options::option_group {
     ///
     /// Default: \p on.
     program_options::value<std::string> lro;
+    /// \brief TCP congestion control algorithm.
+    ///
+    /// Values:
+    /// * \p reno: RFC 5681 slow start and congestion avoidance
+    /// * \p cubic: RFC 8312 CUBIC, keeps high bandwidth-delay product links busy after losses
+    /// * \p bbr: BBR, sizes the congestion window after the measured bandwidth and round-trip time
+    ///
+    /// Default: \p reno.
+    program_options::value<std::string> tcp_congestion_control;
+    /// \brief Offer TCP selective acknowledgments (SACK) and recover from losses with them.
+    ///
+    /// Default: \p false.
+    program_options::value<bool> tcp_sack;
 
     /// Virtio configuration.
     virtio_options virtio_opts;
@@ -79,6 +79,10 @@ class datagram_channel_impl {
     virtual future<datagram> receive() = 0;
     virtual future<> send(const socket_address& dst, const char* msg) = 0;
     virtual future<> send(const socket_address& dst, packet p) = 0;
+    // The default implementations fall back to receive() and send() one
+    // datagram at a time.
+    virtual future<std::vector<datagram>> receive_batch(size_t max);
+    virtual future<> send_batch(std::vector<outgoing_datagram> batch);
     virtual void shutdown_input() = 0;
     virtual void shutdown_output() = 0;
     virtual bool is_closed() const = 0;
@@ -0,0 +1,84 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2026 ScyllaDB
+ */
+
+#pragma once
+
+#ifndef SEASTAR_MODULE
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string_view>
+#endif
+
+namespace seastar {
+
+namespace net {
+
+// Congestion window of a connection, handed to its congestion controller
+struct tcp_congestion_window {
+    uint32_t& cwnd;
+    uint32_t& ssthresh;
+    uint32_t mss;
+};
+
+// New data acknowledged by the peer
+struct tcp_ack_sample {
+    uint32_t acked_bytes;
+    // Bytes sent and not yet acknowledged, after this acknowledgment
+    uint32_t in_flight;
+    // Smoothed round-trip time of the connection
+    std::chrono::milliseconds srtt;
+    // The connection is in fast recovery
+    bool in_recovery;
+};
+
+// Congestion control algorithm of a native stack TCP connection
+//
+// Each connection owns an instance. The connection detects the losses
+// and recovers from them (fast retransmit with NewReno, or SACK based
+// recovery when the peer supports it), and lets the controller size the
+// congestion window and the slow start threshold along the way.
+class tcp_congestion_control {
+public:
+    virtual ~tcp_congestion_control() = default;
+    virtual const char* name() const noexcept = 0;
+    // Called for every segment acknowledged
+    virtual void on_ack(tcp_congestion_window w, const tcp_ack_sample& s) = 0;
+    // Called when duplicate ACKs signal a loss, sets the slow start
+    // threshold fast recovery runs with
+    virtual void on_loss(tcp_congestion_window w, uint32_t in_flight) = 0;
+    // Called when the retransmission timer expires, \c first is false when
+    // the segment has already been retransmitted by the timer
+    virtual void on_timeout(tcp_congestion_window w, uint32_t in_flight, bool first) = 0;
+    // Called when all the data in flight at the time of the loss is acknowledged
+    virtual void on_recovery_end(tcp_congestion_window w, uint32_t in_flight) = 0;
+};
+
+using tcp_congestion_control_factory = std::function<std::unique_ptr<tcp_congestion_control> ()>;
+
+// Makes a congestion controller by name, one of "reno" (RFC 5681), "cubic"
+// (RFC 8312) or "bbr". Throws std::invalid_argument on unknown names.
+std::unique_ptr<tcp_congestion_control> make_tcp_congestion_control(std::string_view name);
+
+}
+
+}
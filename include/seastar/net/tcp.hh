@@ -22,6 +22,8 @@
 #pragma once
 
 #ifndef SEASTAR_MODULE
+#include <algorithm>
+#include <array>
 #include <unordered_map>
 #include <map>
 #include <functional>
@@ -29,6 +31,8 @@
 #include <chrono>
 #include <random>
 #include <stdexcept>
+#include <string>
+#include <string_view>
 #include <system_error>
 #include <gnutls/crypto.h>
 #endif
@@ -42,6 +46,7 @@
 #include <seastar/net/ip.hh>
 #include <seastar/net/const.hh>
 #include <seastar/net/packet-util.hh>
+#include <seastar/net/tcp-congestion.hh>
 #include <seastar/util/assert.hh>
 #include <seastar/util/std-compat.hh>
 
@@ -96,7 +101,7 @@ void tcp_debug(const char* fmt, Args&&... args) {
 
 struct tcp_option {
     // The kind and len field are fixed and defined in TCP protocol
-    enum class option_kind: uint8_t { mss = 2, win_scale = 3, sack = 4, timestamps = 8,  nop = 1, eol = 0 };
+    enum class option_kind: uint8_t { mss = 2, win_scale = 3, sack = 4, sack_blocks = 5, timestamps = 8,  nop = 1, eol = 0 };
     enum class option_len:  uint8_t { mss = 4, win_scale = 3, sack = 2, timestamps = 10, nop = 1, eol = 1 };
     static void write(char* p, option_kind kind, option_len len) {
         p[0] = static_cast<uint8_t>(kind);
@@ -142,6 +147,39 @@ struct tcp_option {
             tcp_option::write(p, kind, len);
         }
     };
+    // RFC2018 blocks of data received above a hole, the sack option above
+    // is the SACK-permitted one sent on SYNs
+    struct sack_blocks {
+        static constexpr option_kind kind = option_kind::sack_blocks;
+        // Fits in the option space along with the padding
+        static constexpr uint8_t max_blocks = 4;
+        struct block {
+            uint32_t left;
+            uint32_t right;
+        };
+        std::array<block, max_blocks> blocks{};
+        uint8_t nr = 0;
+        uint8_t len() const {
+            return 2 + nr * 8;
+        }
+        static tcp_option::sack_blocks read(const char* p) {
+            tcp_option::sack_blocks x;
+            x.nr = std::min((uint8_t(p[1]) - 2) / 8, int(max_blocks));
+            for (unsigned i = 0; i < x.nr; i++) {
+                x.blocks[i].left = read_be<uint32_t>(p + 2 + i * 8);
+                x.blocks[i].right = read_be<uint32_t>(p + 6 + i * 8);
+            }
+            return x;
+        }
+        void write(char* p) const {
+            p[0] = static_cast<uint8_t>(kind);
+            p[1] = len();
+            for (unsigned i = 0; i < nr; i++) {
+                write_be<uint32_t>(p + 2 + i * 8, blocks[i].left);
+                write_be<uint32_t>(p + 6 + i * 8, blocks[i].right);
+            }
+        }
+    };
     struct timestamps {
         static constexpr option_kind kind = option_kind::timestamps;
         static constexpr option_len len = option_len::timestamps;
@@ -178,18 +216,27 @@ struct tcp_option {
     void parse(uint8_t* beg, uint8_t* end);
     uint8_t fill(void* h, const tcp_hdr* th, uint8_t option_size);
     uint8_t get_size(bool syn_on, bool ack_on);
+    // Looks for SACK blocks in the options of a segment, unlike parse() it
+    // leaves the negotiated options alone
+    static sack_blocks parse_sack_blocks(const uint8_t* beg, const uint8_t* end);
+    bool sack_permitted() const {
+        return _sack_enabled && _sack_received;
+    }
 
     // For option negotiattion
     bool _mss_received = false;
     bool _win_scale_received = false;
     bool _timestamps_received = false;
     bool _sack_received = false;
+    bool _sack_enabled = true;
 
     // Option data
     uint16_t _remote_mss = 536;
     uint16_t _local_mss;
     uint8_t _remote_win_scale = 0;
     uint8_t _local_win_scale = 0;
+    // Sent along with the ACKs once SACK is permitted
+    sack_blocks _local_sack_blocks;
 };
 inline char*& operator+=(char*& x, tcp_option::option_len len) { x += uint8_t(len); return x; }
 inline const char*& operator+=(const char*& x, tcp_option::option_len len) { x += uint8_t(len); return x; }
@@ -327,6 +374,14 @@ class tcp {
             uint16_t data_len;
             unsigned nr_transmits;
             clock_type::time_point tx_time;
+            // Sequence number of the first byte still unacknowledged
+            tcp_seq seq;
+            // Scoreboard for loss recovery (RFC6675): the peer reported it
+            // has the segment, the segment is presumed lost, the segment was
+            // retransmitted since it's been presumed lost
+            bool sacked = false;
+            bool lost = false;
+            bool retransmitted = false;
         };
         struct send {
             tcp_seq unacknowledged;
@@ -367,6 +422,28 @@ class tcp {
             uint32_t limited_transfer = 0;
             uint32_t partial_ack = 0;
             tcp_seq recover;
+            // Lost segments are retransmitted as the congestion window
+            // allows, after a timeout or fast retransmit with SACK
+            bool loss_recovery = false;
+            // Loss recovery was entered on duplicate ACKs, with the lost
+            // segments told by the SACK blocks, rather than on a timeout
+            bool sack_recovery = false;
+            // Data in flight during loss recovery
+            uint32_t pipe = 0;
+            // The scoreboard is kept up to date as the ACKs change it, so
+            // an ACK costs the segments it changes rather than a walk of
+            // the window. Bytes SACKed, and of them those at or above
+            // lost_end, which only loss recovery keeps track of
+            uint32_t sacked_bytes = 0;
+            uint32_t sacked_above_lost_end = 0;
+            // Bytes presumed lost and not retransmitted yet
+            uint32_t lost_bytes = 0;
+            // The segments below were checked for loss, and the lost ones
+            // below retransmit_next were retransmitted
+            tcp_seq lost_end{};
+            tcp_seq retransmit_next{};
+            // The SACK blocks of the previous ACK, already on the scoreboard
+            tcp_option::sack_blocks last_sack;
             bool window_probe = false;
             uint8_t zero_window_probing_out = 0;
         } _snd;
@@ -381,12 +458,15 @@ class tcp {
             // The total size of data stored in std::deque<packet> data
             size_t data_size = 0;
             tcp_packet_merger out_of_order;
+            // Reported in the first SACK block
+            tcp_seq last_out_of_order;
             std::optional<promise<>> _data_received_promise;
             // The maximun memory buffer size allowed for receiving
             // Currently, it is the same as default receive window size when window scaling is enabled
             size_t max_receive_buf_size = 3737600;
         } _rcv;
         tcp_option _option;
+        std::unique_ptr<tcp_congestion_control> _cc;
         timer<lowres_clock> _delayed_ack;
         // Retransmission timeout
         std::chrono::milliseconds _rto{1000};
@@ -480,6 +560,13 @@ class tcp {
         bool should_send_ack(uint16_t seg_len);
         void clear_delayed_ack() noexcept;
         packet get_transmit_packet();
+        void output_segment(packet p, std::optional<tcp_seq> retransmit_seq);
+        void update_sack_blocks();
+        void update_scoreboard(const tcp_option::sack_blocks& sack);
+        void mark_sacked(unacked_segment& seg);
+        void scoreboard_acked(const unacked_segment& seg, uint32_t len);
+        void reset_scoreboard();
+        void retransmit_lost();
         void retransmit_one() {
             bool data_retransmit = true;
             output_one(data_retransmit);
@@ -511,6 +598,9 @@ class tcp {
         void fast_retransmit();
         void update_rto(clock_type::time_point tx_time);
         void update_cwnd(uint32_t acked_bytes);
+        tcp_congestion_window congestion_window() {
+            return {_snd.cwnd, _snd.ssthresh, _snd.mss};
+        }
         void cleanup();
         uint32_t can_send() {
             if (_snd.window_probe) {
@@ -532,18 +622,24 @@ class tcp {
             auto x = std::min(_snd.window - window_used, _snd.unsent_len);
 
             // Can not send more than congestion window allows
-            x = std::min(_snd.cwnd, x);
-            if (_snd.dupacks == 1 || _snd.dupacks == 2) {
+            if (_snd.loss_recovery) {
+                // RFC6675: the data in flight doesn't include the lost segments
+                x = _snd.pipe < _snd.cwnd ? std::min(_snd.cwnd - _snd.pipe, x) : 0;
+            } else if (_snd.dupacks == 1 || _snd.dupacks == 2) {
                 // RFC5681 Step 3.1
                 // Send cwnd + 2 * smss per RFC3042
+                x = std::min(_snd.cwnd, x);
                 auto flight = flight_size();
                 auto max = _snd.cwnd + 2 * _snd.mss;
                 x = flight <= max ? std::min(x, max - flight) : 0;
                 _snd.limited_transfer += x;
-            } else if (_snd.dupacks >= 3) {
-                // RFC5681 Step 3.5
-                // Sent 1 full-sized segment at most
-                x = std::min(uint32_t(_snd.mss), x);
+            } else {
+                x = window_used < _snd.cwnd ? std::min(_snd.cwnd - window_used, x) : 0;
+                if (_snd.dupacks >= 3) {
+                    // RFC5681 Step 3.5
+                    // Sent 1 full-sized segment at most
+                    x = std::min(uint32_t(_snd.mss), x);
+                }
             }
             return x;
         }
@@ -649,6 +745,15 @@ class tcp {
             _snd.limited_transfer = 0;
             _snd.partial_ack = 0;
         }
+        void exit_loss_recovery() {
+            _snd.loss_recovery = false;
+            _snd.sack_recovery = false;
+            for (auto& seg : _snd.data) {
+                seg.lost = false;
+                seg.retransmitted = false;
+            }
+            reset_scoreboard();
+        }
         uint32_t data_segment_acked(tcp_seq seg_ack);
         bool segment_acceptable(tcp_seq seg_seq, unsigned seg_len);
         void init_from_options(tcp_hdr* th, uint8_t* opt_start, uint8_t* opt_end);
@@ -665,6 +770,10 @@ class tcp {
     circular_buffer<ipv4_traits::l4packet> _packetq;
     semaphore _queue_space = {212992};
     metrics::metric_groups _metrics;
+    tcp_congestion_control_factory _congestion_control;
+    bool _sack = false;
+    uint64_t _sack_retransmits = 0;
+    uint64_t _timeout_retransmits = 0;
 public:
     const inet_type& inet() const {
         return _inet;
@@ -762,6 +871,28 @@ class tcp {
     bool forward(forward_hash& out_hash_data, packet& p, size_t off);
     listener listen(uint16_t port, size_t queue_length = 100);
     connection connect(socket_address sa);
+    // The congestion controller of the connections opened from now on,
+    // Reno by default
+    void set_congestion_control(tcp_congestion_control_factory factory) {
+        _congestion_control = std::move(factory);
+    }
+    void set_congestion_control(std::string_view name) {
+        // Fail on unknown names now rather than on connection
+        make_tcp_congestion_control(name);
+        set_congestion_control([name = std::string(name)] { return make_tcp_congestion_control(name); });
+    }
+    // Whether the connections opened from now on offer SACK, off by default
+    void set_sack(bool enabled) {
+        _sack = enabled;
+    }
+    // Data segments retransmitted in SACK based loss recovery, before
+    // any timeout, and after retransmission timeouts
+    uint64_t sack_retransmits() const noexcept {
+        return _sack_retransmits;
+    }
+    uint64_t timeout_retransmits() const noexcept {
+        return _timeout_retransmits;
+    }
     const net::hw_features& hw_features() const { return _inet._inet.hw_features(); }
     future<> poll_tcb(ipaddr to, lw_shared_ptr<tcb> tcb);
     void add_connected_tcb(lw_shared_ptr<tcb> tcbp, uint16_t local_port) {
@@ -786,7 +917,11 @@ tcp<InetTraits>::tcp(inet_type& inet)
     _metrics.add_group("tcp", {
         sm::make_counter("linearizations", [] { return tcp_packet_merger::linearizations(); },
                         sm::description("Counts a number of times a buffer linearization was invoked during the buffers merge process. "
-                                        "Divide it by a total TCP receive packet rate to get an everage number of lineraizations per TCP packet."))
+                                        "Divide it by a total TCP receive packet rate to get an everage number of lineraizations per TCP packet.")),
+        sm::make_counter("sack_retransmits", _sack_retransmits,
+                        sm::description("Counts data segments retransmitted because SACK blocks showed them lost, before the retransmission timeout")),
+        sm::make_counter("timeout_retransmits", _timeout_retransmits,
+                        sm::description("Counts data segments retransmitted after a retransmission timeout")),
     });
 
     _inet.register_packet_provider([this, tcb_polled = 0u] () mutable {
@@ -968,9 +1103,11 @@ tcp<InetTraits>::tcb::tcb(tcp& t, connid id)
     , _foreign_ip(id.foreign_ip)
     , _local_port(id.local_port)
     , _foreign_port(id.foreign_port)
+    , _cc(t._congestion_control ? t._congestion_control() : make_tcp_congestion_control("reno"))
     , _delayed_ack([this] { _nr_full_seg_received = 0; output(); })
     , _retransmit([this] { retransmit(); })
     , _persist([this] { persist(); }) {
+    _option._sack_enabled = t._sack;
 }
 
 template <typename InetTraits>
@@ -1038,6 +1175,7 @@ uint32_t tcp<InetTraits>::tcb::data_segment_acked(tcp_seq seg_ack) {
         total_acked_bytes += acked_bytes;
         _snd.current_queue_space -= _snd.data.front().data_len;
         signal_send_available();
+        scoreboard_acked(_snd.data.front(), acked_bytes);
         _snd.data.pop_front();
     }
     // Partial ACK of segment
@@ -1045,12 +1183,20 @@ uint32_t tcp<InetTraits>::tcb::data_segment_acked(tcp_seq seg_ack) {
         auto acked_bytes = seg_ack - _snd.unacknowledged;
         if (!_snd.data.empty()) {
             auto& unacked_seg = _snd.data.front();
+            scoreboard_acked(unacked_seg, acked_bytes);
             unacked_seg.p.trim_front(acked_bytes);
+            unacked_seg.seq = seg_ack;
         }
         _snd.unacknowledged = seg_ack;
         update_cwnd(acked_bytes);
         total_acked_bytes += acked_bytes;
     }
+    if (_snd.lost_end < _snd.unacknowledged) {
+        _snd.lost_end = _snd.unacknowledged;
+    }
+    if (_snd.retransmit_next < _snd.unacknowledged) {
+        _snd.retransmit_next = _snd.unacknowledged;
+    }
     return total_acked_bytes;
 }
 
@@ -1213,6 +1359,13 @@ void tcp<InetTraits>::tcb::input_handle_syn_sent_state(tcp_hdr* th, packet p) {
 
 template <typename InetTraits>
 void tcp<InetTraits>::tcb::input_handle_other_state(tcp_hdr* th, packet p) {
+    tcp_option::sack_blocks sack;
+    if (_option.sack_permitted() && th->data_offset * 4 > tcp_hdr::len) {
+        auto opt_start = reinterpret_cast<uint8_t*>(p.get_header(0, th->data_offset * 4));
+        if (opt_start) {
+            sack = tcp_option::parse_sack_blocks(opt_start + tcp_hdr::len, opt_start + th->data_offset * 4);
+        }
+    }
     p.trim_front(th->data_offset * 4);
     bool do_output = false;
     bool do_output_data = false;
@@ -1332,6 +1485,9 @@ void tcp<InetTraits>::tcb::input_handle_other_state(tcp_hdr* th, packet p) {
         if (in_state(ESTABLISHED | CLOSE_WAIT)){
             // When we are in zero window probing phase and packets_out = 0 we bypass "duplicated ack" check
             auto packets_out = _snd.next - _snd.unacknowledged - _snd.zero_window_probing_out;
+            if (sack.nr) {
+                update_scoreboard(sack);
+            }
             // If SND.UNA < SEG.ACK =< SND.NXT then, set SND.UNA <- SEG.ACK.
             if (_snd.unacknowledged < seg_ack && seg_ack <= _snd.next) {
                 // Remote ACKed data we sent
@@ -1357,13 +1513,24 @@ void tcp<InetTraits>::tcb::input_handle_other_state(tcp_hdr* th, packet p) {
                     }
                 };
 
-                if (_snd.dupacks >= 3) {
+                if (_snd.loss_recovery) {
+                    if (seg_ack > _snd.recover) {
+                        tcp_debug("ack: loss recovery done\n");
+                        if (_snd.dupacks >= 3) {
+                            _cc->on_recovery_end(congestion_window(), flight_size());
+                        }
+                        exit_loss_recovery();
+                        exit_fast_recovery();
+                    } else {
+                        retransmit_lost();
+                    }
+                    set_retransmit_timer();
+                } else if (_snd.dupacks >= 3) {
                     // We are in fast retransmit / fast recovery phase
                     uint32_t smss = _snd.mss;
                     if (seg_ack > _snd.recover) {
                         tcp_debug("ack: full_ack\n");
-                        // Set cwnd to min (ssthresh, max(FlightSize, SMSS) + SMSS)
-                        _snd.cwnd = std::min(_snd.ssthresh, std::max(flight_size(), smss) + smss);
+                        _cc->on_recovery_end(congestion_window(), flight_size());
                         // Exit the fast recovery procedure
                         exit_fast_recovery();
                         set_retransmit_timer();
@@ -1398,6 +1565,13 @@ void tcp<InetTraits>::tcb::input_handle_other_state(tcp_hdr* th, packet p) {
                     exit_fast_recovery();
                     set_retransmit_timer();
                 }
+            } else if (_snd.loss_recovery && !_snd.data.empty() && seg_len == 0 &&
+                th->ack == _snd.unacknowledged &&
+                uint32_t(th->window << _snd.window_scale) == _snd.window) {
+                // The duplicate ACK may have SACKed more data, and it left the
+                // network, both of which can let more lost segments through
+                retransmit_lost();
+                do_output_data = true;
             } else if ((packets_out > 0) && !_snd.data.empty() && seg_len == 0 &&
                 th->f_fin == 0 && th->f_syn == 0 &&
                 th->ack == _snd.unacknowledged &&
@@ -1421,13 +1595,32 @@ void tcp<InetTraits>::tcb::input_handle_other_state(tcp_hdr* th, packet p) {
                     if (seg_ack - 1 > _snd.recover) {
                         _snd.recover = _snd.next - 1;
                         // RFC5681 Step 3.2
-                        _snd.ssthresh = std::max((flight_size() - _snd.limited_transfer) / 2, 2 * smss);
-                        fast_retransmit();
+                        _cc->on_loss(congestion_window(), flight_size() - _snd.limited_transfer);
+                        if (_option.sack_permitted()) {
+                            // RFC6675: retransmit the first segment, then the
+                            // others the SACK blocks show lost as the data in
+                            // flight drops below cwnd
+                            _snd.cwnd = _snd.ssthresh;
+                            reset_scoreboard();
+                            auto& unacked_seg = _snd.data.front();
+                            unacked_seg.lost = true;
+                            unacked_seg.retransmitted = true;
+                            _snd.loss_recovery = true;
+                            _snd.sack_recovery = true;
+                            _tcp._sack_retransmits++;
+                            fast_retransmit();
+                            retransmit_lost();
+                            do_output_data = true;
+                        } else {
+                            fast_retransmit();
+                        }
                     } else {
                         // Do not enter fast retransmit and do not reset ssthresh
                     }
-                    // RFC5681 Step 3.3
-                    _snd.cwnd = _snd.ssthresh + 3 * smss;
+                    if (!_snd.loss_recovery) {
+                        // RFC5681 Step 3.3
+                        _snd.cwnd = _snd.ssthresh + 3 * smss;
+                    }
                 } else if (_snd.dupacks > 3) {
                     // RFC5681 Step 3.4
                     _snd.cwnd += smss;
@@ -1587,7 +1780,8 @@ packet tcp<InetTraits>::tcb::get_transmit_packet() {
         // FIXME: Info tap device the size of the splitted packet
         len = _tcp.hw_features().max_packet_len - net::tcp_hdr_len_min - InetTraits::ip_hdr_len_min;
     } else {
-        len = std::min(uint16_t(_tcp.hw_features().mtu - net::tcp_hdr_len_min - InetTraits::ip_hdr_len_min), _snd.mss);
+        auto options_size = _option.get_size(syn_needs_on(), ack_needs_on());
+        len = std::min(uint16_t(_tcp.hw_features().mtu - net::tcp_hdr_len_min - InetTraits::ip_hdr_len_min - options_size), _snd.mss);
     }
     can_send = std::min(can_send, len);
     // easy case: one small packet
@@ -1629,7 +1823,21 @@ void tcp<InetTraits>::tcb::output_one(bool data_retransmit) {
         return;
     }
 
-    packet p = data_retransmit ? _snd.data.front().p.share() : get_transmit_packet();
+    if (data_retransmit) {
+        output_segment(_snd.data.front().p.share(), _snd.unacknowledged);
+    } else {
+        update_sack_blocks();
+        output_segment(get_transmit_packet(), std::nullopt);
+    }
+}
+
+template <typename InetTraits>
+void tcp<InetTraits>::tcb::output_segment(packet p, std::optional<tcp_seq> retransmit_seq) {
+    bool data_retransmit = bool(retransmit_seq);
+    if (data_retransmit) {
+        // The segment was sized without room for them
+        _option._local_sack_blocks.nr = 0;
+    }
     packet clone = p.share();  // early clone to prevent share() from calling packet::unuse_internal_data() on header.
     uint16_t len = p.len();
     bool syn_on = syn_needs_on();
@@ -1652,7 +1860,7 @@ void tcp<InetTraits>::tcb::output_one(bool data_retransmit) {
 
     tcp_seq seq;
     if (data_retransmit) {
-        seq = _snd.unacknowledged;
+        seq = *retransmit_seq;
     } else {
         seq = syn_on ? _snd.initial : _snd.next;
         _snd.next += len;
@@ -1664,7 +1872,9 @@ void tcp<InetTraits>::tcb::output_one(bool data_retransmit) {
     h.checksum = 0;
 
     // FIXME: does the FIN have to fit in the window?
-    bool fin_on = fin_needs_on();
+    // Only the last segment carries it, a retransmission from the middle
+    // of the window with FIN would end the stream early
+    bool fin_on = fin_needs_on() && seq + len == _snd.next;
     h.f_fin = fin_on;
 
     // Add tcp options
@@ -1720,13 +1930,15 @@ void tcp<InetTraits>::tcb::output_one(bool data_retransmit) {
         if (len) {
             unsigned nr_transmits = 0;
             _snd.data.emplace_back(unacked_segment{std::move(clone),
-                                   len, nr_transmits, now});
+                                   len, nr_transmits, now, seq});
         }
         if (!_retransmit.armed()) {
             start_retransmit_timer(now);
         }
     }
-
+    if (_snd.loss_recovery) {
+        _snd.pipe += len;
+    }
 
     // if advertised TCP receive window is 0 we may only transmit zero window probing segment.
     // Payload size of this segment is 1. Queueing anything bigger when _snd.window == 0 is bug
@@ -1931,9 +2143,162 @@ bool tcp<InetTraits>::tcb::merge_out_of_order() {
 
 template <typename InetTraits>
 void tcp<InetTraits>::tcb::insert_out_of_order(tcp_seq seg, packet p) {
+    _rcv.last_out_of_order = seg;
     _rcv.out_of_order.merge(seg, std::move(p));
 }
 
+template <typename InetTraits>
+void tcp<InetTraits>::tcb::update_sack_blocks() {
+    auto& sack = _option._local_sack_blocks;
+    sack.nr = 0;
+    if (!_option.sack_permitted() || syn_needs_on() || _rcv.out_of_order.map.empty()) {
+        return;
+    }
+    auto& map = _rcv.out_of_order.map;
+    auto add_block = [&sack] (auto it) {
+        sack.blocks[sack.nr++] = {it->first.raw, (it->first + it->second.len()).raw};
+    };
+    // RFC2018: the first block holds the segment received last, so that the
+    // peer learns about it even if the ACKs before this one were lost
+    auto last = std::find_if(map.begin(), map.end(), [this] (auto& x) {
+        return x.first <= _rcv.last_out_of_order && _rcv.last_out_of_order < x.first + x.second.len();
+    });
+    if (last != map.end()) {
+        add_block(last);
+    }
+    for (auto it = map.begin(); it != map.end() && sack.nr < sack.max_blocks; ++it) {
+        if (it != last) {
+            add_block(it);
+        }
+    }
+}
+
+template <typename InetTraits>
+void tcp<InetTraits>::tcb::update_scoreboard(const tcp_option::sack_blocks& sack) {
+    auto last = std::exchange(_snd.last_sack, sack);
+    for (unsigned i = 0; i < sack.nr; i++) {
+        auto left = make_seq(sack.blocks[i].left);
+        auto right = make_seq(sack.blocks[i].right);
+        // Skip the blocks reporting duplicates (RFC2883) and the bogus ones
+        if (right <= _snd.unacknowledged || right > _snd.next || left >= right) {
+            continue;
+        }
+        // The peer repeats the blocks ACK after ACK as they grow, so only
+        // the parts the previous ACK didn't report can have news
+        auto from = left;
+        while (from < right) {
+            auto to = right;
+            bool reported = false;
+            for (unsigned j = 0; j < last.nr; j++) {
+                auto last_left = make_seq(last.blocks[j].left);
+                auto last_right = make_seq(last.blocks[j].right);
+                if (last_left <= from && from < last_right) {
+                    from = last_right;
+                    reported = true;
+                    break;
+                }
+                if (from < last_left && last_left < to) {
+                    to = last_left;
+                }
+            }
+            if (reported) {
+                continue;
+            }
+            auto it = std::partition_point(_snd.data.begin(), _snd.data.end(), [from] (const unacked_segment& seg) {
+                return seg.seq + seg.p.len() <= from;
+            });
+            for (; it != _snd.data.end() && it->seq < to; ++it) {
+                if (!it->sacked && left <= it->seq && it->seq + it->p.len() <= right) {
+                    mark_sacked(*it);
+                }
+            }
+            from = to;
+        }
+    }
+}
+
+template <typename InetTraits>
+void tcp<InetTraits>::tcb::mark_sacked(unacked_segment& seg) {
+    auto len = seg.p.len();
+    seg.sacked = true;
+    _snd.sacked_bytes += len;
+    if (_snd.loss_recovery && seg.seq >= _snd.lost_end) {
+        _snd.sacked_above_lost_end += len;
+    }
+    if (seg.lost && !seg.retransmitted) {
+        _snd.lost_bytes -= len;
+    }
+}
+
+template <typename InetTraits>
+void tcp<InetTraits>::tcb::scoreboard_acked(const unacked_segment& seg, uint32_t len) {
+    if (seg.sacked) {
+        _snd.sacked_bytes -= len;
+        if (_snd.loss_recovery && seg.seq >= _snd.lost_end) {
+            _snd.sacked_above_lost_end -= len;
+        }
+    } else if (seg.lost && !seg.retransmitted) {
+        _snd.lost_bytes -= len;
+    }
+}
+
+template <typename InetTraits>
+void tcp<InetTraits>::tcb::reset_scoreboard() {
+    _snd.lost_bytes = 0;
+    _snd.lost_end = _snd.unacknowledged;
+    _snd.retransmit_next = _snd.unacknowledged;
+    _snd.sacked_above_lost_end = _snd.sacked_bytes;
+}
+
+template <typename InetTraits>
+void tcp<InetTraits>::tcb::retransmit_lost() {
+    // RFC6675 IsLost(): a segment is presumed lost once more than
+    // (DupThresh - 1) * SMSS bytes above it are SACKed. That holds for the
+    // lowest segments first and stays true, so each segment is checked
+    // once, from lost_end up.
+    auto by_seq = [] (const unacked_segment& seg, tcp_seq seq) {
+        return seg.seq < seq;
+    };
+    auto it = std::lower_bound(_snd.data.begin(), _snd.data.end(), _snd.lost_end, by_seq);
+    for (; it != _snd.data.end(); ++it) {
+        auto len = it->p.len();
+        if (it->sacked) {
+            _snd.sacked_above_lost_end -= len;
+        } else if (_snd.sacked_above_lost_end > 2 * uint32_t(_snd.mss)) {
+            if (!it->lost) {
+                it->lost = true;
+                _snd.lost_bytes += len;
+            }
+        } else {
+            break;
+        }
+        _snd.lost_end = it->seq + len;
+    }
+    // The data in flight doesn't include what was SACKed or is lost
+    _snd.pipe = uint32_t(_snd.next - _snd.unacknowledged) - _snd.sacked_bytes - _snd.lost_bytes;
+
+    // Retransmit the lowest lost segments first, as cwnd allows
+    it = std::lower_bound(_snd.data.begin(), _snd.data.end(), _snd.retransmit_next, by_seq);
+    for (; it != _snd.data.end() && it->seq < _snd.lost_end; ++it) {
+        if (it->lost && !it->retransmitted && !it->sacked) {
+            if (_snd.pipe >= _snd.cwnd) {
+                break;
+            }
+            it->retransmitted = true;
+            it->nr_transmits++;
+            _snd.lost_bytes -= it->p.len();
+            if (_snd.sack_recovery) {
+                _tcp._sack_retransmits++;
+            } else {
+                _tcp._timeout_retransmits++;
+            }
+            output_segment(it->p.share(), it->seq);
+        }
+        _snd.retransmit_next = it->seq + it->p.len();
+    }
+    output();
+}
+
 template <typename InetTraits>
 void tcp<InetTraits>::tcb::trim_receive_data_after_window() {
     abort();
@@ -1992,21 +2357,35 @@ void tcp<InetTraits>::tcb::retransmit() {
     // If there are unacked data, retransmit the earliest segment
     auto& unacked_seg = _snd.data.front();
 
-    // According to RFC5681
-    // Update ssthresh only for the first retransmit
-    uint32_t smss = _snd.mss;
-    if (unacked_seg.nr_transmits == 0) {
-        _snd.ssthresh = std::max(flight_size() / 2, 2 * smss);
-    }
+    _cc->on_timeout(congestion_window(), flight_size(), unacked_seg.nr_transmits == 0);
     // RFC6582 Step 4
     _snd.recover = _snd.next - 1;
-    // Start the slow start process
-    _snd.cwnd = smss;
     // End fast recovery
     exit_fast_recovery();
+    // All the data in flight but what the peer reported having is presumed
+    // lost, and is retransmitted as cwnd grows back
+    reset_scoreboard();
+    for (auto& seg : _snd.data) {
+        seg.lost = !seg.sacked;
+        seg.retransmitted = false;
+        if (seg.lost) {
+            _snd.lost_bytes += seg.p.len();
+        }
+    }
+    if (unacked_seg.lost) {
+        _snd.lost_bytes -= unacked_seg.p.len();
+    }
+    unacked_seg.lost = true;
+    unacked_seg.retransmitted = true;
+    _snd.lost_end = _snd.next;
+    _snd.sacked_above_lost_end = 0;
+    _snd.loss_recovery = true;
+    _snd.sack_recovery = false;
+    _snd.pipe = 0;
 
     if (unacked_seg.nr_transmits < _max_nr_retransmit) {
         unacked_seg.nr_transmits++;
+        _tcp._timeout_retransmits++;
     } else {
         // Delete connection when max num of retransmission is reached
         do_reset();
@@ -2055,15 +2434,8 @@ void tcp<InetTraits>::tcb::update_rto(clock_type::time_point tx_time) {
 
 template <typename InetTraits>
 void tcp<InetTraits>::tcb::update_cwnd(uint32_t acked_bytes) {
-    uint32_t smss = _snd.mss;
-    if (_snd.cwnd < _snd.ssthresh) {
-        // In slow start phase
-        _snd.cwnd += std::min(acked_bytes, smss);
-    } else {
-        // In congestion avoidance phase
-        uint32_t round_up = 1;
-        _snd.cwnd += std::max(round_up, smss * smss / _snd.cwnd);
-    }
+    auto in_flight = uint32_t(_snd.next - _snd.unacknowledged);
+    _cc->on_ack(congestion_window(), tcp_ack_sample{acked_bytes, in_flight, _snd.srtt, _snd.dupacks >= 3});
 }
 
 template <typename InetTraits>
@@ -2118,10 +2490,11 @@ std::optional<typename InetTraits::l4packet> tcp<InetTraits>::tcb::get_packet()
 
     auto p = std::move(_packetq.front());
     _packetq.pop_front();
-    if (!_packetq.empty() || (_snd.dupacks < 3 && can_send() > 0 && (_snd.window > 0))) {
+    if (!_packetq.empty() || ((_snd.dupacks < 3 || _snd.loss_recovery) && can_send() > 0 && (_snd.window > 0))) {
         // If there are packets to send in the queue or tcb is allowed to send
         // more add tcp back to polling set to keep sending. In addition, dupacks >= 3
-        // is an indication that an segment is lost, stop sending more in this case.
+        // is an indication that an segment is lost, stop sending more in this case,
+        // unless loss recovery keeps track of the data in flight.
         // Finally - we can't send more until window is opened again.
         output();
     }
@@ -25,11 +25,14 @@
 #include <unordered_set>
 #include <map>
 #include <any>
+#include <chrono>
+#include <memory>
 #include <fmt/format.h>
 #endif
 
 #include <seastar/core/future.hh>
 #include <seastar/core/internal/api-level.hh>
+#include <seastar/core/scheduling.hh>
 #include <seastar/core/sstring.hh>
 #include <seastar/core/shared_ptr.hh>
 #include <seastar/net/socket_defs.hh>
@@ -42,6 +45,9 @@ namespace seastar {
 
 class socket;
 
+template <typename Service>
+class sharded;
+
 class server_socket;
 class connected_socket;
 class socket_address;
@@ -71,6 +77,7 @@ namespace tls {
     class server_credentials;
     class certificate_credentials;
     class credentials_builder;
+    class session_cache;
 
     /**
      * Diffie-Hellman parameters for
@@ -226,6 +233,28 @@ namespace tls {
          */
         void set_enable_certificate_verification(bool enable);
 
+        /**
+         * Opt in to kernel TLS (kTLS) for sessions using these credentials.
+         *
+         * Once the handshake completes, the keys gnutls negotiated are
+         * installed on the socket so the kernel encrypts the records
+         * written to it, instead of the reactor thread. Decryption stays
+         * in gnutls. Only posix stack TCP sockets qualify, with TLS 1.2 or
+         * 1.3 and an AES-GCM or ChaCha20-Poly1305 cipher; sessions the
+         * kernel can't take keep encrypting in userspace.
+         *
+         * An offloaded session can't renegotiate or answer a TLS 1.3 key
+         * update request, and it closes without sending a close_notify
+         * alert.
+         */
+        void set_enable_ktls(bool enable);
+
+        /**
+         * Keep resumable sessions in a cache shared by the shards, see
+         * session_cache. Pass the same sharded instance on every shard.
+         */
+        void set_session_cache(sharded<session_cache>& cache);
+
     private:
         class impl;
         friend class session;
@@ -286,6 +315,93 @@ namespace tls {
          * in preference order.
          */
         void set_alpn_protocols(const std::vector<sstring>& protocols);
+
+        /**
+         * Runs the handshakes of the sessions using these credentials
+         * under the given scheduling group, so that a storm of reconnects
+         * competes for the CPU with the group's shares instead of with
+         * the traffic of the established connections.
+         */
+        void set_handshake_scheduling_group(scheduling_group sg);
+
+        /**
+         * Limits the handshakes in progress on this shard. Handshakes
+         * past the limit wait for one to complete before doing any crypto.
+         * The limit counts whole handshakes, round trips to the peer
+         * included. Zero, the default, means no limit.
+         */
+        void set_max_concurrent_handshakes(size_t max);
+
+        /**
+         * Runs the steps of the handshakes, which is where the private key
+         * operations happen, in the reactor's syscall thread rather than
+         * in the reactor thread. Each step costs a round trip between the
+         * threads, and the steps of all the handshakes of a shard queue up
+         * on its syscall thread.
+         *
+         * Handshakes of credentials with a session cache are not offloaded,
+         * as gnutls looks sessions up in the cache during the steps.
+         *
+         * The syscall thread also runs the shard's blocking file operations
+         * (open, fsync, rename, ...) one at a time, so handshake steps wait
+         * behind them and delay them in turn. It suits shards doing little
+         * file metadata work.
+         *
+         * While steps are in flight, the credentials can't be modified in
+         * place and their setters throw std::logic_error. Reloadable
+         * credentials are not affected, a reload replaces the credentials
+         * instead of modifying them.
+         */
+        void set_offload_handshakes(bool offload);
+    };
+
+    /**
+     * Limits of a session_cache.
+     */
+    struct session_cache_options {
+        /// Upper bound on the sessions held by each shard, all shards hold
+        /// every session. The least recently used ones are dropped first
+        size_t max_entries = 10000;
+        /// Sessions older than that are dropped, and servers refuse to
+        /// resume them
+        std::chrono::seconds ttl = std::chrono::hours(6);
+    };
+
+    /**
+     * Cache of resumable TLS sessions, shared by the shards.
+     *
+     * Start it as a sharded<session_cache> and attach it to the
+     * credentials of every shard with
+     * certificate_credentials::set_session_cache. Sessions established
+     * on one shard are copied to the others in the background, so that a
+     * reconnect can resume on whatever shard it lands on.
+     *
+     * Servers keep the state of the sessions they establish, keyed by
+     * session ID, which is how TLS 1.2 clients without session tickets
+     * resume. Ticket based resumption needs no server side state, only
+     * the ticket key, which server credentials built from one
+     * credentials_builder share (see set_session_resume_mode).
+     *
+     * Clients keep the latest session data or ticket each server sent,
+     * keyed by tls_options::server_name, and resume from it on the next
+     * connection to that name which doesn't bring its own
+     * tls_options::session_resume_data. That covers the connections
+     * made by http::experimental::client and by rpc clients over TLS
+     * sockets, as long as they set the server name.
+     */
+    class session_cache {
+    public:
+        explicit session_cache(session_cache_options = {});
+        ~session_cache();
+
+        future<> stop();
+
+        /// Number of sessions held by this shard
+        size_t size() const noexcept;
+    private:
+        class impl;
+        friend class session;
+        std::unique_ptr<impl> _impl;
     };
 
     class reloadable_credentials_base;
@@ -336,6 +452,26 @@ namespace tls {
          */
         void set_alpn_protocols(const std::vector<sstring>& protocols);
 
+        /**
+         * Opt in to kernel TLS, see certificate_credentials::set_enable_ktls
+         */
+        void set_enable_ktls(bool enable);
+
+        /**
+         * Sets the session cache, see certificate_credentials::set_session_cache
+         */
+        void set_session_cache(sharded<session_cache>& cache);
+
+        /**
+         * Set how server credentials run handshakes, see
+         * server_credentials::set_handshake_scheduling_group,
+         * server_credentials::set_max_concurrent_handshakes and
+         * server_credentials::set_offload_handshakes
+         */
+        void set_handshake_scheduling_group(scheduling_group sg);
+        void set_max_concurrent_handshakes(size_t max);
+        void set_offload_handshakes(bool offload);
+
         void apply_to(certificate_credentials&) const;
 
         shared_ptr<certificate_credentials> build_certificate_credentials() const;
@@ -360,6 +496,11 @@ namespace tls {
         sstring _priority;
         std::vector<uint8_t> _session_resume_key;
         std::vector<sstring> _alpn_protocols;
+        bool _enable_ktls = false;
+        sharded<session_cache>* _session_cache = nullptr;
+        std::optional<scheduling_group> _handshake_sg;
+        size_t _max_concurrent_handshakes = 0;
+        bool _offload_handshakes = false;
     };
 
     using session_data = std::vector<uint8_t>;
@@ -571,6 +712,16 @@ namespace tls {
     */
     future<bool> check_session_is_resumed(connected_socket& socket);
 
+    /**
+     * Checks if the kernel encrypts the records sent on the socket,
+     * see certificate_credentials::set_enable_ktls.
+     * Will force handshake if not already done.
+     *
+     * If the socket is not connected a system_error exception will be thrown.
+     * If the socket is not a TLS socket an exception will be thrown.
+    */
+    future<bool> check_session_uses_ktls(connected_socket& socket);
+
     /**
      * Get session resume data from a connected client socket. Will force handshake if not already done.
      *
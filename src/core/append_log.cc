@@ -0,0 +1,231 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2026 ScyllaDB
+ */
+
+#include <algorithm>
+#include <deque>
+#include <stdexcept>
+#include <vector>
+#include <fmt/format.h>
+#include <seastar/core/append_log.hh>
+#include <seastar/core/align.hh>
+#include <seastar/core/coroutine.hh>
+#include <seastar/core/gate.hh>
+#include <seastar/core/semaphore.hh>
+
+namespace seastar {
+
+class append_log::impl {
+    struct record {
+        temporary_buffer<char> data;
+        uint64_t offset;
+        promise<uint64_t> done;
+    };
+
+    // Records committed with one write and one flush
+    struct group {
+        std::vector<record> records;
+        size_t bytes = 0;
+        semaphore_units<> units;
+    };
+
+    file _file;
+    const append_log_options _options;
+    uint64_t _size;
+    uint64_t _durable_size;
+    uint64_t _allocated;
+    // Contents of the last, partially written, block of the file. Each
+    // group rewrites that block, so it has to be kept in front of the
+    // group's data
+    temporary_buffer<char> _tail;
+    // The group being committed is not in there, appends go to the back
+    std::deque<group> _groups;
+    semaphore _pending;
+    gate _gate;
+    bool _committing = false;
+    future<> _committer = make_ready_future<>();
+    std::exception_ptr _failed;
+
+    future<> write_group(group& g);
+    future<> commit_groups() noexcept;
+
+public:
+    impl(file f, uint64_t size, append_log_options options)
+        : _file(std::move(f))
+        , _options(options)
+        , _size(size)
+        , _durable_size(size)
+        , _allocated(size)
+        , _pending(_options.max_pending_bytes)
+    {}
+
+    future<uint64_t> append(temporary_buffer<char> data);
+    future<> close() noexcept;
+
+    uint64_t size() const noexcept {
+        return _size;
+    }
+
+    uint64_t durable_size() const noexcept {
+        return _durable_size;
+    }
+};
+
+future<uint64_t> append_log::impl::append(temporary_buffer<char> data) {
+    auto holder = _gate.hold();
+    if (_failed) {
+        std::rethrow_exception(_failed);
+    }
+    auto units = co_await get_units(_pending, std::min(data.size(), _options.max_pending_bytes));
+    if (_failed) {
+        std::rethrow_exception(_failed);
+    }
+
+    auto size = data.size();
+    if (_groups.empty() || (!_groups.back().records.empty() && _groups.back().bytes + size > _options.max_group_size)) {
+        _groups.emplace_back();
+    }
+    auto& g = _groups.back();
+    g.records.push_back(record{std::move(data), _size, promise<uint64_t>()});
+    auto done = g.records.back().done.get_future();
+    g.bytes += size;
+    if (g.units) {
+        g.units.adopt(std::move(units));
+    } else {
+        g.units = std::move(units);
+    }
+    _size += size;
+
+    if (!_committing) {
+        _committing = true;
+        _committer = commit_groups();
+    }
+    co_return co_await std::move(done);
+}
+
+future<> append_log::impl::commit_groups() noexcept {
+    while (!_groups.empty()) {
+        auto g = std::move(_groups.front());
+        _groups.pop_front();
+        auto ex = _failed;
+        if (!ex) {
+            try {
+                co_await write_group(g);
+            } catch (...) {
+                ex = std::current_exception();
+                _failed = ex;
+            }
+        }
+        for (auto& r : g.records) {
+            if (ex) {
+                r.done.set_exception(ex);
+            } else {
+                r.done.set_value(r.offset);
+            }
+        }
+    }
+    _committing = false;
+}
+
+future<> append_log::impl::write_group(group& g) {
+    auto align = _file.disk_write_dma_alignment();
+    auto pos = align_down(_durable_size, align);
+    size_t tail = _durable_size - pos;
+    if (tail && _tail.empty()) {
+        // The log was opened with a partial last block
+        _tail = co_await _file.dma_read_exactly<char>(pos, tail);
+    }
+
+    auto len = align_up(tail + g.bytes, align);
+    auto buf = temporary_buffer<char>::aligned(_file.memory_dma_alignment(), len);
+    auto p = std::copy_n(_tail.get(), tail, buf.get_write());
+    for (auto& r : g.records) {
+        p = std::copy(r.data.begin(), r.data.end(), p);
+    }
+    std::fill(p, buf.get_write() + len, 0);
+
+    if (_options.preallocation_size && pos + len > _allocated) {
+        auto length = align_up(pos + len - _allocated, _options.preallocation_size);
+        co_await _file.allocate(_allocated, length);
+        _allocated += length;
+    }
+    // Retrying the rest of a short write would be unaligned, and a write
+    // that makes no progress would be retried forever
+    auto written = co_await _file.dma_write(pos, buf.get(), len);
+    if (written < len) {
+        throw std::runtime_error(fmt::format("short write to append log at {}: {} of {} bytes", pos, written, len));
+    }
+    co_await _file.flush();
+
+    _durable_size += g.bytes;
+    auto tail_pos = align_down(_durable_size, align);
+    _tail = temporary_buffer<char>(buf.get() + (tail_pos - pos), _durable_size - tail_pos);
+}
+
+future<> append_log::impl::close() noexcept {
+    co_await _gate.close();
+    co_await std::move(_committer);
+    std::exception_ptr ex;
+    if (!_failed) {
+        try {
+            co_await _file.truncate(_durable_size);
+        } catch (...) {
+            ex = std::current_exception();
+        }
+    }
+    co_await _file.close();
+    if (ex) {
+        std::rethrow_exception(ex);
+    }
+}
+
+append_log::append_log(std::unique_ptr<impl> impl) noexcept : _impl(std::move(impl)) {}
+
+append_log::append_log(append_log&&) noexcept = default;
+
+append_log& append_log::operator=(append_log&&) noexcept = default;
+
+append_log::~append_log() = default;
+
+future<uint64_t> append_log::append(temporary_buffer<char> record) {
+    return _impl->append(std::move(record));
+}
+
+future<uint64_t> append_log::append(std::string_view record) {
+    return _impl->append(temporary_buffer<char>(record.data(), record.size()));
+}
+
+uint64_t append_log::size() const noexcept {
+    return _impl->size();
+}
+
+uint64_t append_log::durable_size() const noexcept {
+    return _impl->durable_size();
+}
+
+future<> append_log::close() noexcept {
+    return _impl->close();
+}
+
+append_log make_append_log(file f, uint64_t size, append_log_options options) {
+    return append_log(std::make_unique<append_log::impl>(std::move(f), size, std::move(options)));
+}
+
+}
@@ -0,0 +1,464 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2026 ScyllaDB
+ */
+
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <boost/intrusive/list.hpp>
+#include <fmt/format.h>
+#include <seastar/core/caching_file.hh>
+#include <seastar/core/coroutine.hh>
+#include <seastar/core/gate.hh>
+#include <seastar/core/layered_file.hh>
+#include <seastar/core/memory.hh>
+#include <seastar/core/metrics.hh>
+#include <seastar/core/shared_future.hh>
+#include <seastar/core/when_all.hh>
+#include <seastar/util/internal/iovec_utils.hh>
+
+namespace seastar {
+
+namespace bi = boost::intrusive;
+
+class caching_file_impl;
+
+class file_block_cache::impl {
+    using unlink_hook = bi::list_member_hook<bi::link_mode<bi::auto_unlink>>;
+
+public:
+    struct key {
+        uint64_t file_id;
+        uint64_t idx;
+        bool operator==(const key&) const noexcept = default;
+    };
+
+    struct key_hash {
+        size_t operator()(const key& k) const noexcept {
+            return std::hash<uint64_t>()(k.file_id * 0x9e3779b97f4a7c15ull ^ k.idx);
+        }
+    };
+
+    // A cached block, shorter than the block size if it's the last one of the file
+    struct block {
+        key k;
+        temporary_buffer<uint8_t> data;
+        unlink_hook lru_hook;
+        unlink_hook file_hook;
+    };
+
+    using lru_list = bi::list<block,
+            bi::member_hook<block, unlink_hook, &block::lru_hook>,
+            bi::constant_time_size<false>>;
+    using file_block_list = bi::list<block,
+            bi::member_hook<block, unlink_hook, &block::file_hook>,
+            bi::constant_time_size<false>>;
+
+    struct pending_read {
+        shared_promise<> ready;
+        temporary_buffer<uint8_t> data;
+    };
+
+private:
+    const config _cfg;
+    std::unordered_map<key, block, key_hash> _blocks;
+    std::unordered_map<key, lw_shared_ptr<pending_read>, key_hash> _pending;
+    // Least recently used first
+    lru_list _lru;
+    size_t _used = 0;
+    uint64_t _next_file_id = 0;
+    stats _stats;
+    memory::reclaimer _reclaimer;
+    metrics::metric_groups _metrics;
+
+    void erase(std::unordered_map<key, block, key_hash>::iterator it) noexcept {
+        _used -= _cfg.block_size;
+        _blocks.erase(it);
+    }
+
+    void evict_one() noexcept {
+        _stats.evictions++;
+        erase(_blocks.find(_lru.front().k));
+    }
+
+    void insert(key k, temporary_buffer<uint8_t> data, file_block_list& file_blocks) noexcept;
+
+    memory::reclaiming_result reclaim(size_t bytes) noexcept {
+        if (_lru.empty()) {
+            return memory::reclaiming_result::reclaimed_nothing;
+        }
+        size_t freed = 0;
+        while (freed < bytes && !_lru.empty()) {
+            evict_one();
+            freed += _cfg.block_size;
+        }
+        return memory::reclaiming_result::reclaimed_something;
+    }
+
+    void register_metrics();
+
+public:
+    explicit impl(config cfg)
+        : _cfg(std::move(cfg))
+        , _reclaimer([this] (memory::reclaimer::request r) { return reclaim(r.bytes_to_reclaim); }, memory::reclaimer_scope::sync)
+    {
+        if (!_cfg.metrics_name.empty()) {
+            register_metrics();
+        }
+    }
+
+    ~impl() {
+        clear();
+    }
+
+    size_t block_size() const noexcept { return _cfg.block_size; }
+    size_t memory_used() const noexcept { return _used; }
+    const stats& get_stats() const noexcept { return _stats; }
+    uint64_t new_file_id() noexcept { return _next_file_id++; }
+
+    void clear() noexcept {
+        while (!_lru.empty()) {
+            evict_one();
+        }
+    }
+
+    // Returns the block, or its part up to the end of file, shared with the cache
+    future<temporary_buffer<uint8_t>> get_block(caching_file_impl& f, uint64_t idx);
+
+    void invalidate(caching_file_impl& f, uint64_t pos, uint64_t len) noexcept;
+    void invalidate_all(caching_file_impl& f) noexcept;
+};
+
+class caching_file_impl final : public layered_file_impl {
+    friend class file_block_cache::impl;
+
+    file_block_cache::impl& _cache;
+    const uint64_t _id;
+    // Bumped by every modification, block reads that overlap with one
+    // are not cached
+    uint64_t _generation = 0;
+    file_block_cache::impl::file_block_list _blocks;
+    // Held by the block reads from the underlying file, close() waits
+    // for them before the file can go away
+    gate _reads;
+
+    future<size_t> do_read(uint64_t pos, std::vector<iovec> iov);
+
+    template <typename Func>
+    auto modify(uint64_t pos, uint64_t len, Func func) {
+        _generation++;
+        _cache.invalidate(*this, pos, len);
+        return func().finally([this, pos, len] {
+            _generation++;
+            _cache.invalidate(*this, pos, len);
+        });
+    }
+
+public:
+    caching_file_impl(file f, file_block_cache::impl& cache)
+        : layered_file_impl(std::move(f))
+        , _cache(cache)
+        , _id(cache.new_file_id())
+    {
+        if (_cache.block_size() % _disk_read_dma_alignment) {
+            throw std::invalid_argument(fmt::format("cache block size {} is not a multiple of the file's read alignment {}",
+                    _cache.block_size(), _disk_read_dma_alignment));
+        }
+    }
+
+    ~caching_file_impl() {
+        _cache.invalidate_all(*this);
+    }
+
+    virtual future<size_t> write_dma(uint64_t pos, const void* buffer, size_t len, io_intent* intent) override {
+        return modify(pos, len, [this, pos, buffer, len, intent] {
+            return _underlying_file.dma_write(pos, static_cast<const uint8_t*>(buffer), len, intent);
+        });
+    }
+
+    virtual future<size_t> write_dma(uint64_t pos, std::vector<iovec> iov, io_intent* intent) override {
+        auto len = internal::iovec_len(iov);
+        return modify(pos, len, [this, pos, iov = std::move(iov), intent] () mutable {
+            return _underlying_file.dma_write(pos, std::move(iov), intent);
+        });
+    }
+
+    virtual future<size_t> read_dma(uint64_t pos, void* buffer, size_t len, io_intent*) override {
+        return do_read(pos, std::vector<iovec>{iovec{buffer, len}});
+    }
+
+    virtual future<size_t> read_dma(uint64_t pos, std::vector<iovec> iov, io_intent*) override {
+        return do_read(pos, std::move(iov));
+    }
+
+    virtual future<temporary_buffer<uint8_t>> dma_read_bulk(uint64_t offset, size_t range_size, io_intent*) override;
+
+    virtual future<> flush() override {
+        return _underlying_file.flush();
+    }
+
+    virtual future<struct stat> stat() override {
+        return _underlying_file.stat();
+    }
+
+    virtual future<> truncate(uint64_t length) override {
+        return modify(length, std::numeric_limits<uint64_t>::max() - length, [this, length] {
+            return _underlying_file.truncate(length);
+        });
+    }
+
+    virtual future<> discard(uint64_t offset, uint64_t length) override {
+        return modify(offset, length, [this, offset, length] {
+            return _underlying_file.discard(offset, length);
+        });
+    }
+
+    virtual future<> allocate(uint64_t position, uint64_t length) override {
+        return _underlying_file.allocate(position, length);
+    }
+
+    virtual future<uint64_t> size() override {
+        return _underlying_file.size();
+    }
+
+    virtual future<> close() override {
+        // Reads still in flight must not cache what they get
+        _generation++;
+        _cache.invalidate_all(*this);
+        return _reads.close().then([this] {
+            return _underlying_file.close();
+        });
+    }
+
+    virtual subscription<directory_entry> list_directory(std::function<future<> (directory_entry de)> next) override {
+        return _underlying_file.list_directory(std::move(next));
+    }
+};
+
+void file_block_cache::impl::insert(key k, temporary_buffer<uint8_t> data, file_block_list& file_blocks) noexcept {
+    try {
+        auto [it, inserted] = _blocks.try_emplace(k);
+        if (!inserted) {
+            return;
+        }
+        it->second.k = k;
+        it->second.data = std::move(data);
+        _lru.push_back(it->second);
+        file_blocks.push_back(it->second);
+        _used += _cfg.block_size;
+    } catch (...) {
+        // Not caching is always an option
+        return;
+    }
+    while (_used > _cfg.max_size) {
+        evict_one();
+    }
+}
+
+future<temporary_buffer<uint8_t>> file_block_cache::impl::get_block(caching_file_impl& f, uint64_t idx) {
+    key k{f._id, idx};
+    if (auto it = _blocks.find(k); it != _blocks.end()) {
+        _stats.hits++;
+        auto& b = it->second;
+        b.lru_hook.unlink();
+        _lru.push_back(b);
+        return make_ready_future<temporary_buffer<uint8_t>>(b.data.share());
+    }
+
+    if (auto it = _pending.find(k); it != _pending.end()) {
+        _stats.coalesced_misses++;
+        return it->second->ready.get_shared_future().then([pr = it->second] {
+            return pr->data.share();
+        });
+    }
+
+    auto holder = f._reads.try_hold();
+    if (!holder) {
+        return make_exception_future<temporary_buffer<uint8_t>>(gate_closed_exception());
+    }
+    _stats.misses++;
+    auto pr = make_lw_shared<pending_read>();
+    _pending.emplace(k, pr);
+    auto generation = f._generation;
+    return f._underlying_file.dma_read_bulk<uint8_t>(idx * _cfg.block_size, _cfg.block_size).then_wrapped(
+            [this, &f, k, pr, generation, holder = std::move(*holder)] (future<temporary_buffer<uint8_t>> fut) {
+        if (auto it = _pending.find(k); it != _pending.end() && it->second == pr) {
+            _pending.erase(it);
+        }
+        if (fut.failed()) {
+            auto ex = fut.get_exception();
+            pr->ready.set_exception(ex);
+            return make_exception_future<temporary_buffer<uint8_t>>(std::move(ex));
+        }
+        auto buf = fut.get();
+        pr->data = buf.share();
+        if (generation == f._generation) {
+            insert(k, buf.share(), f._blocks);
+        }
+        pr->ready.set_value();
+        return make_ready_future<temporary_buffer<uint8_t>>(std::move(buf));
+    });
+}
+
+void file_block_cache::impl::invalidate(caching_file_impl& f, uint64_t pos, uint64_t len) noexcept {
+    if (len == 0) {
+        return;
+    }
+    auto first = pos / _cfg.block_size;
+    auto last = (pos + std::min(len, std::numeric_limits<uint64_t>::max() - pos) - 1) / _cfg.block_size;
+    if (last - first >= _blocks.size() + _pending.size()) {
+        // Cheaper to go over what's cached than over the range
+        for (auto it = f._blocks.begin(); it != f._blocks.end();) {
+            auto k = (it++)->k;
+            if (k.idx >= first && k.idx <= last) {
+                erase(_blocks.find(k));
+            }
+        }
+        std::erase_if(_pending, [&] (const auto& p) {
+            return p.first.file_id == f._id && p.first.idx >= first && p.first.idx <= last;
+        });
+        return;
+    }
+    for (auto idx = first; idx <= last; idx++) {
+        key k{f._id, idx};
+        if (auto it = _blocks.find(k); it != _blocks.end()) {
+            erase(it);
+        }
+        // Later reads must not join a read that may see stale data
+        _pending.erase(k);
+    }
+}
+
+void file_block_cache::impl::invalidate_all(caching_file_impl& f) noexcept {
+    while (!f._blocks.empty()) {
+        erase(_blocks.find(f._blocks.front().k));
+    }
+    std::erase_if(_pending, [&] (const auto& p) { return p.first.file_id == f._id; });
+}
+
+void file_block_cache::impl::register_metrics() {
+    namespace sm = seastar::metrics;
+    auto cache_l = sm::label("cache")(_cfg.metrics_name);
+    _metrics.add_group("file_cache", {
+        sm::make_counter("hits", [this] { return _stats.hits; },
+                sm::description("Number of block reads served from the cache"), {cache_l}),
+        sm::make_counter("misses", [this] { return _stats.misses; },
+                sm::description("Number of block reads that went to the underlying file"), {cache_l}),
+        sm::make_counter("coalesced_misses", [this] { return _stats.coalesced_misses; },
+                sm::description("Number of block reads that waited for a read of the same block already in flight"), {cache_l}),
+        sm::make_counter("evictions", [this] { return _stats.evictions; },
+                sm::description("Number of blocks evicted to stay within the size limit or on memory pressure"), {cache_l}),
+        sm::make_gauge("bytes", [this] { return _used; },
+                sm::description("Memory held by cached blocks"), {cache_l}),
+    });
+}
+
+future<size_t> caching_file_impl::do_read(uint64_t pos, std::vector<iovec> iov) {
+    auto len = internal::iovec_len(iov);
+    if (len == 0) {
+        co_return 0;
+    }
+    auto bs = _cache.block_size();
+    auto first = pos / bs;
+    auto last = (pos + len - 1) / bs;
+    std::vector<future<temporary_buffer<uint8_t>>> reads;
+    reads.reserve(last - first + 1);
+    for (auto idx = first; idx <= last; idx++) {
+        reads.push_back(_cache.get_block(*this, idx));
+    }
+    auto blocks = co_await when_all_succeed(reads.begin(), reads.end());
+
+    size_t done = 0;
+    auto vec = iov.begin();
+    size_t vec_off = 0;
+    for (auto& blk : blocks) {
+        auto off = (pos + done) % bs;
+        if (blk.size() <= off) {
+            break;
+        }
+        auto avail = std::min(blk.size() - off, len - done);
+        const uint8_t* src = blk.get() + off;
+        while (avail) {
+            auto n = std::min(avail, vec->iov_len - vec_off);
+            std::memcpy(static_cast<char*>(vec->iov_base) + vec_off, src, n);
+            src += n;
+            avail -= n;
+            done += n;
+            vec_off += n;
+            if (vec_off == vec->iov_len) {
+                ++vec;
+                vec_off = 0;
+            }
+        }
+        if (blk.size() < bs) {
+            break; // end of file
+        }
+    }
+    co_return done;
+}
+
+future<temporary_buffer<uint8_t>> caching_file_impl::dma_read_bulk(uint64_t offset, size_t range_size, io_intent*) {
+    auto bs = _cache.block_size();
+    auto off = offset % bs;
+    if (off + range_size <= bs) {
+        auto blk = co_await _cache.get_block(*this, offset / bs);
+        if (blk.size() <= off) {
+            co_return temporary_buffer<uint8_t>();
+        }
+        // The caller owns the buffer and may write to it, so it can't
+        // share the block the other readers get
+        auto len = std::min(blk.size() - off, range_size);
+        auto buf = temporary_buffer<uint8_t>::aligned(_memory_dma_alignment, len);
+        std::memcpy(buf.get_write(), blk.get() + off, len);
+        co_return buf;
+    }
+    auto buf = temporary_buffer<uint8_t>::aligned(_memory_dma_alignment, range_size);
+    std::vector<iovec> iov;
+    iov.push_back(iovec{buf.get_write(), range_size});
+    auto size = co_await do_read(offset, std::move(iov));
+    buf.trim(size);
+    co_return buf;
+}
+
+file_block_cache::file_block_cache() : file_block_cache(config{}) {}
+
+file_block_cache::file_block_cache(config cfg) : _impl(std::make_unique<impl>(std::move(cfg))) {}
+
+file_block_cache::file_block_cache(file_block_cache&&) noexcept = default;
+
+file_block_cache::~file_block_cache() = default;
+
+size_t file_block_cache::memory_used() const noexcept {
+    return _impl->memory_used();
+}
+
+file_block_cache::stats file_block_cache::get_stats() const noexcept {
+    return _impl->get_stats();
+}
+
+void file_block_cache::clear() noexcept {
+    _impl->clear();
+}
+
+file make_caching_file(file f, file_block_cache& cache) {
+    return file(make_shared<caching_file_impl>(std::move(f), *cache._impl));
+}
+
+}
@@ -88,6 +88,10 @@ void disk_config_params::parse_config(const smp_options& smp_opts, const reactor
     seastar_logger.debug("latency_goal: {}", latency_goal().count());
     _flow_ratio_backpressure_threshold = reactor_opts.io_flow_ratio_threshold.get_value();
     seastar_logger.debug("flow-ratio threshold: {}", _flow_ratio_backpressure_threshold);
+    _adaptive_cost_model = reactor_opts.io_adaptive_cost_model.get_value();
+    _calendar_class_selection = reactor_opts.io_calendar_class_selection.get_value();
+    _capacity_lending = reactor_opts.io_capacity_lending.get_value();
+    _merge_reads = reactor_opts.io_merge_reads.get_value();
     _stall_threshold = reactor_opts.io_completion_notify_ms.defaulted() ? std::chrono::milliseconds::max() : reactor_opts.io_completion_notify_ms.get_value() * 1ms;
 
     if (smp_opts.num_io_groups) {
@@ -195,6 +199,10 @@ struct io_queue::config disk_config_params::generate_config(const disk_params& p
     cfg.duplex = p.duplex;
     cfg.rate_limit_duration = latency_goal();
     cfg.flow_ratio_backpressure_threshold = _flow_ratio_backpressure_threshold;
+    cfg.adaptive_cost_model = _adaptive_cost_model;
+    cfg.calendar_class_selection = _calendar_class_selection;
+    cfg.capacity_lending = _capacity_lending;
+    cfg.merge_reads = _merge_reads;
     // Block count limit should not be less than the minimal IO size on the device
     // On the other hand, even this is not good enough -- in the worst case the
     // scheduler will self-tune to allow for the single 64k request, while it would
@@ -23,6 +23,7 @@
 module;
 #endif
 
+#include <algorithm>
 #include <chrono>
 #include <functional>
 #include <utility>
@@ -38,6 +39,7 @@ module seastar;
 #include <seastar/core/circular_buffer.hh>
 #include <seastar/util/noncopyable_function.hh>
 #include <seastar/core/metrics.hh>
+#include <seastar/core/bitops.hh>
 #endif
 #include <seastar/util/assert.hh>
 
@@ -128,9 +130,103 @@ bool fair_queue::class_compare::operator() (const priority_entry_ptr& lhs, const
     return lhs->_accumulated > rhs->_accumulated;
 }
 
+fair_queue::children_queue::children_queue(const config& cfg)
+    : _calendar(cfg.selection == config::class_selection::calendar ? std::make_unique<calendar_queue>(cfg.calendar_resolution_shift) : nullptr)
+{
+}
+
+void fair_queue::calendar_queue::insert(unsigned idx, priority_entry& e, bool front) noexcept {
+    if (front) {
+        _buckets[idx].push_front(e);
+    } else {
+        _buckets[idx].push_back(e);
+    }
+    _sizes[idx]++;
+    _nonempty[idx / 64] |= uint64_t(1) << (idx % 64);
+    _size++;
+}
+
+fair_queue::priority_entry& fair_queue::calendar_queue::remove_front(unsigned idx) noexcept {
+    auto& e = _buckets[idx].front();
+    _buckets[idx].pop_front();
+    if (--_sizes[idx] == 0) {
+        _nonempty[idx / 64] &= ~(uint64_t(1) << (idx % 64));
+    }
+    _size--;
+    return e;
+}
+
+// Scans the non-empty buckets bitmap from the current one on, wrapping around
+unsigned fair_queue::calendar_queue::first_nonempty() const noexcept {
+    constexpr unsigned nr_words = nr_buckets / 64;
+    unsigned start = bucket(_base);
+    unsigned w = start / 64;
+    uint64_t bits = _nonempty[w] & (~uint64_t(0) << (start % 64));
+    for (unsigned i = 0; i < nr_words; i++) {
+        if (bits) {
+            return w * 64 + count_trailing_zeros(bits);
+        }
+        w = (w + 1) % nr_words;
+        bits = _nonempty[w];
+    }
+    // Back at the start word, only the buckets before the current one left
+    SEASTAR_ASSERT(bits);
+    return w * 64 + count_trailing_zeros(bits);
+}
+
+void fair_queue::calendar_queue::place(priority_entry& e) noexcept {
+    auto k = key(e);
+    // Entries that lag behind the wheel go first, like they would in a heap
+    bool lagging = k < _base;
+    k = std::clamp(k, _base, _base + nr_buckets - 1);
+    insert(bucket(k), e, lagging);
+}
+
+void fair_queue::calendar_queue::push(priority_entry_ptr e) noexcept {
+    if (_size == 0) {
+        _base = key(*e);
+    }
+    place(*e);
+}
+
+fair_queue::priority_entry_ptr fair_queue::calendar_queue::top() noexcept {
+    while (_size != 0) {
+        auto idx = first_nonempty();
+        _base += (idx - bucket(_base)) % nr_buckets;
+        auto& e = _buckets[idx].front();
+        if (key(e) <= _base) {
+            return &e;
+        }
+        // Parked when the wheel was behind
+        if (_sizes[idx] == _size) {
+            // Nothing else to serve, move the wheel right to the earliest
+            // parked entry instead of revolving it there step by step
+            _base = key(*std::ranges::min_element(_buckets[idx], std::less<>(), [this] (const priority_entry& e) { return key(e); }));
+            bucket_t parked;
+            parked.swap(_buckets[idx]);
+            _sizes[idx] = 0;
+            _nonempty[idx / 64] &= ~(uint64_t(1) << (idx % 64));
+            _size = 0;
+            while (!parked.empty()) {
+                auto& p = parked.front();
+                parked.pop_front();
+                place(p);
+            }
+        } else {
+            place(remove_front(idx));
+        }
+    }
+    return nullptr;
+}
+
+void fair_queue::calendar_queue::pop() noexcept {
+    // top() has just moved the wheel to the entry being popped
+    remove_front(bucket(_base));
+}
+
 fair_queue::fair_queue(config cfg)
     : _config(std::move(cfg))
-    , _root(0, nullptr)
+    , _root(0, nullptr, _config)
 {
 }
 
@@ -217,7 +313,7 @@ void fair_queue::ensure_priority_group(unsigned index, uint32_t shares) {
 
     if (!_priority_groups[index]) {
         _root.reserve();
-        _priority_groups[index] = std::make_unique<priority_class_group_data>(shares, &_root);
+        _priority_groups[index] = std::make_unique<priority_class_group_data>(shares, &_root, _config);
         _root._nr_children++;
     } else {
         _priority_groups[index]->update_shares(shares);
@@ -246,7 +342,15 @@ void fair_queue::queue(class_id id, fair_queue_entry& ent) noexcept {
     if (pc._plugged) {
         pc.wakeup(_config);
     }
-    pc._queue.push_back(ent);
+    if (!ent.has_deadline() || pc._queue.empty() || pc._queue.back()._deadline <= ent._deadline) {
+        pc._queue.push_back(ent);
+    } else {
+        // Keep the class' queue sorted by deadline, the ones without it
+        // being the latest. Entries with equal deadlines stay in FIFO order
+        auto prev = pc._queue.before_begin();
+        for (auto it = pc._queue.begin(); it->_deadline <= ent._deadline; prev = it++) {}
+        pc._queue.insert_after(prev, ent);
+    }
     _queued_capacity += ent.capacity();
 }
 
@@ -258,6 +362,11 @@ void fair_queue::notify_request_cancelled(fair_queue_entry& ent) noexcept {
     ent._capacity = 0;
 }
 
+void fair_queue::update_capacity(fair_queue_entry& ent, capacity_t cap) noexcept {
+    _queued_capacity = _queued_capacity - ent._capacity + cap;
+    ent._capacity = cap;
+}
+
 fair_queue_entry* fair_queue::top() {
     return _root.top();
 }
@@ -115,6 +115,12 @@ class posix_file_impl : public file_impl {
     open_flags flags() const {
         return _open_flags;
     }
+
+    // Copies len bytes at pos of src to dst at dst_pos with copy_file_range(),
+    // letting the filesystem share the extents if it can. Resolves to the
+    // number of bytes copied, or to zero if the kernel can't copy between
+    // these two files and the caller should copy the data itself.
+    static future<size_t> copy_range(file& src, uint64_t pos, file& dst, uint64_t dst_pos, size_t len) noexcept;
 private:
     void configure_dma_alignment(const internal::fs_info& fsi);
     void configure_io_lengths() noexcept;
@@ -124,6 +124,7 @@ posix_file_impl::posix_file_impl(int fd, open_flags f, file_open_options options
         , _fd(fd)
 {
     configure_io_lengths();
+    engine().register_file(_fd);
 }
 
 posix_file_impl::posix_file_impl(int fd, open_flags f, file_open_options options, dev_t device_id, const internal::fs_info& fsi)
@@ -133,6 +134,9 @@ posix_file_impl::posix_file_impl(int fd, open_flags f, file_open_options options
 }
 
 posix_file_impl::~posix_file_impl() {
+    if (_fd != -1 && engine_is_ready()) {
+        engine().unregister_file(_fd);
+    }
     if (_refcount && _refcount->fetch_add(-1, std::memory_order_relaxed) != 1) {
         return;
     }
@@ -192,6 +196,7 @@ posix_file_impl::posix_file_impl(int fd, open_flags f, std::atomic<unsigned>* re
     _disk_write_dma_alignment = disk_write_dma_alignment;
     _disk_overwrite_dma_alignment = disk_overwrite_dma_alignment;
     configure_io_lengths();
+    engine().register_file(_fd);
 }
 
 future<>
@@ -225,6 +230,28 @@ posix_file_impl::truncate(uint64_t length) noexcept {
     sr.throw_if_error();
 }
 
+future<size_t>
+posix_file_impl::copy_range(file& src, uint64_t pos, file& dst, uint64_t dst_pos, size_t len) noexcept {
+    auto in = dynamic_cast<posix_file_impl*>(get_file_impl(src));
+    auto out = dynamic_cast<posix_file_impl*>(get_file_impl(dst));
+    // The append-challenged file tracks its size on its own and would miss the copy
+    if (!in || !out || dynamic_cast<append_challenged_posix_file_impl*>(out)) {
+        co_return 0;
+    }
+    auto sr = co_await engine()._thread_pool->submit<syscall_result<ssize_t>>(
+            internal::thread_pool_submit_reason::file_operation, [in_fd = in->_fd, out_fd = out->_fd, pos, dst_pos, len] {
+        loff_t in_off = pos;
+        loff_t out_off = dst_pos;
+        auto ret = ::copy_file_range(in_fd, &in_off, out_fd, &out_off, len, 0);
+        if (ret == -1 && (errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP || errno == ENOSYS)) {
+            ret = 0;
+        }
+        return wrap_syscall<ssize_t>(ret);
+    });
+    sr.throw_if_error();
+    co_return sr.result;
+}
+
 future<int>
 posix_file_impl::ioctl(uint64_t cmd, void* argp) noexcept {
     auto sr = co_await engine()._thread_pool->submit<syscall_result<int>>(
@@ -316,6 +343,7 @@ posix_file_impl::close() noexcept {
         return make_ready_future<>();
     }
     auto fd = _fd;
+    engine().unregister_file(fd);
     _fd = -1;  // Prevent a concurrent close (which is illegal) from closing another file's fd
     if (_refcount && _refcount->fetch_add(-1, std::memory_order_relaxed) != 1) {
         _refcount = nullptr;
@@ -0,0 +1,232 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2026 ScyllaDB
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#ifdef __x86_64__
+#include <nmmintrin.h>
+#endif
+#include <boost/range/irange.hpp>
+#include <fmt/format.h>
+#include <seastar/core/file_copy.hh>
+#include <seastar/core/align.hh>
+#include <seastar/core/coroutine.hh>
+#include <seastar/core/loop.hh>
+#include <seastar/core/with_scheduling_group.hh>
+#include "core/file-impl.hh"
+
+namespace seastar {
+
+namespace {
+
+constexpr auto crc32c_table = [] {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < table.size(); i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c >> 1) ^ (c & 1 ? 0x82f63b78 : 0);
+        }
+        table[i] = c;
+    }
+    return table;
+}();
+
+uint32_t crc32c_sw(uint32_t crc, const char* p, size_t n) noexcept {
+    for (; n; n--) {
+        crc = crc32c_table[(crc ^ uint8_t(*p++)) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef __x86_64__
+[[gnu::target("sse4.2")]]
+uint32_t crc32c_hw(uint32_t crc, const char* p, size_t n) noexcept {
+    uint64_t c = crc;
+    for (; n >= sizeof(uint64_t); n -= sizeof(uint64_t), p += sizeof(uint64_t)) {
+        uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        c = _mm_crc32_u64(c, v);
+    }
+    crc = c;
+    for (; n; n--) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+#endif
+
+uint32_t crc32c_update(uint32_t crc, const char* p, size_t n) noexcept {
+#ifdef __x86_64__
+    static const bool hw = __builtin_cpu_supports("sse4.2");
+    if (hw) {
+        return crc32c_hw(crc, p, n);
+    }
+#endif
+    return crc32c_sw(crc, p, n);
+}
+
+void report_progress(const file_copy_options& options, uint64_t done, uint64_t total) {
+    if (options.progress) {
+        options.progress(done, total);
+    }
+}
+
+// Returns the prefix of the file the kernel copied, which is all of it
+// unless it refused to copy between these files
+future<uint64_t> kernel_copy(file& in, file& out, uint64_t size, const file_copy_options& options) {
+    uint64_t step = uint64_t(options.chunk_size) * std::max(options.concurrency, 1u);
+    uint64_t done = 0;
+    while (done < size) {
+        auto n = co_await posix_file_impl::copy_range(in, done, out, done, std::min(step, size - done));
+        if (!n) {
+            break;
+        }
+        done += n;
+        report_progress(options, done, size);
+    }
+    co_return done;
+}
+
+struct dma_copy_state {
+    file& in;
+    file& out;
+    const file_copy_options& options;
+    uint64_t size;
+    size_t chunk;
+    uint64_t next;
+    uint64_t done;
+    bool failed = false;
+};
+
+// Copies the next chunk nobody has claimed yet until there are none left,
+// several of these run at once so that the reads of some chunks overlap
+// with the writes of the others
+future<> copy_chunks(dma_copy_state& st) {
+    while (st.next < st.size && !st.failed) {
+        auto pos = st.next;
+        st.next += st.chunk;
+        try {
+            auto len = std::min(uint64_t(st.chunk), st.size - pos);
+            auto buf = co_await st.in.dma_read_exactly<char>(pos, len);
+            auto write_align = st.out.disk_write_dma_alignment();
+            if (len % write_align) {
+                // The last chunk, padded for the write and truncated later
+                auto padded = temporary_buffer<char>::aligned(st.out.memory_dma_alignment(), align_up(len, size_t(write_align)));
+                std::fill(std::copy_n(buf.get(), len, padded.get_write()), padded.get_write() + padded.size(), 0);
+                buf = std::move(padded);
+            }
+            // The rest of a short write would be unaligned
+            auto written = co_await st.out.dma_write(pos, buf.get(), buf.size());
+            if (written < buf.size()) {
+                throw std::runtime_error(fmt::format("short write to copy destination at {}: {} of {} bytes", pos, written, buf.size()));
+            }
+            st.done += len;
+            report_progress(st.options, st.done, st.size);
+        } catch (...) {
+            st.failed = true;
+            throw;
+        }
+    }
+}
+
+future<> dma_copy(file& in, file& out, uint64_t start, uint64_t size, const file_copy_options& options) {
+    auto align = std::max(in.disk_read_dma_alignment(), out.disk_write_dma_alignment());
+    auto chunk = align_up(std::max(options.chunk_size, size_t(1)), size_t(align));
+    auto first = align_down(start, uint64_t(align));
+    dma_copy_state st{in, out, options, size, chunk, first, first};
+    co_await parallel_for_each(boost::irange(0u, std::max(options.concurrency, 1u)), [&st] (unsigned) {
+        return copy_chunks(st);
+    });
+}
+
+future<uint64_t> do_copy_file_contents(file in, file out, file_copy_options options) {
+    auto size = co_await in.size();
+    uint64_t copied = 0;
+    if (options.kernel_copy) {
+        copied = co_await kernel_copy(in, out, size, options);
+    }
+    if (copied < size) {
+        co_await dma_copy(in, out, copied, size, options);
+    }
+    co_await out.truncate(size);
+    co_await out.flush();
+    co_return size;
+}
+
+future<uint32_t> do_checksum_file(file in, file_copy_options options) {
+    auto size = co_await in.size();
+    auto chunk = align_up(std::max(options.chunk_size, size_t(1)), size_t(in.disk_read_dma_alignment()));
+    auto concurrency = std::max(options.concurrency, 1u);
+    uint32_t crc = ~uint32_t(0);
+    uint64_t next = 0;
+    uint64_t done = 0;
+    std::deque<future<temporary_buffer<char>>> reads;
+    std::exception_ptr ex;
+
+    // Reads are issued ahead, but folded into the checksum in file order
+    while (next < size || !reads.empty()) {
+        while (!ex && next < size && reads.size() < concurrency) {
+            reads.push_back(in.dma_read_exactly<char>(next, std::min(uint64_t(chunk), size - next)));
+            next += chunk;
+        }
+        auto f = std::move(reads.front());
+        reads.pop_front();
+        try {
+            auto buf = co_await std::move(f);
+            if (!ex) {
+                crc = crc32c_update(crc, buf.get(), buf.size());
+                done += buf.size();
+                report_progress(options, done, size);
+            }
+        } catch (...) {
+            ex = std::current_exception();
+        }
+        if (ex) {
+            // Wait for the reads in flight before reporting the error
+            next = size;
+        }
+    }
+    if (ex) {
+        std::rethrow_exception(ex);
+    }
+    co_return ~crc;
+}
+
+}
+
+future<uint64_t> copy_file_contents(file in, file out, file_copy_options options) {
+    auto sg = options.sched_group.value_or(current_scheduling_group());
+    return with_scheduling_group(sg, [in = std::move(in), out = std::move(out), options = std::move(options)] () mutable {
+        return do_copy_file_contents(std::move(in), std::move(out), std::move(options));
+    });
+}
+
+future<uint32_t> checksum_file(file in, file_copy_options options) {
+    auto sg = options.sched_group.value_or(current_scheduling_group());
+    return with_scheduling_group(sg, [in = std::move(in), options = std::move(options)] () mutable {
+        return do_checksum_file(std::move(in), std::move(options));
+    });
+}
+
+}
@@ -77,11 +77,20 @@ class file_data_source_impl : public data_source_impl {
         uint64_t _pos;
         uint64_t _size;
         future<temporary_buffer<char>> _ready;
+        // Bytes before _pos the consumer is expected to skip, see strided reads
+        uint64_t _skip_before;
 
-        issued_read(uint64_t pos, uint64_t size, future<temporary_buffer<char>> f)
-            : _pos(pos), _size(size), _ready(std::move(f)) { }
+        issued_read(uint64_t pos, uint64_t size, future<temporary_buffer<char>> f, uint64_t skip_before = 0)
+            : _pos(pos), _size(size), _ready(std::move(f)), _skip_before(skip_before) { }
     };
 
+    using clock_type = std::chrono::steady_clock;
+    enum class access_pattern { sequential, strided, random };
+    // Number of identical record/skip pairs after which reads are considered strided
+    static constexpr unsigned strided_confirmations = 2;
+    // Reads shorter than that between two skips are considered random
+    static constexpr unsigned sequential_run_buffers = 4;
+
     reactor::io_stats& _stats = reactor::io_stats::local();
     file _file;
     file_input_stream_options _options;
@@ -95,6 +104,19 @@ class file_data_source_impl : public data_source_impl {
     size_t _current_buffer_size;
     bool _in_slow_start = false;
     io_intent _intent;
+    // Adaptive read-ahead state, see file_input_stream_options::adaptive_read_ahead
+    access_pattern _pattern = access_pattern::sequential;
+    uint64_t _consumed_since_skip = 0;
+    uint64_t _last_record = 0;
+    uint64_t _last_gap = 0;
+    unsigned _stride_hits = 0;
+    uint64_t _stride_record = 0;
+    uint64_t _stride_gap = 0;
+    uint64_t _record_left = 0;
+    // Time of the previous get(), if it didn't have to wait for the disk
+    std::optional<clock_type::time_point> _last_get;
+    clock_type::duration _consume_interval = clock_type::duration::zero();
+    clock_type::duration _io_latency = clock_type::duration::zero();
     using unused_ratio_target = std::ratio<25, 100>;
 private:
     size_t minimal_buffer_size() const {
@@ -113,6 +135,82 @@ class file_data_source_impl : public data_source_impl {
             }
         }
     }
+    static void update_average(clock_type::duration& avg, clock_type::duration sample) noexcept {
+        avg = avg.count() ? avg + (sample - avg) / 4 : sample;
+    }
+
+    void adapt_read_ahead(bool blocked) {
+        if (_pattern == access_pattern::random) {
+            return;
+        }
+        auto now = clock_type::now();
+        if (_last_get) {
+            update_average(_consume_interval, now - *_last_get);
+        }
+        // If the consumer waits now, the next interval would include the wait
+        _last_get = blocked ? std::nullopt : std::make_optional(now);
+
+        auto limit = _in_slow_start ? _current_read_ahead : _options.read_ahead;
+        if (blocked) {
+            _current_read_ahead = std::min(limit, std::max(_current_read_ahead * 2, 1u));
+        } else if (_consume_interval.count() && _io_latency.count()) {
+            // Keep enough reads in flight to hide the disk latency at the
+            // rate the consumer processes buffers, and let the excess drain
+            // slowly so that a single fast get() doesn't collapse the window
+            auto target = unsigned(std::min<uint64_t>(_io_latency / _consume_interval + 1, _options.read_ahead));
+            if (target > _current_read_ahead) {
+                _current_read_ahead = std::min(target, limit);
+            } else if (target + 1 < _current_read_ahead) {
+                _current_read_ahead--;
+            }
+        }
+        if (_options.dynamic_adjustments) {
+            auto& h = *_options.dynamic_adjustments;
+            h.read_ahead = std::max(h.read_ahead, _current_read_ahead);
+        }
+    }
+
+    void set_pattern(access_pattern p) {
+        if (p == _pattern) {
+            return;
+        }
+        if (p == access_pattern::strided || _pattern == access_pattern::strided) {
+            // Reads already issued follow the layout of the old pattern
+            drop_read_aheads();
+        }
+        _pattern = p;
+        if (p == access_pattern::strided) {
+            _stride_record = _last_record;
+            _stride_gap = _last_gap;
+            _record_left = _stride_record;
+        }
+        _last_get.reset();
+    }
+
+    void observe_skip(uint64_t n) {
+        _last_get.reset();
+        if (_pattern != access_pattern::strided && n < _current_buffer_size) {
+            // Reading through short skips is cheaper than issuing separate reads
+            _consumed_since_skip += n;
+            return;
+        }
+        auto record = std::exchange(_consumed_since_skip, 0);
+        if (record && record == _last_record && n == _last_gap) {
+            _stride_hits++;
+        } else {
+            _stride_hits = 0;
+        }
+        _last_record = record;
+        _last_gap = n;
+        if (_stride_hits >= strided_confirmations) {
+            set_pattern(access_pattern::strided);
+        } else if (record < sequential_run_buffers * _current_buffer_size) {
+            set_pattern(access_pattern::random);
+        } else {
+            set_pattern(access_pattern::sequential);
+        }
+    }
+
     unsigned get_initial_read_ahead() const {
         return _options.dynamic_adjustments
                ? std::min(_options.dynamic_adjustments->read_ahead, _options.read_ahead)
@@ -202,6 +300,27 @@ class file_data_source_impl : public data_source_impl {
         auto f = read_future.then_wrapped([] (auto f) { f.ignore_ready_future(); });
         _dropped_reads = _dropped_reads.then([f = std::move(f)] () mutable { return std::move(f); });
     }
+    // Drops all read-aheads, cancelling those still queued, and moves the
+    // read position back to where the consumer is.
+    void drop_read_aheads() {
+        if (_read_buffers.empty()) {
+            return;
+        }
+        auto consumer_pos = _read_buffers.front()._pos - _read_buffers.front()._skip_before;
+        uint64_t dropped = 0;
+        for (auto&& c : _read_buffers) {
+            _stats.fstream_read_aheads_discarded += 1;
+            _stats.fstream_read_ahead_discarded_bytes += c._size;
+            dropped += c._size;
+            ignore_read_future(std::move(c._ready));
+        }
+        _read_buffers.clear();
+        _intent.cancel();
+        _remain += _pos - consumer_pos;
+        _pos = consumer_pos;
+        _record_left = _stride_record;
+        update_history_unused(dropped);
+    }
 public:
     file_data_source_impl(file f, uint64_t offset, uint64_t len, file_input_stream_options options)
             : _file(std::move(f)), _options(options), _pos(offset), _remain(len), _current_read_ahead(get_initial_read_ahead())
@@ -218,13 +337,24 @@ class file_data_source_impl : public data_source_impl {
         SEASTAR_ASSERT(_reads_in_progress == 0);
     }
     virtual future<temporary_buffer<char>> get() override {
-        if (!_read_buffers.empty() && !_read_buffers.front()._ready.available()) {
+        if (_options.adaptive_read_ahead) {
+            if (!_read_buffers.empty() && _read_buffers.front()._skip_before) {
+                // The consumer reads through a gap it was expected to skip
+                _stride_hits = 0;
+                set_pattern(access_pattern::sequential);
+            }
+            adapt_read_ahead(!_read_buffers.empty() && !_read_buffers.front()._ready.available());
+        } else if (!_read_buffers.empty() && !_read_buffers.front()._ready.available()) {
             try_increase_read_ahead();
         }
         issue_read_aheads(1);
         auto ret = std::move(_read_buffers.front());
         _read_buffers.pop_front();
         update_history_consumed(ret._size);
+        _consumed_since_skip += ret._size;
+        if (_pattern == access_pattern::random && _consumed_since_skip >= sequential_run_buffers * _current_buffer_size) {
+            set_pattern(access_pattern::sequential);
+        }
         _stats.fstream_reads += 1;
         _stats.fstream_read_bytes += ret._size;
         if (!ret._ready.available()) {
@@ -235,6 +365,7 @@ class file_data_source_impl : public data_source_impl {
     }
     virtual future<temporary_buffer<char>> skip(uint64_t n) override {
         uint64_t dropped = 0;
+        auto skipped = n;
         while (n) {
             if (_read_buffers.empty()) {
                 SEASTAR_ASSERT(n <= _remain);
@@ -243,6 +374,16 @@ class file_data_source_impl : public data_source_impl {
                 break;
             }
             auto& front = _read_buffers.front();
+            if (front._skip_before) {
+                if (n < front._skip_before) {
+                    // The stride changed, the reads issued so far are off
+                    drop_read_aheads();
+                } else {
+                    n -= front._skip_before;
+                    front._skip_before = 0;
+                }
+                continue;
+            }
             if (n < front._size) {
                 front._size -= n;
                 front._pos += n;
@@ -261,6 +402,13 @@ class file_data_source_impl : public data_source_impl {
             }
         }
         update_history_unused(dropped);
+        if (_options.adaptive_read_ahead) {
+            if (dropped && _read_buffers.empty()) {
+                // Everything in flight was for the skipped range
+                _intent.cancel();
+            }
+            observe_skip(skipped);
+        }
         return make_ready_future<temporary_buffer<char>>();
     }
     virtual future<> close() override {
@@ -286,32 +434,51 @@ class file_data_source_impl : public data_source_impl {
         if (_done) {
             return;
         }
-        auto ra = _current_read_ahead + additional;
+        auto ra = (_pattern == access_pattern::random ? 0 : _current_read_ahead) + additional;
         _read_buffers.reserve(ra); // prevent push_back() failure
         while (_read_buffers.size() < ra) {
-            if (!_remain) {
+            // Strided reads jump over the gap the consumer is going to skip
+            // once the current record is read
+            bool new_record = _pattern == access_pattern::strided && !_record_left;
+            uint64_t skip_before = new_record ? std::min(_stride_gap, _remain) : 0;
+            if (_remain == skip_before) {
                 if (_read_buffers.size() >= additional) {
                     return;
                 }
-                _read_buffers.emplace_back(_pos, 0, make_ready_future<temporary_buffer<char>>());
+                _pos += skip_before;
+                _remain = 0;
+                _read_buffers.emplace_back(_pos, 0, make_ready_future<temporary_buffer<char>>(), skip_before);
                 continue;
             }
+            if (new_record) {
+                _pos += skip_before;
+                _remain -= skip_before;
+                _record_left = _stride_record;
+            }
             ++_reads_in_progress;
             // if _pos is not dma-aligned, we'll get a short read.  Account for that.
             // Also avoid reading beyond _remain.
             uint64_t align = _file.disk_read_dma_alignment();
             auto start = align_down(_pos, align);
             auto end = std::min(align_up(start + _current_buffer_size, align), _pos + _remain);
+            if (_pattern == access_pattern::strided) {
+                end = std::min(end, _pos + _record_left);
+                _record_left -= end - _pos;
+            }
             auto len = end - start;
             auto actual_size = std::min(end - _pos, _remain);
+            auto issued = _options.adaptive_read_ahead ? clock_type::now() : clock_type::time_point();
             _read_buffers.emplace_back(_pos, actual_size, futurize_invoke([&] {
                     return _file.dma_read_bulk_impl(start, len, &_intent);
             }).then_wrapped(
-                    [this, start, pos = _pos, remain = _remain] (future<temporary_buffer<uint8_t>> ret) {
+                    [this, start, pos = _pos, remain = _remain, issued] (future<temporary_buffer<uint8_t>> ret) {
                 --_reads_in_progress;
                 if (_done && !_reads_in_progress) {
                     _done->set_value();
                 }
+                if (_options.adaptive_read_ahead && !ret.failed()) {
+                    update_average(_io_latency, clock_type::now() - issued);
+                }
                 if (ret.failed()) {
                     // no games needed
                     return make_exception_future<temporary_buffer<char>>(ret.get_exception());
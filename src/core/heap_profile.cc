@@ -0,0 +1,122 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2026 ScyllaDB
+ */
+
+#include <fstream>
+#include <sstream>
+#include <fmt/format.h>
+#include <boost/range/irange.hpp>
+#include <seastar/core/heap_profile.hh>
+#include <seastar/core/map_reduce.hh>
+#include <seastar/core/scheduling.hh>
+#include <seastar/core/smp.hh>
+#include <seastar/http/exception.hh>
+#include <seastar/http/handlers.hh>
+
+namespace seastar {
+
+namespace heap_profile {
+
+using sites_type = std::vector<memory::allocation_site>;
+
+// /proc/self/maps is served from memory, reading it doesn't block.
+static sstring read_memory_map() {
+    std::ifstream maps("/proc/self/maps");
+    std::ostringstream os;
+    os << maps.rdbuf();
+    return sstring(os.str());
+}
+
+future<> write_pprof(const sites_type& sites, output_stream<char>& out) {
+    size_t total_count = 0;
+    size_t total_size = 0;
+    for (auto& site : sites) {
+        total_count += site.count;
+        total_size += site.size;
+    }
+    // "heapprofile" tells pprof the sizes are already extrapolated from the
+    // samples and must not be scaled again. The in-use and allocated columns
+    // are the same, as only live allocations are tracked.
+    co_await out.write(fmt::format("heap profile: {}: {} [{}: {}] @ heapprofile\n", total_count, total_size, total_count, total_size));
+    for (auto& site : sites) {
+        fmt::memory_buffer line;
+        fmt::format_to(std::back_inserter(line), "{}: {} [{}: {}] @", site.count, site.size, site.count, site.size);
+        for (auto& f : site.backtrace.frames()) {
+            fmt::format_to(std::back_inserter(line), " {:#x}", f.so->begin + f.addr);
+        }
+        line.push_back('\n');
+        co_await out.write(line.data(), line.size());
+    }
+    co_await out.write("\nMAPPED_LIBRARIES:\n");
+    co_await out.write(read_memory_map());
+}
+
+static future<sites_type> collect_sites(std::optional<unsigned> shard) {
+    if (shard) {
+        return smp::submit_to(*shard, [] { return memory::sampled_memory_profile(); });
+    }
+    return map_reduce(boost::irange(0u, smp::count), [] (unsigned shard) {
+        return smp::submit_to(shard, [] { return memory::sampled_memory_profile(); });
+    }, sites_type(), [] (sites_type acc, sites_type sites) {
+        acc.insert(acc.end(), std::make_move_iterator(sites.begin()), std::make_move_iterator(sites.end()));
+        return acc;
+    });
+}
+
+class heap_profile_handler : public httpd::handler_base {
+public:
+    future<std::unique_ptr<http::reply>> handle(const sstring& path,
+            std::unique_ptr<http::request> req, std::unique_ptr<http::reply> rep) override {
+        std::optional<unsigned> shard;
+        if (auto s = req->get_query_param("shard"); !s.empty()) {
+            try {
+                shard = std::stoul(s);
+            } catch (...) {
+            }
+            if (!shard || *shard >= smp::count) {
+                throw httpd::bad_param_exception(fmt::format("Invalid shard: {}", s));
+            }
+        }
+        auto sites = co_await collect_sites(shard);
+        if (auto group = req->get_query_param("group"); !group.empty()) {
+            std::erase_if(sites, [&group] (const memory::allocation_site& site) {
+                return internal::scheduling_group_from_index(site.scheduling_group_index).name() != group;
+            });
+        }
+        rep->write_body("txt", [sites = std::move(sites)] (output_stream<char>& out) {
+            return write_pprof(sites, out);
+        });
+        co_return std::move(rep);
+    }
+};
+
+future<> add_heap_profile_routes(httpd::http_server& server, config ctx) {
+    server._routes.put(httpd::GET, ctx.path, new heap_profile_handler());
+    return make_ready_future<>();
+}
+
+future<> add_heap_profile_routes(sharded<httpd::http_server>& server, config ctx) {
+    return server.invoke_on_all([ctx] (httpd::http_server& s) {
+        return add_heap_profile_routes(s, ctx);
+    });
+}
+
+}
+}
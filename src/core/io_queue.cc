@@ -25,8 +25,11 @@ module;
 
 #include <array>
 #include <chrono>
+#include <climits>
 #include <cstdint>
 #include <mutex>
+#include <optional>
+#include <span>
 #include <utility>
 #include <fmt/format.h>
 #include <fmt/ostream.h>
@@ -47,7 +50,10 @@ module seastar;
 #include <seastar/core/internal/io_desc.hh>
 #include <seastar/core/internal/io_sink.hh>
 #include <seastar/core/io_priority_class.hh>
+#include <seastar/core/timed_out_error.hh>
 #include <seastar/util/log.hh>
+#include <seastar/util/defer.hh>
+#include <seastar/util/internal/iovec_utils.hh>
 #endif
 
 namespace seastar {
@@ -71,6 +77,7 @@ io_throttler::io_throttler(config cfg, unsigned nr_queues)
                         tokens_capacity(cfg.min_tokens)
                        )
         , _per_tick_threshold(_token_bucket.limit() / nr_queues)
+        , _capacity_lending(cfg.capacity_lending)
 {
     if (tokens_capacity(cfg.min_tokens) > _token_bucket.threshold()) {
         throw std::runtime_error("Fair-group replenisher limit is lower than threshold");
@@ -104,6 +111,11 @@ auto io_throttler::capacity_deficiency(capacity_t from) const noexcept -> capaci
     return _token_bucket.deficiency(from);
 }
 
+void io_throttler::update_rate_ratio(double ratio) noexcept {
+    // See the constructor, the nominal rate is fixed_point_factor
+    _token_bucket.update_rate(fixed_point_factor * ratio);
+}
+
 struct io_group::priority_class_data {
     using token_bucket_t = internal::shared_token_bucket<uint64_t, std::ratio<1>, internal::capped_release::no>;
 
@@ -142,7 +154,8 @@ class io_queue::priority_class_data {
             ops++;
             bytes += len;
         }
-    } _rwstat[2] = {}, _splits = {};
+    } _rwstat[2] = {}, _splits = {}, _merges = {};
+    uint64_t _nr_expired = 0;
     uint32_t _nr_queued;
     uint32_t _nr_executing;
     std::chrono::duration<double> _queue_time;
@@ -228,6 +241,11 @@ class io_queue::priority_class_data {
         _nr_queued--;
     }
 
+    void on_expire() noexcept {
+        _nr_queued--;
+        _nr_expired++;
+    }
+
     void on_complete(std::chrono::duration<double> lat) noexcept {
         _total_execution_time += lat;
         _nr_executing--;
@@ -247,25 +265,90 @@ class io_queue::priority_class_data {
         _splits.add(dnl.length());
     }
 
+    void on_merge(io_direction_and_length dnl) noexcept {
+        _merges.add(dnl.length());
+    }
+
+    // Reads of this class still waiting in the fair queue that adjacent
+    // reads may be merged into, most recently queued last
+    static constexpr size_t max_merge_candidates = 4;
+    boost::container::static_vector<queued_io_request*, max_merge_candidates> merge_candidates;
+
     fair_queue::class_id fq_class() const noexcept { return _pc.id(); }
+    uint32_t shares() const noexcept { return _shares; }
 
     std::vector<seastar::metrics::impl::metric_definition_impl> metrics();
     metrics::metric_groups metric_groups;
 };
 
+// File offset of a read or write request, for tracing
+static uint64_t request_pos(const internal::io_request& req) noexcept {
+    switch (req.opcode()) {
+    case internal::io_request::operation::read:
+    case internal::io_request::operation::write:
+        return req.as<internal::io_request::operation::read>().pos;
+    case internal::io_request::operation::readv:
+    case internal::io_request::operation::writev:
+        return req.as<internal::io_request::operation::readv>().pos;
+    default:
+        return 0;
+    }
+}
+
 class io_desc_read_write final : public io_completion {
     io_queue& _ioq;
     io_queue::priority_class_data& _pclass;
     io_queue::clock_type::time_point _ts;
     const stream_id _stream;
     const io_direction_and_length _dnl;
-    const fair_queue_entry::capacity_t _fq_capacity;
+    fair_queue_entry::capacity_t _fq_capacity;
     promise<size_t> _pr;
     iovec_keeper _iovs;
     uint64_t _dispatched_polls;
+    // Reads merged into this one, in file order after it. They don't go
+    // through the fair queue and get their parts of the result from this
+    // request's completion.
+    std::vector<std::unique_ptr<io_desc_read_write>> _merged;
+    size_t _merged_length = 0;
+    iovec_keeper _merged_iovs;
+    // The read as it was queued, before merging rewrote it. Kept so that
+    // the parts of a failed merged read can be retried separately.
+    std::optional<internal::io_request> _unmerged;
+
+    void complete_merged(size_t res, std::chrono::duration<double> delay) noexcept {
+        _pclass.on_complete(delay);
+        _pr.set_value(res);
+        delete this;
+    }
+
+    void resubmit(internal::io_request req) noexcept {
+        io_log.trace("dev {} : req {} retry", _ioq.id(), fmt::ptr(this));
+        _ts = io_queue::clock_type::now();
+        _dispatched_polls = engine().polls();
+        _ioq.resubmit_request(this, std::move(req));
+    }
+
+    // The whole merged read fails if any of its parts does, e.g. when one
+    // of them crosses the end of a device. Retry the parts one by one, so
+    // that only the ones that fail on their own report the error.
+    void retry_unmerged() noexcept {
+        auto merged = std::move(_merged);
+        _merged_length = 0;
+        _merged_iovs = {};
+        _fq_capacity = 0;
+        resubmit(*std::exchange(_unmerged, std::nullopt));
+        for (auto& m : merged) {
+            auto req = *std::exchange(m->_unmerged, std::nullopt);
+            m.release()->resubmit(std::move(req));
+        }
+    }
+
+    io_direction_and_length total_dnl() const noexcept {
+        return io_direction_and_length(_dnl.rw_idx(), _dnl.length() + _merged_length);
+    }
 
 public:
-    io_desc_read_write(io_queue& ioq, io_queue::priority_class_data& pc, stream_id stream, io_direction_and_length dnl, fair_queue_entry::capacity_t cap, iovec_keeper iovs)
+    io_desc_read_write(io_queue& ioq, io_queue::priority_class_data& pc, stream_id stream, io_direction_and_length dnl, fair_queue_entry::capacity_t cap, iovec_keeper iovs, uint64_t pos)
         : _ioq(ioq)
         , _pclass(pc)
         , _ts(io_queue::clock_type::now())
@@ -274,13 +357,19 @@ class io_desc_read_write final : public io_completion {
         , _fq_capacity(cap)
         , _iovs(std::move(iovs))
     {
-        io_log.trace("dev {} : req {} queue  len {} capacity {}", _ioq.id(), fmt::ptr(this), _dnl.length(), _fq_capacity);
+        // The fields after the capacity are what io_tester needs to replay the trace
+        io_log.trace("dev {} : req {} queue  len {} capacity {} dir {} class {} shares {} pos {}", _ioq.id(), fmt::ptr(this), _dnl.length(), _fq_capacity,
+                _dnl.rw_idx() == io_direction_and_length::read_idx ? "read" : "write", pc.fq_class(), pc.shares(), pos);
     }
 
     virtual void set_exception(std::exception_ptr eptr) noexcept override {
         io_log.trace("dev {} : req {} error", _ioq.id(), fmt::ptr(this));
-        _pclass.on_error();
         _ioq.complete_request(*this, std::chrono::duration<double>(0.0));
+        if (!_merged.empty()) {
+            retry_unmerged();
+            return;
+        }
+        _pclass.on_error();
         _pr.set_exception(eptr);
         delete this;
     }
@@ -291,24 +380,61 @@ class io_desc_read_write final : public io_completion {
         auto delay = std::chrono::duration_cast<std::chrono::duration<double>>(now - _ts);
         _pclass.on_complete(delay);
         _ioq.complete_request(*this, delay);
-        _pr.set_value(res);
+        _ioq.account_completion(total_dnl(), delay);
+        // Short reads are attributed in file order, as if the
+        // merged requests had been executed separately
+        auto own = std::min(res, _dnl.length());
+        res -= own;
+        for (auto& m : _merged) {
+            auto part = std::min(res, m->_dnl.length());
+            res -= part;
+            m.release()->complete_merged(part, delay);
+        }
+        _pr.set_value(own);
         delete this;
     }
 
     void cancel() noexcept {
         _pclass.on_cancel();
+        for (auto& m : _merged) {
+            m->_pclass.on_cancel();
+            m.release()->_pr.set_exception(std::make_exception_ptr(default_io_exception_factory::cancelled()));
+        }
         _pr.set_exception(std::make_exception_ptr(default_io_exception_factory::cancelled()));
         delete this;
     }
 
+    // Only requests with an intent have deadlines, and these are never merged
+    void expire() noexcept {
+        _pclass.on_expire();
+        _pr.set_exception(std::make_exception_ptr(timed_out_error()));
+        delete this;
+    }
+
     void dispatch() noexcept {
         io_log.trace("dev {} : req {} submit", _ioq.id(), fmt::ptr(this));
         auto now = io_queue::clock_type::now();
         _pclass.on_dispatch(_dnl, std::chrono::duration_cast<std::chrono::duration<double>>(now - _ts));
+        for (auto& m : _merged) {
+            m->_pclass.on_dispatch(m->_dnl, std::chrono::duration_cast<std::chrono::duration<double>>(now - m->_ts));
+            m->_ts = now;
+        }
         _ts = now;
         _dispatched_polls = engine().polls();
     }
 
+    // `own` is this read's request as it is before merging `req` into it
+    void merge(std::unique_ptr<io_desc_read_write> desc, const internal::io_request& own, const internal::io_request& req, iovec_keeper iovs, fair_queue_entry::capacity_t cap) {
+        if (!_unmerged) {
+            _unmerged = own;
+        }
+        desc->_unmerged = req;
+        _merged_length += desc->_dnl.length();
+        _merged.push_back(std::move(desc));
+        _merged_iovs = std::move(iovs);
+        _fq_capacity = cap;
+    }
+
     future<size_t> get_future() {
         return _pr.get_future();
     }
@@ -316,6 +442,8 @@ class io_desc_read_write final : public io_completion {
     fair_queue_entry::capacity_t capacity() const noexcept { return _fq_capacity; }
     stream_id stream() const noexcept { return _stream; }
     uint64_t polls() const noexcept { return _dispatched_polls; }
+    io_queue::priority_class_data& pclass() const noexcept { return _pclass; }
+    size_t nr_merged() const noexcept { return _merged.size(); }
 };
 
 class queued_io_request : private internal::io_request {
@@ -333,7 +461,7 @@ class queued_io_request : private internal::io_request {
         , _ioq(q)
         , _stream(_ioq.request_stream(dnl))
         , _fq_entry(cap)
-        , _desc(std::make_unique<io_desc_read_write>(_ioq, pc, _stream, dnl, cap, std::move(iovs)))
+        , _desc(std::make_unique<io_desc_read_write>(_ioq, pc, _stream, dnl, cap, std::move(iovs), request_pos(*this)))
     {
     }
 
@@ -346,6 +474,10 @@ class queued_io_request : private internal::io_request {
             return;
         }
 
+        auto& candidates = _desc->pclass().merge_candidates;
+        if (auto it = std::ranges::find(candidates, this); it != candidates.end()) {
+            candidates.erase(it);
+        }
         _intent.maybe_dequeue();
         _desc->dispatch();
         _ioq.submit_request(_desc.release(), std::move(*this));
@@ -357,14 +489,91 @@ class queued_io_request : private internal::io_request {
         _desc.release()->cancel();
     }
 
-    void set_intent(internal::cancellable_queue& cq) noexcept {
+    bool expired(io_queue::clock_type::time_point now) const noexcept {
+        return !is_cancelled() && _fq_entry.deadline() <= now;
+    }
+
+    // Drops the request that's about to be dispatched past its deadline.
+    // It's at the head of its class' queue, so it's also the first in the
+    // intent's cancellable queue
+    void expire() noexcept {
+        _intent.maybe_dequeue();
+        _ioq.cancel_request(*this);
+        _desc.release()->expire();
+    }
+
+    void set_intent(internal::cancellable_queue& cq, io_queue::clock_type::time_point deadline) noexcept {
         _intent.enqueue(cq);
+        _fq_entry.set_deadline(deadline);
     }
 
     future<size_t> get_future() noexcept { return _desc->get_future(); }
     fair_queue_entry& queue_entry() noexcept { return _fq_entry; }
     stream_id stream() const noexcept { return _stream; }
 
+    // The file range and buffers of a plain or vectored read
+    struct read_extent {
+        int fd;
+        uint64_t pos;
+        size_t length;
+        bool nowait_works;
+        std::span<const ::iovec> iovs;
+        ::iovec single;
+    };
+
+    static std::optional<read_extent> as_read_extent(const internal::io_request& req) noexcept {
+        switch (req.opcode()) {
+        case internal::io_request::operation::read: {
+            const auto& op = req.as<internal::io_request::operation::read>();
+            read_extent ext{op.fd, op.pos, op.size, op.nowait_works, {}, ::iovec{op.addr, op.size}};
+            return ext;
+        }
+        case internal::io_request::operation::readv: {
+            const auto& op = req.as<internal::io_request::operation::readv>();
+            return read_extent{op.fd, op.pos, internal::iovec_len(op.iovec, op.iov_len), op.nowait_works, {op.iovec, op.iov_len}, {}};
+        }
+        default:
+            return std::nullopt;
+        }
+    }
+
+    static std::span<const ::iovec> extent_iovecs(const read_extent& ext) noexcept {
+        return ext.iovs.empty() ? std::span<const ::iovec>(&ext.single, 1) : ext.iovs;
+    }
+
+    // Checks whether `req` immediately follows this read in the file and
+    // both can be done with one vectored read within the given limits
+    bool can_merge(const internal::io_request& req, size_t max_length, size_t max_iovecs) const noexcept {
+        auto ext = as_read_extent(*this);
+        auto next = as_read_extent(req);
+        return ext && next && ext->fd == next->fd && ext->pos + ext->length == next->pos
+                && ext->length + next->length <= max_length
+                && extent_iovecs(*ext).size() + extent_iovecs(*next).size() <= max_iovecs;
+    }
+
+    // Turns this read into a vectored one that also reads `req`, see
+    // can_merge(). `desc` is completed together with this request.
+    void merge(const internal::io_request& req, std::unique_ptr<io_desc_read_write> desc) {
+        auto ext = *as_read_extent(*this);
+        auto next = *as_read_extent(req);
+        auto own_iovs = extent_iovecs(ext);
+        auto next_iovs = extent_iovecs(next);
+        iovec_keeper iovs;
+        iovs.reserve(own_iovs.size() + next_iovs.size());
+        iovs.insert(iovs.end(), own_iovs.begin(), own_iovs.end());
+        iovs.insert(iovs.end(), next_iovs.begin(), next_iovs.end());
+
+        auto merged_dnl = io_direction_and_length(io_direction_read, ext.length + next.length);
+        auto cap = _ioq.request_capacity(merged_dnl);
+        // The vector's storage survives being moved into the descriptor below
+        auto merged = internal::io_request::make_readv(ext.fd, ext.pos, iovs, ext.nowait_works && next.nowait_works);
+        _desc->merge(std::move(desc), *this, req, std::move(iovs), cap);
+        static_cast<internal::io_request&>(*this) = merged;
+        _ioq.update_queued_capacity(*this, cap);
+    }
+
+    size_t nr_merged() const noexcept { return _desc->nr_merged(); }
+
     static queued_io_request& from_fq_entry(fair_queue_entry& ent) noexcept {
         return *boost::intrusive::get_parent_from_member(&ent, &queued_io_request::_fq_entry);
     }
@@ -581,6 +790,25 @@ void io_queue::update_flow_ratio() noexcept {
     }
 }
 
+void io_queue::account_completion(io_direction_and_length dnl, std::chrono::duration<double> delay) noexcept {
+    const auto& cfg = get_config();
+    if (!cfg.adaptive_cost_model) {
+        return;
+    }
+    auto idx = dnl.rw_idx();
+    _cost_model_stats.completed[idx]++;
+    _cost_model_stats.latency_ns[idx] += std::chrono::duration_cast<std::chrono::nanoseconds>(delay).count();
+    _cost_model_stats.micro_tokens[idx] += internal::request_tokens(dnl, cfg) * 1e6;
+}
+
+void io_queue::update_cost_model() noexcept {
+    if (!get_config().adaptive_cost_model) {
+        return;
+    }
+    _group->account_cost_model_stats(std::exchange(_cost_model_stats, {}));
+    _group->maybe_adapt_cost_model(std::chrono::duration_cast<clock_type::duration>(_group->io_latency_goal() * get_config().averaging_decay_ticks));
+}
+
 void io_queue::lower_stall_threshold() noexcept {
     auto new_threshold = _stall_threshold - std::chrono::milliseconds(1);
     _stall_threshold = std::max(_stall_threshold_min, new_threshold);
@@ -604,6 +832,9 @@ fair_queue::config io_queue::make_fair_queue_config(const config& iocfg, sstring
     fair_queue::config cfg;
     cfg.label = label;
     cfg.forgiving_factor = io_throttler::fixed_point_factor * io_throttler::token_bucket_t::rate_cast(iocfg.tau).count();
+    if (iocfg.calendar_class_selection) {
+        cfg.selection = fair_queue::config::class_selection::calendar;
+    }
     return cfg;
 }
 
@@ -615,6 +846,7 @@ io_queue::io_queue(io_group_ptr group, internal::io_sink& sink)
     , _averaging_decay_timer([this] {
         update_flow_ratio();
         lower_stall_threshold();
+        update_cost_model();
     })
     , _stall_threshold_min(std::max(get_config().stall_threshold, 1ms))
     , _stall_threshold(_stall_threshold_min)
@@ -639,6 +871,39 @@ io_queue::io_queue(io_group_ptr group, internal::io_sink& sink)
                 sm::description("Ratio of dispatch rate to completion rate. Is expected to be 1.0+ growing larger on reactor stalls or (!) disk problems"),
                 { owner_l, mnt_l, group_l }),
     });
+    if (cfg.capacity_lending) {
+        _metric_groups.add_group("io_queue", {
+            sm::make_counter("borrowed_capacity", [this] {
+                    double tokens = 0;
+                    for (const auto& st : _streams) {
+                        tokens += io_throttler::capacity_tokens(st._borrowed);
+                    }
+                    return tokens;
+                }, sm::description("Disk capacity units reserved by this shard in excess of its per-tick share, lent by idle shards"),
+                { owner_l, mnt_l, group_l }),
+            sm::make_gauge("backlogged_shards", [this] {
+                    unsigned nr = 0;
+                    for (const auto& st : _streams) {
+                        nr += st.out.nr_backlogged();
+                    }
+                    return nr;
+                }, sm::description("Number of shards in the IO group that have requests waiting for disk capacity, summed over the read and write streams"),
+                { owner_l, mnt_l, group_l }),
+        });
+    }
+    if (cfg.adaptive_cost_model) {
+        _metric_groups.add_group("io_queue", {
+            sm::make_gauge("cost_model_rate_ratio", [this] { return _group->rate_ratio(); },
+                    sm::description("Replenish rate of the IO group relative to the static io-properties, as estimated from observed latencies"),
+                    { owner_l, mnt_l, group_l }),
+            sm::make_gauge("cost_model_read_factor", [this] { return _group->cost_factor(io_direction_read); },
+                    sm::description("Correction applied to the cost of read requests, as estimated from observed latencies"),
+                    { owner_l, mnt_l, group_l }),
+            sm::make_gauge("cost_model_write_factor", [this] { return _group->cost_factor(io_direction_write); },
+                    sm::description("Correction applied to the cost of write requests, as estimated from observed latencies"),
+                    { owner_l, mnt_l, group_l }),
+        });
+    }
 }
 
 io_throttler::config io_group::configure_throttler(const io_queue::config& qcfg) noexcept {
@@ -651,11 +916,95 @@ io_throttler::config io_group::configure_throttler(const io_queue::config& qcfg)
     double limit_min_size = std::max(io_queue::read_request_base_count, qcfg.disk_blocks_write_to_read_multiplier) * qcfg.block_count_limit_min;
     cfg.limit_min_tokens = limit_min_weight / qcfg.req_count_rate + limit_min_size / qcfg.blocks_count_rate;
     cfg.rate_limit_duration = qcfg.rate_limit_duration;
+    cfg.capacity_lending = qcfg.capacity_lending;
     return cfg;
 }
 
 std::chrono::duration<double> io_group::io_latency_goal() const noexcept {
-    return _fgs.front().rate_limit_duration();
+    // Not derived from the throttlers on the fly, as the adaptive
+    // cost model changes their rate but not the goal
+    return _latency_goal;
+}
+
+void io_group::account_cost_model_stats(const internal::io_cost_model_stats& st) noexcept {
+    for (unsigned idx = 0; idx < 2; idx++) {
+        _cost_model.completed[idx].fetch_add(st.completed[idx], std::memory_order_relaxed);
+        _cost_model.latency_ns[idx].fetch_add(st.latency_ns[idx], std::memory_order_relaxed);
+        _cost_model.micro_tokens[idx].fetch_add(st.micro_tokens[idx], std::memory_order_relaxed);
+    }
+    _cost_model.throttled.fetch_add(st.throttled, std::memory_order_relaxed);
+}
+
+void io_group::maybe_adapt_cost_model(io_queue::clock_type::duration period) noexcept {
+    if (!_cost_model.lock.try_lock()) {
+        return; // another shard is on it
+    }
+    auto unlock = defer([this] () noexcept { _cost_model.lock.unlock(); });
+    auto now = io_queue::clock_type::now();
+    if (now - _cost_model.last_update < period) {
+        return;
+    }
+    _cost_model.last_update = now;
+
+    internal::io_cost_model_stats st;
+    for (unsigned idx = 0; idx < 2; idx++) {
+        st.completed[idx] = _cost_model.completed[idx].exchange(0, std::memory_order_relaxed);
+        st.latency_ns[idx] = _cost_model.latency_ns[idx].exchange(0, std::memory_order_relaxed);
+        st.micro_tokens[idx] = _cost_model.micro_tokens[idx].exchange(0, std::memory_order_relaxed);
+    }
+    st.throttled = _cost_model.throttled.exchange(0, std::memory_order_relaxed);
+    adapt_cost_model(st);
+}
+
+void io_group::adapt_cost_model(const internal::io_cost_model_stats& st) noexcept {
+    // Don't react to a handful of requests, their latencies say little
+    static constexpr uint64_t min_samples = 16;
+    // Limits on how much a single step may change the model
+    static constexpr double max_decrease = 0.5;
+    static constexpr double increase = 1.05;
+    // Weight of the previous per-direction factor in its moving average
+    static constexpr double cost_factor_ema = 0.7;
+    static constexpr double min_cost_factor = 0.25;
+    static constexpr double max_cost_factor = 4.0;
+
+    auto total = st.completed[io_direction_read] + st.completed[io_direction_write];
+    if (total < min_samples) {
+        return;
+    }
+
+    double goal = std::chrono::duration_cast<std::chrono::duration<double, std::nano>>(_latency_goal).count();
+    double mean = double(st.latency_ns[io_direction_read] + st.latency_ns[io_direction_write]) / total;
+    auto ratio = _cost_model.rate_ratio.load(std::memory_order_relaxed);
+    if (mean > goal) {
+        // The device is slower than the model predicts, back off proportionally
+        ratio *= std::max(max_decrease, goal / mean);
+    } else if (st.throttled && mean < goal / 2) {
+        // The model held requests back while the device still had headroom
+        ratio *= increase;
+    }
+    ratio = std::clamp(ratio, _config.adaptive_min_rate_ratio, _config.adaptive_max_rate_ratio);
+    if (ratio != _cost_model.rate_ratio.load(std::memory_order_relaxed)) {
+        io_log.debug("IO group for {}: mean latency {:.1f}us (goal {:.1f}us), scaling rate to {:.3f}", _config.mountpoint, mean / 1000, goal / 1000, ratio);
+        _cost_model.rate_ratio.store(ratio, std::memory_order_relaxed);
+        for (auto& fg : _fgs) {
+            fg.update_rate_ratio(ratio);
+        }
+    }
+
+    if (st.completed[io_direction_read] < min_samples || st.completed[io_direction_write] < min_samples
+            || !st.micro_tokens[io_direction_read] || !st.micro_tokens[io_direction_write]) {
+        return;
+    }
+    // Latency per predicted token of each direction vs. both of them together
+    double overall = double(st.latency_ns[io_direction_read] + st.latency_ns[io_direction_write])
+            / (st.micro_tokens[io_direction_read] + st.micro_tokens[io_direction_write]);
+    for (auto idx : {io_direction_read, io_direction_write}) {
+        double per_token = double(st.latency_ns[idx]) / st.micro_tokens[idx];
+        auto target = std::clamp(per_token / overall, min_cost_factor, max_cost_factor);
+        auto factor = _cost_model.cost_factor[idx].load(std::memory_order_relaxed);
+        factor = factor * cost_factor_ema + target * (1.0 - cost_factor_ema);
+        _cost_model.cost_factor[idx].store(std::clamp(factor, min_cost_factor, max_cost_factor), std::memory_order_relaxed);
+    }
 }
 
 io_group::io_group(io_queue::config io_cfg, unsigned nr_queues)
@@ -667,6 +1016,7 @@ io_group::io_group(io_queue::config io_cfg, unsigned nr_queues)
     if (_config.duplex) {
         _fgs.emplace_back(throttler_config, nr_queues);
     }
+    _latency_goal = _fgs.front().rate_limit_duration();
 
     auto goal = io_latency_goal();
     auto lvl = goal > 1.1 * _config.rate_limit_duration ? log_level::warn : log_level::debug;
@@ -764,6 +1114,12 @@ std::vector<seastar::metrics::impl::metric_definition_impl> io_queue::priority_c
                     sm::description("Total number of requests split")),
             sm::make_counter("total_split_bytes", _splits.bytes,
                     sm::description("Total number of bytes split")),
+            sm::make_counter("total_expired_ops", _nr_expired,
+                    sm::description("Total number of requests dropped from the queue past their deadline")),
+            sm::make_counter("total_merged_ops", _merges.ops,
+                    sm::description("Total number of reads merged into an adjacent queued read")),
+            sm::make_counter("total_merged_bytes", _merges.bytes,
+                    sm::description("Total number of bytes read by reads merged into an adjacent queued read")),
             sm::make_counter("total_delay_sec", [this] {
                     return _total_queue_time.count();
                 }, sm::description("Total time spent in the queue")),
@@ -909,6 +1265,15 @@ double internal::request_tokens(io_direction_and_length dnl, const io_queue::con
 fair_queue_entry::capacity_t io_queue::request_capacity(io_direction_and_length dnl) const noexcept {
     const auto& cfg = get_config();
     auto tokens = internal::request_tokens(dnl, cfg);
+    if (cfg.adaptive_cost_model) {
+        auto stream = request_stream(dnl);
+        tokens *= _group->cost_factor(dnl.rw_idx());
+        if (_flow_ratio > cfg.flow_ratio_backpressure_threshold) {
+            tokens *= _flow_ratio;
+        }
+        // A scaled-up cost must still fit the bucket
+        return std::min(_streams[stream].out.tokens_capacity(tokens), _streams[stream].out.maximum_capacity());
+    }
     if (_flow_ratio <= cfg.flow_ratio_backpressure_threshold) {
         return _streams[request_stream(dnl)].out.tokens_capacity(tokens);
     }
@@ -931,15 +1296,28 @@ future<size_t> io_queue::queue_one_request(internal::priority_class pc, io_direc
         // First time will hit here, and then we create the class. It is important
         // that we create the shared pointer in the same shard it will be used at later.
         auto& pclass = find_or_create_class(pc);
+        // Reads with an intent are not merged, as the merged request would
+        // be cancelled along with any of the intents
+        if (intent == nullptr && dnl.rw_idx() == io_direction_read) {
+            if (auto merged = try_merge_read(pclass, dnl, req, iovs)) {
+                return std::move(*merged);
+            }
+        }
         auto cap = request_capacity(dnl);
         auto queued_req = std::make_unique<queued_io_request>(std::move(req), *this, cap, pclass, std::move(dnl), std::move(iovs));
         auto fut = queued_req->get_future();
         if (intent != nullptr) {
             auto& cq = intent->find_or_create_cancellable_queue(_id, pc.id());
-            queued_req->set_intent(cq);
+            queued_req->set_intent(cq, intent->deadline());
         }
 
         _streams[queued_req->stream()].fq.queue(pclass.fq_class(), queued_req->queue_entry());
+        if (intent == nullptr && dnl.rw_idx() == io_direction_read) {
+            if (pclass.merge_candidates.size() == priority_class_data::max_merge_candidates) {
+                pclass.merge_candidates.erase(pclass.merge_candidates.begin());
+            }
+            pclass.merge_candidates.push_back(queued_req.get());
+        }
         queued_req.release();
         pclass.on_queue();
         _queued_requests++;
@@ -947,6 +1325,31 @@ future<size_t> io_queue::queue_one_request(internal::priority_class pc, io_direc
     });
 }
 
+std::optional<future<size_t>> io_queue::try_merge_read(priority_class_data& pclass, io_direction_and_length dnl, const internal::io_request& req, iovec_keeper& iovs) {
+    const auto& cfg = get_config();
+    if (!cfg.merge_reads || pclass.merge_candidates.empty()) {
+        return std::nullopt;
+    }
+    auto max_length = std::min<size_t>(cfg.disk_read_saturation_length, _group->_max_request_length[io_direction_read]);
+    // Most recent candidates first, sequential readers append to the tail
+    for (auto it = pclass.merge_candidates.rbegin(); it != pclass.merge_candidates.rend(); ++it) {
+        auto& candidate = **it;
+        if (candidate.nr_merged() < cfg.max_merged_requests && candidate.can_merge(req, max_length, IOV_MAX)) {
+            auto desc = std::make_unique<io_desc_read_write>(*this, pclass, candidate.stream(), dnl, 0, std::move(iovs), request_pos(req));
+            auto fut = desc->get_future();
+            candidate.merge(req, std::move(desc));
+            pclass.on_queue();
+            pclass.on_merge(dnl);
+            return fut;
+        }
+    }
+    return std::nullopt;
+}
+
+void io_queue::update_queued_capacity(queued_io_request& req, fair_queue_entry::capacity_t cap) noexcept {
+    _streams[req.stream()].fq.update_capacity(req.queue_entry(), cap);
+}
+
 future<size_t> io_queue::queue_request(internal::priority_class pc, io_direction_and_length dnl, internal::io_request req, io_intent* intent, iovec_keeper iovs) noexcept {
     size_t max_length = _group->_max_request_length[dnl.rw_idx()];
 
@@ -1042,6 +1445,7 @@ future<size_t> io_queue::submit_io_write(size_t len, internal::io_request req, i
 // This is far from ideal, but it's something.
 
 void io_queue::poll_io_queue() {
+    std::optional<clock_type::time_point> now;
     for (auto&& st : _streams) {
         st.out.maybe_replenish_capacity(st.replenish);
         auto available = st.reap_pending_capacity();
@@ -1050,11 +1454,28 @@ void io_queue::poll_io_queue() {
             auto* ent = st.fq.top();
             if (ent == nullptr) {
                 available.ready_tokens = 0;
+                st.maybe_mark_idle();
                 break;
             }
 
+            if (ent->has_deadline()) {
+                auto& req = queued_io_request::from_fq_entry(*ent);
+                if (!now) {
+                    now = clock_type::now();
+                }
+                if (req.expired(*now)) {
+                    // Its capacity is zeroed, so it's popped without grabbing tokens
+                    req.expire();
+                    st.fq.pop_front();
+                    req.dispatch();
+                    continue;
+                }
+            }
+
             auto result = st.grab_capacity(ent->capacity(), available);
             if (result == stream::grab_result::stop) {
+                _cost_model_stats.throttled++;
+                st.mark_backlogged();
                 break;
             }
             if (result == stream::grab_result::again) {
@@ -1083,6 +1504,12 @@ void io_queue::submit_request(io_desc_read_write* desc, internal::io_request req
     _sink.submit(desc, std::move(req));
 }
 
+void io_queue::resubmit_request(io_desc_read_write* desc, internal::io_request req) noexcept {
+    _requests_executing++;
+    _requests_dispatched++;
+    _sink.submit(desc, std::move(req));
+}
+
 void io_queue::cancel_request(queued_io_request& req) noexcept {
     _queued_requests--;
     _streams[req.stream()].fq.notify_request_cancelled(req.queue_entry());
@@ -1201,7 +1628,7 @@ io_queue::clock_type::time_point io_queue::stream::next_pending_aio() const noex
 }
 
 auto io_queue::stream::grab_capacity(capacity_t cap, reap_result& available) -> grab_result {
-    const uint64_t max_unamortized_reservation = out.per_tick_grab_threshold();
+    const uint64_t max_unamortized_reservation = _backlogged ? out.lending_grab_threshold() : out.per_tick_grab_threshold();
 
     if (cap <= available.ready_tokens) {
         // We can dispatch the request immediately.
@@ -1235,6 +1662,7 @@ auto io_queue::stream::grab_capacity(capacity_t cap, reap_result& available) ->
         // but the token bucket has an assert for that, and its a reasonable expectation, so let's respect that limit.
         // It shouldn't matter in practice.
         grab_amount = std::min<capacity_t>(grab_amount, out.maximum_capacity());
+        _borrowed += grab_amount - std::min<capacity_t>(grab_amount, recycled + out.per_tick_grab_threshold());
         out.refund_tokens(recycled);
         // Replace _pending with a new reservation starting at the current
         // group bucket tail.
@@ -1252,6 +1680,36 @@ auto io_queue::stream::grab_capacity(capacity_t cap, reap_result& available) ->
     }
 }
 
+// Backlogged queues split the per-tick capacity of the group among
+// themselves rather than all queues doing so, see io_throttler::lending_grab_threshold().
+// A queue stays backlogged for a rate-limit duration after it last was,
+// so that queues that drain on every poll under moderate load don't flap.
+// The replenish timestamp is used as "now" to avoid reading the clock,
+// it lags behind by at most the token bucket threshold.
+void io_queue::stream::mark_backlogged() noexcept {
+    if (!out.capacity_lending()) {
+        return;
+    }
+    _backlogged_ts = replenish;
+    if (!_backlogged) {
+        _backlogged = true;
+        out.on_backlog_start();
+    }
+}
+
+void io_queue::stream::maybe_mark_idle() noexcept {
+    if (_backlogged && replenish - _backlogged_ts > out.rate_limit_duration()) {
+        _backlogged = false;
+        out.on_backlog_end();
+    }
+}
+
+io_queue::stream::~stream() {
+    if (_backlogged) {
+        out.on_backlog_end();
+    }
+}
+
 std::vector<seastar::metrics::impl::metric_definition_impl> io_queue::stream::metrics(const priority_class_data& pc) {
     namespace sm = seastar::metrics;
     auto c = pc.fq_class();
@@ -112,6 +112,7 @@ module seastar;
 #include <seastar/core/cacheline.hh>
 #include <seastar/core/memory.hh>
 #include <seastar/core/print.hh>
+#include <seastar/core/scheduling.hh>
 #include <seastar/util/alloc_failure_injector.hh>
 #include <seastar/util/memory_diagnostics.hh>
 #include <seastar/util/std-compat.hh>
@@ -247,7 +248,7 @@ std::atomic<bool> use_transparent_hugepages = true;
 namespace alloc_stats {
 
 enum class types { allocs, frees, cross_cpu_frees, reclaims, large_allocs, failed_allocs,
-    foreign_mallocs, foreign_frees, foreign_cross_frees, enum_size };
+    foreign_mallocs, foreign_frees, foreign_cross_frees, cross_cpu_free_batches, enum_size };
 
 using stats_array = std::array<uint64_t, static_cast<std::size_t>(types::enum_size)>;
 using stats_atomic_array = std::array<std::atomic_uint64_t, static_cast<std::size_t>(types::enum_size)>;
@@ -320,6 +321,7 @@ class page_list_link {
     uint32_t _prev;
     uint32_t _next;
     friend class page_list;
+    friend class small_pool;
     friend seastar::internal::log_buf::inserter_iterator do_dump_memory_diagnostics(seastar::internal::log_buf::inserter_iterator);
 };
 
@@ -451,6 +453,9 @@ class small_pool {
     inline void* allocate();
     void deallocate(void* object);
     unsigned object_size() const { return _object_size; }
+    unsigned max_free() const { return _max_free; }
+    void set_max_free(unsigned max_free);
+    unsigned live_objects();
     /// See _sampled_pool
     bool is_sampled_pool() const {
 #ifdef SEASTAR_HEAPPROF
@@ -546,6 +551,39 @@ struct cross_cpu_free_item {
     cross_cpu_free_item* next;
 };
 
+// Objects freed by a reactor thread on behalf of another shard are collected
+// here and spliced onto the owner's xcpu_freelist with a single atomic
+// operation, rather than one per object.
+struct cross_cpu_free_batch {
+    unsigned cpu_id = 0;
+    unsigned count = 0;
+    cross_cpu_free_item* head = nullptr;
+    cross_cpu_free_item* tail = nullptr;
+};
+
+// Freed spans of 64k to 2M are kept here instead of being merged back into
+// the buddy allocator, and are handed out again as-is to allocations of the
+// same (power of two) size. This avoids splitting and coalescing spans for
+// workloads that churn I/O-sized buffers. Cached spans count as free memory
+// and are flushed back to the buddy allocator before reclaimers are run.
+struct large_span_cache {
+    static constexpr unsigned min_order = log2ceil(64 * 1024 / page_size);
+    static constexpr unsigned max_order = log2ceil(2 * 1024 * 1024 / page_size);
+    // By default up to 1/default_fraction of the shard's memory is cached.
+    static constexpr unsigned default_fraction = 32;
+    page_list spans[max_order - min_order + 1];
+    uint32_t cached_pages = 0;
+    std::optional<size_t> max_pages; // unset: default_fraction of the shard
+    uint64_t hits = 0;
+
+    static bool cacheable(unsigned order) {
+        return order >= min_order && order <= max_order;
+    }
+    page_list& list(unsigned order) {
+        return spans[order - min_order];
+    }
+};
+
 struct cpu_pages {
     small_pool_array<false> small_pools;
     uint32_t min_free_pages = 20000000 / page_size;
@@ -588,6 +626,13 @@ struct cpu_pages {
     std::vector<reclaimer*> reclaimers;
     static constexpr unsigned nr_span_lists = 32;
     page_list free_spans[nr_span_lists];  // contains aligned spans with span_size == 2^idx
+    large_span_cache large_spans;
+    // Batches are direct-mapped by owner shard; a collision flushes the
+    // batch already occupying the slot.
+    static constexpr unsigned nr_xcpu_free_batches = 16;
+    static constexpr unsigned xcpu_free_batch_size = 128;
+    cross_cpu_free_batch xcpu_free_batches[nr_xcpu_free_batches];
+    unsigned nr_pending_xcpu_free_batches = 0;
     alignas(seastar::cache_line_size) std::atomic<cross_cpu_free_item*> xcpu_freelist;
     static std::atomic<unsigned> cpu_id_gen;
     static cpu_pages* all_cpus[max_cpus];
@@ -600,6 +645,7 @@ struct cpu_pages {
     } asu;
     allocation_site_ptr alloc_site_list_head = nullptr; // For easy traversal of asu.alloc_sites from scylla-gdb.py
     sampler heap_prof_sampler;
+    std::array<scheduling_group_heap_stats, max_scheduling_groups()> sg_heap_stats;
     small_pool_array<true> sampled_small_pools;
 
     char* mem() { return memory; }
@@ -617,6 +663,10 @@ struct cpu_pages {
     page* find_and_unlink_span(unsigned nr_pages);
     page* find_and_unlink_span_reclaiming(unsigned n_pages);
     void free_large(void* ptr);
+    page* take_cached_span(unsigned nr_pages);
+    bool cache_span(pageidx start, uint32_t nr_pages);
+    bool flush_span_cache(size_t max_cached_pages = 0);
+    size_t max_cached_span_pages() const;
     bool grow_span(pageidx& start, uint32_t& nr_pages, unsigned idx);
     void free_span(pageidx start, uint32_t nr_pages);
     void free_span_no_merge(pageidx start, uint32_t nr_pages);
@@ -628,6 +678,10 @@ struct cpu_pages {
     static void do_foreign_free(void* ptr);
     void shrink(void* ptr, size_t new_size);
     static void free_cross_cpu(unsigned cpu_id, void* ptr);
+    static void splice_cross_cpu_frees(unsigned cpu_id, cross_cpu_free_item* head, cross_cpu_free_item* tail);
+    void batch_cross_cpu_free(unsigned cpu_id, cross_cpu_free_item* item);
+    void flush_cross_cpu_free_batch(cross_cpu_free_batch& batch);
+    bool flush_cross_cpu_free_batches();
     bool drain_cross_cpu_freelist();
     size_t object_size(void* ptr);
 
@@ -814,6 +868,9 @@ cpu_pages::find_and_unlink_span_reclaiming(unsigned n_pages) {
         if (span) {
             return span;
         }
+        if (flush_span_cache()) {
+            continue;
+        }
         if (run_reclaimers(reclaimer_scope::sync, n_pages) == reclaiming_result::reclaimed_nothing) {
             return nullptr;
         }
@@ -839,9 +896,12 @@ cpu_pages::allocate_large_and_trim(unsigned n_pages, bool should_sample) {
     if (nr_pages && n_pages >= nr_pages) {
         return nullptr;
     }
-    page* span = find_and_unlink_span_reclaiming(n_pages);
+    page* span = take_cached_span(n_pages);
     if (!span) {
-        return nullptr;
+        span = find_and_unlink_span_reclaiming(n_pages);
+        if (!span) {
+            return nullptr;
+        }
     }
     auto span_size = span->span_size;
     auto span_idx = span - pages;
@@ -877,9 +937,15 @@ cpu_pages::warn_large_allocation(size_t size) {
 allocation_site_ptr
 cpu_pages::add_alloc_site(size_t allocated_size) {
     allocation_site_ptr alloc_site = get_allocation_site();
+    auto sample_size = heap_prof_sampler.sample_size(allocated_size);
+    auto sg_index = alloc_site ? alloc_site->scheduling_group_index : seastar::internal::scheduling_group_index(current_scheduling_group());
+    auto& sg_stats = sg_heap_stats[sg_index];
+    ++sg_stats.sampled_allocations;
+    sg_stats.allocated_bytes += sample_size;
     if (alloc_site) {
         ++alloc_site->count;
-        alloc_site->size += heap_prof_sampler.sample_size(allocated_size);
+        alloc_site->size += sample_size;
+        sg_stats.live_bytes += sample_size;
     }
 
     return alloc_site;
@@ -892,6 +958,8 @@ cpu_pages::remove_alloc_site(allocation_site_ptr alloc_site, size_t deallocated_
         auto sample_size = heap_prof_sampler.sample_size(deallocated_size);
         // prevent underflow in case sample rate changed
         alloc_site->size -= alloc_site->size < sample_size ? alloc_site->size : sample_size;
+        auto& live_bytes = sg_heap_stats[alloc_site->scheduling_group_index].live_bytes;
+        live_bytes -= live_bytes < sample_size ? live_bytes : sample_size;
         if (alloc_site->count == 0) {
             if (alloc_site->prev) {
                 alloc_site->prev->next = alloc_site->next;
@@ -974,6 +1042,7 @@ allocation_site_ptr get_allocation_site() {
     disable_backtrace_temporarily dbt;
     allocation_site new_alloc_site;
     new_alloc_site.backtrace = get_backtrace();
+    new_alloc_site.scheduling_group_index = seastar::internal::scheduling_group_index(current_scheduling_group());
     if (cpu_mem.asu.alloc_sites.size() >= 1000
         && cpu_mem.asu.alloc_sites.find(new_alloc_site) == cpu_mem.asu.alloc_sites.end()) {
         // Drop sample for now. Could do something smarter like dropping a
@@ -1032,7 +1101,68 @@ void cpu_pages::free_large(void* ptr) {
         remove_alloc_site(alloc_site, span->span_size * page_size);
     }
 #endif
-    free_span(idx, span->span_size);
+    if (!cache_span(idx, span->span_size)) {
+        free_span(idx, span->span_size);
+    }
+}
+
+size_t cpu_pages::max_cached_span_pages() const {
+    return large_spans.max_pages.value_or(nr_pages / large_span_cache::default_fraction);
+}
+
+// Returns a cached span that fits nr_pages exactly as the buddy allocator
+// would (i.e. with size of the next power of two), unlinked and not yet
+// accounted as used. The caller takes it over like a span returned by
+// find_and_unlink_span().
+page* cpu_pages::take_cached_span(unsigned n_pages) {
+    auto order = index_of(n_pages);
+    if (!large_span_cache::cacheable(order)) {
+        return nullptr;
+    }
+    auto& list = large_spans.list(order);
+    if (list.empty()) {
+        return nullptr;
+    }
+    page* span = &list.front(pages);
+    list.pop_front(pages);
+    large_spans.cached_pages -= span->span_size;
+    ++large_spans.hits;
+    return span;
+}
+
+// Caches a freed large span instead of merging it with its buddies. The span
+// is left marked as used so that neighbouring frees don't coalesce with it.
+bool cpu_pages::cache_span(pageidx start, uint32_t n_pages) {
+    auto order = index_of(n_pages);
+    if (!large_span_cache::cacheable(order) || n_pages != (1u << order)
+            || large_spans.cached_pages + n_pages > max_cached_span_pages()) {
+        return false;
+    }
+    auto span = &pages[start];
+    new (&span->link) page_list_link();
+    large_spans.list(order).push_front(pages, *span);
+    large_spans.cached_pages += n_pages;
+    nr_free_pages += n_pages;
+    return true;
+}
+
+// Returns cached spans to the buddy allocator until at most max_cached_pages
+// remain cached, largest first. Returns whether anything was flushed.
+bool cpu_pages::flush_span_cache(size_t max_cached_pages) {
+    bool flushed = false;
+    for (unsigned order = large_span_cache::max_order + 1; order-- > large_span_cache::min_order;) {
+        auto& list = large_spans.list(order);
+        while (!list.empty() && large_spans.cached_pages > max_cached_pages) {
+            page* span = &list.front(pages);
+            list.pop_front(pages);
+            auto n_pages = span->span_size;
+            large_spans.cached_pages -= n_pages;
+            nr_free_pages -= n_pages; // free_span() will restore
+            free_span(span - pages, n_pages);
+            flushed = true;
+        }
+    }
+    return flushed;
 }
 
 size_t cpu_pages::object_size(void* ptr) {
@@ -1060,17 +1190,68 @@ void cpu_pages::free_cross_cpu(unsigned cpu_id, void* ptr) {
         return;
     }
     auto p = reinterpret_cast<cross_cpu_free_item*>(ptr);
+    if (is_reactor_thread) {
+        // Flushed by the reactor's cross cpu free poller, at the latest.
+        get_cpu_mem().batch_cross_cpu_free(cpu_id, p);
+    } else {
+        splice_cross_cpu_frees(cpu_id, p, p);
+        alloc_stats::increment(alloc_stats::types::cross_cpu_free_batches);
+    }
+    alloc_stats::increment(alloc_stats::types::cross_cpu_frees);
+}
+
+void cpu_pages::splice_cross_cpu_frees(unsigned cpu_id, cross_cpu_free_item* head, cross_cpu_free_item* tail) {
     auto& list = all_cpus[cpu_id]->xcpu_freelist;
     auto old = list.load(std::memory_order_relaxed);
     do {
-        p->next = old;
-    } while (!list.compare_exchange_weak(old, p, std::memory_order_release, std::memory_order_relaxed));
-    alloc_stats::increment(alloc_stats::types::cross_cpu_frees);
+        tail->next = old;
+    } while (!list.compare_exchange_weak(old, head, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void cpu_pages::batch_cross_cpu_free(unsigned cpu_id, cross_cpu_free_item* item) {
+    auto& batch = xcpu_free_batches[cpu_id % nr_xcpu_free_batches];
+    if (batch.head && batch.cpu_id != cpu_id) {
+        flush_cross_cpu_free_batch(batch);
+    }
+    if (!batch.head) {
+        batch.cpu_id = cpu_id;
+        batch.tail = item;
+        ++nr_pending_xcpu_free_batches;
+    }
+    item->next = batch.head;
+    batch.head = item;
+    if (++batch.count >= xcpu_free_batch_size) {
+        flush_cross_cpu_free_batch(batch);
+    }
+}
+
+void cpu_pages::flush_cross_cpu_free_batch(cross_cpu_free_batch& batch) {
+    // The owner may have gone away since the objects were batched; leak them
+    // as free_cross_cpu() does.
+    if (live_cpus[batch.cpu_id].load(std::memory_order_relaxed)) {
+        splice_cross_cpu_frees(batch.cpu_id, batch.head, batch.tail);
+    }
+    alloc_stats::increment_local(alloc_stats::types::cross_cpu_free_batches);
+    batch = {};
+    --nr_pending_xcpu_free_batches;
+}
+
+bool cpu_pages::flush_cross_cpu_free_batches() {
+    if (!nr_pending_xcpu_free_batches) {
+        return false;
+    }
+    for (auto& batch : xcpu_free_batches) {
+        if (batch.head) {
+            flush_cross_cpu_free_batch(batch);
+        }
+    }
+    return true;
 }
 
 bool cpu_pages::drain_cross_cpu_freelist() {
+    auto flushed = flush_cross_cpu_free_batches();
     if (!xcpu_freelist.load(std::memory_order_relaxed)) {
-        return false;
+        return flushed;
     }
     auto p = xcpu_freelist.exchange(nullptr, std::memory_order_acquire);
     while (p) {
@@ -1228,6 +1409,7 @@ void cpu_pages::shrink(void* ptr, size_t new_size) {
 
 cpu_pages::~cpu_pages() {
     if (is_initialized()) {
+        flush_cross_cpu_free_batches();
         live_cpus[cpu_id].store(false, std::memory_order_relaxed);
     }
 }
@@ -1448,6 +1630,25 @@ small_pool::small_pool(unsigned object_size, bool is_sampled) noexcept
     _free = nullptr;
 }
 
+void
+small_pool::set_max_free(unsigned max_free) {
+    _max_free = std::max(max_free, 2u);
+    _min_free = _max_free / 2;
+    if (_free_count >= _max_free) {
+        trim_free_list();
+    }
+}
+
+unsigned
+small_pool::live_objects() {
+    auto pages = get_cpu_mem().pages;
+    uint32_t span_freelist_objs = 0;
+    for (auto idx = _span_list.empty() ? 0 : &_span_list.front(pages) - pages; idx; idx = pages[idx].link._next) {
+        span_freelist_objs += pages[idx].span_size * page_size / _object_size - pages[idx].nr_small_alloc;
+    }
+    return _pages_in_use * page_size / _object_size - _free_count - span_freelist_objs;
+}
+
 small_pool::~small_pool() {
     _min_free = _max_free = 0;
     trim_free_list();
@@ -1849,6 +2050,48 @@ void disable_large_allocation_warning() {
     get_cpu_mem().large_allocation_warning_threshold.set(std::numeric_limits<size_t>::max());
 }
 
+void set_large_span_cache_size(size_t bytes) {
+    auto& cm = get_cpu_mem();
+    cm.large_spans.max_pages = bytes / page_size;
+    cm.flush_span_cache(cm.max_cached_span_pages());
+}
+
+size_t large_span_cache_size() {
+    return get_cpu_mem().max_cached_span_pages() * page_size;
+}
+
+std::vector<size_class_tuning> profile_size_classes() {
+    std::vector<size_class_tuning> ret;
+    auto& cm = get_cpu_mem();
+    for (unsigned i = 0; i < cm.small_pools.nr_small_pools; i++) {
+        auto& sp = cm.small_pools[i];
+        if (sp.object_size() < sizeof(free_object)) {
+            continue;
+        }
+        auto live = sp.live_objects();
+        if (!live) {
+            continue;
+        }
+        // Keep enough free objects around to absorb a burst of 1/8 of the
+        // live population without going back to the page allocator.
+        auto max_free = std::min<size_t>(std::max<size_t>(sp.max_free(), live / 8), std::numeric_limits<uint16_t>::max());
+        ret.push_back(size_class_tuning{sp.object_size(), unsigned(max_free)});
+    }
+    return ret;
+}
+
+void tune_size_classes(const std::vector<size_class_tuning>& tuning) {
+    auto& cm = get_cpu_mem();
+    for (auto& t : tuning) {
+        if (t.object_size < sizeof(free_object) || t.object_size > max_small_allocation) {
+            continue;
+        }
+        auto idx = small_pool::size_to_idx(t.object_size);
+        cm.small_pools[idx].set_max_free(t.max_free);
+        cm.sampled_small_pools[idx].set_max_free(t.max_free);
+    }
+}
+
 void configure_minimal() {
     init_cpu_mem();
 }
@@ -1957,7 +2200,7 @@ statistics stats() {
     return statistics{alloc_stats::get(alloc_stats::types::allocs), alloc_stats::get(alloc_stats::types::frees), alloc_stats::get(alloc_stats::types::cross_cpu_frees),
         cpu_mem.nr_pages * page_size, cpu_mem.nr_free_pages * page_size, alloc_stats::get(alloc_stats::types::reclaims), alloc_stats::get(alloc_stats::types::large_allocs),
         alloc_stats::get(alloc_stats::types::failed_allocs), alloc_stats::get(alloc_stats::types::foreign_mallocs), alloc_stats::get(alloc_stats::types::foreign_frees),
-        alloc_stats::get(alloc_stats::types::foreign_cross_frees)};
+        alloc_stats::get(alloc_stats::types::foreign_cross_frees), alloc_stats::get(alloc_stats::types::cross_cpu_free_batches)};
 }
 
 size_t free_memory() {
@@ -2158,6 +2401,12 @@ seastar::internal::log_buf::inserter_iterator do_dump_memory_diagnostics(seastar
                 to_hr_number(total_spans));
     }
 
+    auto& large_spans = get_cpu_mem().large_spans;
+    it = fmt::format_to(it, "\nCached large spans: {} (limit {}, {} hits)\n",
+            to_hr_size(uint64_t(large_spans.cached_pages) * page_size),
+            to_hr_size(get_cpu_mem().max_cached_span_pages() * page_size),
+            to_hr_number(large_spans.hits));
+
     return it;
 }
 
@@ -2255,6 +2504,10 @@ size_t sampled_memory_profile(allocation_site* output, size_t size) {
     return to_copy;
 }
 
+scheduling_group_heap_stats sampled_heap_stats(scheduling_group sg) {
+    return get_cpu_mem().sg_heap_stats[seastar::internal::scheduling_group_index(sg)];
+}
+
 }
 
 }
@@ -2664,6 +2917,10 @@ size_t sampled_memory_profile(allocation_site* output, size_t size) {
     return 0;
 }
 
+scheduling_group_heap_stats sampled_heap_stats(scheduling_group) {
+    return {};
+}
+
 scoped_heap_profiling::scoped_heap_profiling(size_t sample_rate) noexcept {
     set_heap_profiling_sampling_rate(sample_rate); // let it print the warning
 }
@@ -2704,7 +2961,7 @@ void configure_minimal()
 {}
 
 statistics stats() {
-    return statistics{0, 0, 0, 1 << 30, 1 << 30, 0, 0, 0, 0, 0, 0};
+    return statistics{0, 0, 0, 1 << 30, 1 << 30, 0, 0, 0, 0, 0, 0, 0};
 }
 
 size_t free_memory() {
@@ -2740,6 +2997,22 @@ void disable_large_allocation_warning() {
     // Ignore, not supported for default allocator.
 }
 
+void set_large_span_cache_size(size_t) {
+    // Ignore, not supported for default allocator.
+}
+
+size_t large_span_cache_size() {
+    return 0;
+}
+
+std::vector<size_class_tuning> profile_size_classes() {
+    return {};
+}
+
+void tune_size_classes(const std::vector<size_class_tuning>&) {
+    // Ignore, not supported for default allocator.
+}
+
 
 void set_dump_memory_diagnostics_on_alloc_failure_kind(alloc_failure_kind) {
     // Ignore, not supported for default allocator.
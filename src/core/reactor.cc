@@ -463,13 +463,45 @@ future<size_t> pollable_fd_state::recvmsg(struct msghdr *msg) {
         // all messages without resorting to epoll. However this adds extra
         // recvmsg() call when we hit the empty queue condition, so it may
         // hurt request-response workload in which the queue is empty when we
-        // initially enter recvmsg(). If that turns out to be a problem, we can
-        // improve speculation by using recvmmsg().
+        // initially enter recvmsg(). Callers that care should use recvmmsg(),
+        // which speculates more precisely.
         speculate_epoll(EPOLLIN);
         return make_ready_future<size_t>(*r);
     });
 }
 
+future<size_t> pollable_fd_state::recvmmsg(struct mmsghdr* msgs, size_t n) {
+    maybe_no_more_recv();
+    return engine().readable(*this).then([this, msgs, n] {
+        auto r = fd.recvmmsg(msgs, n, 0);
+        if (!r) {
+            return recvmmsg(msgs, n);
+        }
+        // On a non-blocking socket recvmmsg() stops at the first empty queue
+        // condition, so a short batch tells us the queue was drained and we
+        // only speculate when the whole batch was filled.
+        if (*r == n) {
+            speculate_epoll(EPOLLIN);
+        }
+        return make_ready_future<size_t>(*r);
+    });
+}
+
+future<size_t> pollable_fd_state::sendmmsg(struct mmsghdr* msgs, size_t n) {
+    maybe_no_more_send();
+    return engine().writeable(*this).then([this, msgs, n] () mutable {
+        auto r = fd.sendmmsg(msgs, n, 0);
+        if (!r) {
+            return sendmmsg(msgs, n);
+        }
+        // See the comment about speculation in sendmsg().
+        if (*r == n) {
+            speculate_epoll(EPOLLOUT);
+        }
+        return make_ready_future<size_t>(*r);
+    });
+}
+
 future<size_t> pollable_fd_state::sendmsg(struct msghdr* msg) {
     maybe_no_more_send();
     return engine().writeable(*this).then([this, msg] () mutable {
@@ -979,6 +1011,23 @@ reactor::task_queue::register_stats() {
 
     register_net_metrics_for_scheduling_group(new_metrics, _id, group_label);
 
+#ifdef SEASTAR_HEAPPROF
+    new_metrics.add_group("memory", {
+        sm::make_gauge("sampled_live_bytes", [this] {
+            return memory::sampled_heap_stats(internal::scheduling_group_from_index(_id)).live_bytes;
+        }, sm::description("Bytes in live allocations made in this group, extrapolated from heap profiling samples"),
+            {group_label}),
+        sm::make_counter("sampled_allocated_bytes", [this] {
+            return memory::sampled_heap_stats(internal::scheduling_group_from_index(_id)).allocated_bytes;
+        }, sm::description("Bytes allocated in this group, extrapolated from heap profiling samples; the increment rate is the group's allocation rate"),
+            {group_label}),
+        sm::make_counter("sampled_allocations", [this] {
+            return memory::sampled_heap_stats(internal::scheduling_group_from_index(_id)).sampled_allocations;
+        }, sm::description("Number of allocations made in this group that were sampled by the heap profiler"),
+            {group_label}),
+    });
+#endif
+
     _metrics = std::exchange(new_metrics, {});
 }
 
@@ -2385,6 +2434,16 @@ reactor::fdatasync(int fd) noexcept {
     });
 }
 
+void
+reactor::register_file(int fd) noexcept {
+    _backend->register_file(fd);
+}
+
+void
+reactor::unregister_file(int fd) noexcept {
+    _backend->unregister_file(fd);
+}
+
 // Note: terminate if arm_highres_timer throws
 // `when` should always be valid
 void reactor::enable_timer(steady_clock_type::time_point when) noexcept
@@ -2548,12 +2607,17 @@ void reactor::register_metrics() {
             // total_operations value:DERIVE:0:U
             sm::make_counter("fsyncs", _fsyncs, sm::description("Total number of fsync operations")),
             sm::make_counter("aio_retries", _io_stats.aio_retries, sm::description("Total number of IOCB-s re-submitted via thread-pool")),
+            sm::make_counter("io_submit_syscalls", _io_stats.submit_syscalls, sm::description("Total number of system calls made to submit I/O to the kernel")),
+            sm::make_counter("io_submitted_requests", _io_stats.submitted_requests, sm::description("Total number of I/O requests submitted to the kernel")),
+            sm::make_counter("io_uring_sqpoll_wakeups", _io_stats.sqpoll_wakeups, sm::description("Total number of times the io_uring polling thread had to be woken up")),
             // total_operations value:DERIVE:0:U
             io_fallback_counter("aio_fallback", internal::thread_pool_submit_reason::aio_fallback),
             // total_operations value:DERIVE:0:U
             io_fallback_counter("file_operation", internal::thread_pool_submit_reason::file_operation),
             // total_operations value:DERIVE:0:U
             io_fallback_counter("process_operation", internal::thread_pool_submit_reason::process_operation),
+            // total_operations value:DERIVE:0:U
+            io_fallback_counter("tls_handshake", internal::thread_pool_submit_reason::tls_handshake),
     });
 
     _metric_groups.add_group("memory", {
@@ -2561,6 +2625,7 @@ void reactor::register_metrics() {
                     sm::description("Total number of malloc operations")),
             sm::make_counter("free_operations", [] { return memory::stats().frees(); }, sm::description("Total number of free operations")),
             sm::make_counter("cross_cpu_free_operations", [] { return memory::stats().cross_cpu_frees(); }, sm::description("Total number of cross cpu free")),
+            sm::make_counter("cross_cpu_free_batches", [] { return memory::stats().cross_cpu_free_batches(); }, sm::description("Total number of batches of cross cpu frees handed back to their owning cpus")),
             sm::make_gauge("malloc_live_objects", [] { return memory::stats().live_objects(); }, sm::description("Number of live objects")),
             sm::make_current_bytes("free_memory", [] { return memory::stats().free_memory(); }, sm::description("Free memory size in bytes")),
             sm::make_current_bytes("total_memory", [] { return memory::stats().total_memory(); }, sm::description("Total memory size in bytes")),
@@ -2834,6 +2899,9 @@ class reactor::io_queue_submission_pollfn final : public reactor::pollfn {
 // doesn't have any side effects.
 //
 // We'll take care of those items when we wake up for another reason.
+//
+// Polling also hands back the objects we freed on behalf of other cpus,
+// which are batched per owner until then.
 class reactor::drain_cross_cpu_freelist_pollfn final : public simple_pollfn<true> {
 public:
     virtual bool poll() final override {
@@ -3565,9 +3633,10 @@ unsigned syscall_work_queue::complete() {
 }
 
 
-smp_message_queue::smp_message_queue(reactor* from, reactor* to)
-    : _pending(to)
-    , _completed(from)
+smp_message_queue::smp_message_queue(reactor* from, reactor* to, const config& cfg)
+    : _pending(to, cfg.queue_length)
+    , _completed(from, cfg.queue_length)
+    , _max_batch_delay(cfg.max_batch_delay)
 {
 }
 
@@ -3582,6 +3651,13 @@ void smp_message_queue::stop() {
     _metrics.clear();
 }
 
+bool smp_message_queue::should_flush(const lf_queue& q, size_t batched, clock_type::time_point oldest, clock_type::time_point now) const noexcept {
+    // Batching only pays off while the remote shard is busy consuming a
+    // previous batch. If it has already drained the queue it is waiting
+    // for us, so send right away rather than add latency.
+    return batched >= batch_size || now - oldest >= _max_batch_delay || q.drained();
+}
+
 void smp_message_queue::move_pending() {
     auto begin = _tx.a.pending_fifo.cbegin();
     auto end = _tx.a.pending_fifo.cend();
@@ -3615,19 +3691,28 @@ void smp_message_queue::submit_item(shard_id t, smp_timeout_clock::time_point ti
         ++_last_cmpl_batch;
         return;
     }
+    auto now = clock_type::now();
+    item->queued_at = now;
+    if (_tx.a.pending_fifo.empty()) {
+        _tx.a.oldest_pending = now;
+    }
     _tx.a.pending_fifo.push_back(item.get());
     // no exceptions from this point
     item.release();
     units_fut.get().release();
-    if (_tx.a.pending_fifo.size() >= batch_size) {
+    if (should_flush(_pending, _tx.a.pending_fifo.size(), _tx.a.oldest_pending, now)) {
         move_pending();
     }
   });
 }
 
 void smp_message_queue::respond(work_item* item) {
+    auto now = clock_type::now();
+    if (_completed_fifo.empty()) {
+        _oldest_completed = now;
+    }
     _completed_fifo.push_back(item);
-    if (_completed_fifo.size() >= batch_size || engine().stopped()) {
+    if (should_flush(_completed, _completed_fifo.size(), _oldest_completed, now) || engine().stopped()) {
         flush_response_batch();
     }
 }
@@ -3679,14 +3764,14 @@ template<size_t PrefetchCnt, typename Func>
 size_t smp_message_queue::process_queue(lf_queue& q, Func process) {
     // copy batch to local memory in order to minimize
     // time in which cross-cpu data is accessed
-    work_item* items[queue_length + PrefetchCnt];
+    work_item* items[process_batch_size + PrefetchCnt];
     work_item* wi;
     if (!q.pop(wi))
         return 0;
     // start prefetching first item before popping the rest to overlap memory
     // access with potential cache miss the second pop may cause
     prefetch<2>(wi);
-    auto nr = q.pop(items);
+    auto nr = q.pop(items, process_batch_size - 1);
     std::fill(std::begin(items) + nr, std::begin(items) + nr + PrefetchCnt, nr ? items[nr - 1] : wi);
     unsigned i = 0;
     do {
@@ -3699,7 +3784,9 @@ size_t smp_message_queue::process_queue(lf_queue& q, Func process) {
 }
 
 size_t smp_message_queue::process_completions(shard_id t) {
-    auto nr = process_queue<prefetch_cnt*2>(_completed, [t] (work_item* wi) {
+    auto now = clock_type::now();
+    auto nr = process_queue<prefetch_cnt*2>(_completed, [this, t, now] (work_item* wi) {
+        _latency.add(std::chrono::duration_cast<std::chrono::nanoseconds>(now - wi->queued_at).count());
         wi->complete();
         auto ssg_id = internal::smp_service_group_id(wi->ssg);
         get_smp_service_groups_semaphore(ssg_id, t).signal();
@@ -3744,10 +3831,149 @@ void smp_message_queue::start(unsigned cpuid) {
             // total_operations value:DERIVE:0:U
             sm::make_counter("total_sent_messages", _sent, sm::description("Total number of sent messages"), {sm::shard_label(instance)})(sm::metric_disabled),
             // total_operations value:DERIVE:0:U
-            sm::make_counter("total_completed_messages", _compl, sm::description("Total number of messages completed"), {sm::shard_label(instance)})(sm::metric_disabled)
+            sm::make_counter("total_completed_messages", _compl, sm::description("Total number of messages completed"), {sm::shard_label(instance)})(sm::metric_disabled),
+            sm::make_histogram("round_trip_latency", sm::description("Latency histogram, in nanoseconds, of messages from being queued until their completion is processed"), {sm::shard_label(instance)},
+                    [this] { return _latency.to_metrics_histogram(); })(sm::metric_disabled).set_skip_when_empty(),
+    });
+}
+
+stealable_work_queue::~stealable_work_queue() {
+    _pending.consume_all([] (work_item* wi) {
+        delete wi;
+    });
+    auto wi = _completed.exchange(nullptr, std::memory_order_acquire);
+    while (wi) {
+        delete std::exchange(wi, wi->next_completed);
+    }
+}
+
+void stealable_work_queue::enqueue(work_item* wi) noexcept {
+    ++_submitted;
+    if (!_siblings.empty() && _pending.bounded_push(wi)) {
+        auto nr = _nr_pending.fetch_add(1, std::memory_order_relaxed);
+        if (nr <= 0) {
+            _pending_since = std::chrono::steady_clock::now();
+        }
+        // One sibling per batch it can steal, the sleeping ones don't poll
+        if (nr <= 0 || (nr + 1) % steal_batch_size == 0) {
+            wakeup_sibling();
+        }
+        return;
+    }
+    // Nobody can steal it, or the queue is full: run it here.
+    schedule(wi);
+}
+
+void stealable_work_queue::wakeup_sibling() noexcept {
+    auto sibling = _siblings[_next_sibling++ % _siblings.size()];
+    // See smp_message_queue::lf_queue::maybe_wakeup()
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    if (auto r = smp::_stealable_qs[sibling]._owner.load(std::memory_order_acquire)) {
+        r->wakeup();
+    }
+}
+
+size_t stealable_work_queue::process_pending(bool busy) {
+    if (_nr_pending.load(std::memory_order_relaxed) <= 0) {
+        return 0;
+    }
+    // While busy, leave the items to the siblings for a while
+    if (busy && std::chrono::steady_clock::now() - _pending_since < steal_window) {
+        return 0;
+    }
+    size_t nr = 0;
+    work_item* wi;
+    while (nr < batch_size && _pending.pop(wi)) {
+        schedule(wi);
+        ++nr;
+    }
+    if (nr) {
+        _nr_pending.fetch_sub(nr, std::memory_order_relaxed);
+    }
+    return nr;
+}
+
+size_t stealable_work_queue::steal_into(stealable_work_queue& thief) noexcept {
+    size_t nr = 0;
+    work_item* wi;
+    while (nr < steal_batch_size && _pending.pop(wi)) {
+        // Runs in the thief's reactor, in the item's scheduling group.
+        schedule(wi);
+        ++nr;
+    }
+    if (nr) {
+        _nr_pending.fetch_sub(nr, std::memory_order_relaxed);
+        thief._executed_for_others += nr;
+    }
+    return nr;
+}
+
+void stealable_work_queue::work_item::respond() noexcept {
+    if (origin == this_shard_id()) {
+        complete();
+        delete this;
+        return;
+    }
+    smp::_stealable_qs[origin].push_completed(this);
+}
+
+void stealable_work_queue::push_completed(work_item* wi) noexcept {
+    auto head = _completed.load(std::memory_order_relaxed);
+    do {
+        wi->next_completed = head;
+    } while (!_completed.compare_exchange_weak(head, wi, std::memory_order_release, std::memory_order_relaxed));
+    // See smp_message_queue::lf_queue::maybe_wakeup()
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    if (auto r = _owner.load(std::memory_order_acquire)) {
+        r->wakeup();
+    }
+}
+
+size_t stealable_work_queue::process_completions() {
+    if (!_completed.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+    auto wi = _completed.exchange(nullptr, std::memory_order_acquire);
+    size_t nr = 0;
+    while (wi) {
+        auto next = wi->next_completed;
+        wi->complete();
+        delete wi;
+        wi = next;
+        ++nr;
+    }
+    _stolen += nr;
+    return nr;
+}
+
+bool stealable_work_queue::pure_poll() const noexcept {
+    // empty() is not const, so need const_cast.
+    return _completed.load(std::memory_order_relaxed) || !const_cast<lf_queue&>(_pending).empty();
+}
+
+void stealable_work_queue::start() {
+    auto me = this_shard_id();
+    for (unsigned d = 1; d <= sibling_distance && d < smp::count; d++) {
+        for (auto sibling : {(me + d) % smp::count, (me + smp::count - d) % smp::count}) {
+            if (std::ranges::find(_siblings, sibling) == _siblings.end()) {
+                _siblings.push_back(sibling);
+            }
+        }
+    }
+    _owner.store(&engine(), std::memory_order_release);
+    namespace sm = seastar::metrics;
+    _metrics.add_group("smp", {
+            sm::make_counter("stealable_tasks_submitted", _submitted, sm::description("Total number of tasks submitted with smp::submit_anywhere() on this shard")),
+            sm::make_counter("stealable_tasks_stolen", _stolen, sm::description("Total number of tasks submitted on this shard and run by other shards")),
+            sm::make_counter("stealable_tasks_executed_for_others", _executed_for_others, sm::description("Total number of tasks stolen from other shards and run on this shard")),
     });
 }
 
+void stealable_work_queue::stop() {
+    _owner.store(nullptr, std::memory_order_release);
+    _metrics.clear();
+}
+
 readable_eventfd writeable_eventfd::read_side() {
     return readable_eventfd(_fd.dup());
 }
@@ -3878,6 +4104,10 @@ reactor_options::reactor_options(program_options::option_group* parent_group)
     , task_quota_ms(*this, "task-quota-ms", 0.5, "Max time (ms) between polls")
     , io_latency_goal_ms(*this, "io-latency-goal-ms", {}, "Max time (ms) io operations must take (1.5 * task-quota-ms if not set)")
     , io_flow_ratio_threshold(*this, "io-flow-rate-threshold", 1.1, "Dispatch rate to completion rate threshold")
+    , io_adaptive_cost_model(*this, "io-adaptive-cost-model", false, "adapt the IO cost model from io-properties to observed request latencies")
+    , io_calendar_class_selection(*this, "io-calendar-class-selection", false, "select the next IO class to dispatch from in constant time, useful with many scheduling groups")
+    , io_capacity_lending(*this, "io-capacity-lending", false, "let shards with IO backlog use the disk capacity left unused by idle shards of the same IO group")
+    , io_merge_reads(*this, "io-merge-reads", false, "merge reads queued back-to-back on adjacent file ranges into one vectored read")
     , io_completion_notify_ms(*this, "io-completion-notify-ms", {}, "Threshold in milliseconds over which IO request completion is reported to logs")
     , max_task_backlog(*this, "max-task-backlog", 1000, "Maximum number of task backlog to allow; above this we ignore I/O")
     , blocked_reactor_notify_ms(*this, "blocked-reactor-notify-ms", 25, "threshold in miliseconds over which the reactor is considered blocked if no progress is made")
@@ -3902,6 +4132,21 @@ reactor_options::reactor_options(program_options::option_group* parent_group)
                  " Note that if the seastar_memory logger is set to debug or trace level, the diagnostics will be logged irrespective of this setting.")
     , reactor_backend(*this, "reactor-backend", backend_selector_candidates(), reactor_backend_selector::default_backend().name(),
                 fmt::format("Internal reactor implementation ({})", reactor_backend_selector::available()))
+    , io_uring_fixed_io(*this, "io-uring-fixed-io", false,
+                "Register shard memory and open files with io_uring and submit disk I/O against them (pins all shard memory)."
+                " Only valid for the io_uring reactor backend (see --reactor-backend).")
+    , io_uring_sqpoll(*this, "io-uring-sqpoll", false,
+                "Use a kernel thread shared by the shards, pinned to a CPU no shard runs on when possible, to poll the io_uring submission queue."
+                " Requires Linux 5.11 or CAP_SYS_ADMIN. Only valid for the io_uring reactor backend (see --reactor-backend).")
+    , io_uring_submit_batch(*this, "io-uring-submit-batch", 0,
+                "While there are tasks to run, hold back io_uring submissions smaller than this, for at most a task quota (0: submit on every poll)."
+                " Only valid for the io_uring reactor backend (see --reactor-backend).")
+    , io_uring_multishot_net(*this, "io-uring-multishot-net", false,
+                "Use multishot accept, and multishot receive into kernel-provided buffers (16MB per shard), for posix-stack sockets."
+                " Requires Linux 6.0. Only valid for the io_uring reactor backend (see --reactor-backend).")
+    , io_uring_zerocopy_send_threshold(*this, "io-uring-zerocopy-send-threshold", 0,
+                "Send socket data of at least this many bytes without copying it (0: disabled). Requires Linux 6.1."
+                " Only valid for the io_uring reactor backend (see --reactor-backend).")
     , aio_fsync(*this, "aio-fsync", kernel_supports_aio_fsync(),
                 "Use Linux aio for fsync() calls. This reduces latency; requires Linux 4.18 or later.")
     , max_networking_io_control_blocks(*this, "max-networking-io-control-blocks", 10000,
@@ -3946,6 +4191,8 @@ smp_options::smp_options(program_options::option_group* parent_group)
 #else
     , allow_cpus_in_remote_numa_nodes(*this, "allow-cpus-in-remote-numa-nodes", program_options::unused{})
 #endif
+    , smp_queue_length(*this, "smp-queue-length", 128, "capacity of each cross-shard message queue (rounded up to a power of two)")
+    , smp_max_batch_delay(*this, "smp-max-batch-delay", 50, "maximum time, in microseconds, to hold back a cross-shard message to batch it with others while the remote shard is busy")
 {
 }
 
@@ -3959,6 +4206,7 @@ struct reactor_deleter {
 thread_local std::unique_ptr<reactor, reactor_deleter> reactor_holder;
 
 thread_local smp_message_queue** smp::_qs;
+thread_local stealable_work_queue* smp::_stealable_qs;
 thread_local std::thread::id smp::_tmain;
 unsigned smp::count = 0;
 
@@ -3970,6 +4218,7 @@ void smp::start_all_queues()
         }
     }
     _alien._qs[this_shard_id()].start();
+    _stealable_qs[this_shard_id()].start();
 }
 
 #ifdef SEASTAR_HAVE_DPDK
@@ -4041,6 +4290,9 @@ void smp::cleanup_cpu() {
     if (_alien._qs) {
         _alien._qs[cpuid].stop();
     }
+    if (_stealable_qs) {
+        _stealable_qs[cpuid].stop();
+    }
 }
 
 void smp::create_thread(std::function<void ()> thread_loop) {
@@ -4429,6 +4681,22 @@ void smp::configure(const smp_options& smp_opts, const reactor_options& reactor_
         .bypass_fsync = reactor_opts.unsafe_bypass_fsync.get_value(),
         .no_poll_aio = !reactor_opts.poll_aio.get_value() || (reactor_opts.poll_aio.defaulted() && reactor_opts.overprovisioned),
         .aio_nowait_works = reactor_opts.linux_aio_nowait.get_value(), // Mixed in with filesystem-provided values later
+        .uring_fixed_io = reactor_opts.io_uring_fixed_io.get_value(),
+        .uring_sqpoll = reactor_opts.io_uring_sqpoll.get_value(),
+        .uring_sqpoll_cpus = [&] {
+            std::vector<unsigned> cpus;
+            if (thread_affinity) {
+                std::set<unsigned> reactor_cpus;
+                for (auto& a : allocations) {
+                    reactor_cpus.insert(a.cpu_id);
+                }
+                std::ranges::set_difference(rc.cpu_set, reactor_cpus, std::back_inserter(cpus));
+            }
+            return cpus;
+        }(),
+        .uring_submit_batch = reactor_opts.io_uring_submit_batch.get_value(),
+        .uring_multishot_net = reactor_opts.io_uring_multishot_net.get_value(),
+        .uring_zerocopy_send_threshold = reactor_opts.io_uring_zerocopy_send_threshold.get_value(),
     };
 
     // Disable hot polling if sched wakeup granularity is too high
@@ -4532,6 +4800,7 @@ void smp::configure(const smp_options& smp_opts, const reactor_options& reactor_
     seastar_logger.info("Reactor backend: {}", backend_selector);
 
     _qs_owner = decltype(smp::_qs_owner){new smp_message_queue* [smp::count], qs_deleter{}};
+    _stealable_qs_owner = std::make_unique<stealable_work_queue[]>(smp::count);
 
     auto allocate_qs_owner = [this] (unsigned i) {
         // smp_message_queue has members with hefty alignment requirements.
@@ -4544,9 +4813,12 @@ void smp::configure(const smp_options& smp_opts, const reactor_options& reactor_
         ));
     };
 
-    auto allocate_smp_queues = [this, &reactors] (unsigned i) {
+    smp_message_queue::config smp_queue_cfg;
+    smp_queue_cfg.queue_length = smp_opts.smp_queue_length.get_value();
+    smp_queue_cfg.max_batch_delay = std::chrono::microseconds(smp_opts.smp_max_batch_delay.get_value());
+    auto allocate_smp_queues = [this, &reactors, smp_queue_cfg] (unsigned i) {
         for (unsigned j = 0; j < smp::count; ++j) {
-            new (&smp::_qs_owner[i][j]) smp_message_queue(reactors[j], reactors[i]);
+            new (&smp::_qs_owner[i][j]) smp_message_queue(reactors[j], reactors[i], smp_queue_cfg);
         }
     };
 
@@ -4588,6 +4860,7 @@ void smp::configure(const smp_options& smp_opts, const reactor_options& reactor_
             alloc_io_queues(i);
             allocate_qs_owner(i);
             _qs = _qs_owner.get();
+            _stealable_qs = _stealable_qs_owner.get();
             reactors_registered.arrive_and_wait();
             allocate_smp_queues(i);
             smp_queues_constructed.arrive_and_wait();
@@ -4627,6 +4900,7 @@ void smp::configure(const smp_options& smp_opts, const reactor_options& reactor_
     allocate_qs_owner(0);
     reactors_registered.arrive_and_wait();
     _qs = _qs_owner.get();
+    _stealable_qs = _stealable_qs_owner.get();
     allocate_smp_queues(0);
     _alien._qs = alien::instance::create_qs(reactors);
     smp_queues_constructed.arrive_and_wait();
@@ -4654,9 +4928,32 @@ bool smp::poll_queues() {
             got += txq.process_completions(i);
         }
     }
+    auto& stq = _stealable_qs[this_shard_id()];
+    got += stq.process_completions();
+    got += stq.process_pending(engine().have_more_tasks());
+    got += steal_work();
     return got != 0;
 }
 
+size_t smp::steal_work() noexcept {
+    // Only steal when there is nothing else to do here; this is what runs
+    // just before the reactor would go to sleep.
+    if (engine().have_more_tasks()) {
+        return 0;
+    }
+    auto& me = _stealable_qs[this_shard_id()];
+    // Siblings are symmetric, the shards this one may steal from are its own siblings
+    for (auto victim : me._siblings) {
+        auto& q = _stealable_qs[victim];
+        if (q._nr_pending.load(std::memory_order_relaxed) > 0) {
+            if (auto nr = q.steal_into(me)) {
+                return nr;
+            }
+        }
+    }
+    return 0;
+}
+
 bool smp::pure_poll_queues() {
     for (unsigned i = 0; i < count; i++) {
         if (this_shard_id() != i) {
@@ -4669,6 +4966,16 @@ bool smp::pure_poll_queues() {
             }
         }
     }
+    auto& stq = _stealable_qs[this_shard_id()];
+    if (stq.pure_poll()) {
+        return true;
+    }
+    // Stay awake while a sibling has work to steal
+    for (auto victim : stq._siblings) {
+        if (_stealable_qs[victim]._nr_pending.load(std::memory_order_relaxed) > 0) {
+            return true;
+        }
+    }
     return false;
 }
 
@@ -22,9 +22,11 @@
 module;
 #endif
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <filesystem>
+#include <mutex>
 #include <thread>
 #include <utility>
 #include <fcntl.h>
@@ -48,10 +50,13 @@ module seastar;
 #include "core/thread_pool.hh"
 #include "core/syscall_result.hh"
 #include <seastar/core/internal/buffer_allocator.hh>
+#include <seastar/core/aligned_buffer.hh>
 #include <seastar/util/internal/iovec_utils.hh>
 #include <seastar/core/internal/uname.hh>
+#include <seastar/core/memory.hh>
 #include <seastar/core/print.hh>
 #include <seastar/core/reactor.hh>
+#include <seastar/core/resource.hh>
 #include <seastar/core/smp.hh>
 #include <seastar/util/defer.hh>
 #include <seastar/util/read_first_line.hh>
@@ -235,10 +240,12 @@ aio_storage_context::submit_work() {
     for (auto iocbs = _submission_queue.data(), end = iocbs + to_submit; iocbs < end; iocbs += nr_consumed) {
         auto nr = end - iocbs;
         auto r = io_submit(_io_context, nr, iocbs);
+        _r._io_stats.submit_syscalls++;
         if (r == -1) {
             nr_consumed = handle_aio_error(iocbs[0], errno);
         } else {
             nr_consumed = size_t(r);
+            _r._io_stats.submitted_requests += nr_consumed;
         }
         did_work = true;
     }
@@ -1095,10 +1102,14 @@ void reactor_backend_epoll::reset_preemption_monitor() {
 
 static
 std::optional<::io_uring>
-try_create_uring(unsigned queue_len, bool throw_on_error) {
+try_create_uring(unsigned queue_len, bool throw_on_error, ::io_uring_params params = {}) {
     auto required_features =
             IORING_FEAT_SUBMIT_STABLE
             | IORING_FEAT_NODROP;
+    if (params.flags & IORING_SETUP_SQPOLL) {
+        // Before 5.11 the polling thread only accepts registered files
+        required_features |= IORING_FEAT_SQPOLL_NONFIXED;
+    }
     auto required_ops = {
             IORING_OP_POLL_ADD, // linux 5.1
             IORING_OP_READV,
@@ -1119,7 +1130,6 @@ try_create_uring(unsigned queue_len, bool throw_on_error) {
         }
     };
 
-    auto params = ::io_uring_params{};
     ::io_uring ring;
     auto err = ::io_uring_queue_init_params(queue_len, &ring, &params);
     if (err != 0) {
@@ -1151,6 +1161,17 @@ try_create_uring(unsigned queue_len, bool throw_on_error) {
     return ring;
 }
 
+static
+bool
+uring_opcode_supported(::io_uring& ring, int op) {
+    auto probe = ::io_uring_get_probe_ring(&ring);
+    if (!probe) {
+        return false;
+    }
+    auto free_probe = defer([&] () noexcept { ::io_uring_free_probe(probe); });
+    return ::io_uring_opcode_supported(probe, op);
+}
+
 static
 bool
 have_md_devices() {
@@ -1191,23 +1212,69 @@ detect_io_uring() {
     return bool(ring_opt);
 }
 
+// Picks a CPU out of \c free_cpus, which no shard is pinned to, for the
+// SQPOLL kernel thread to run on. A hyperthread sibling of the CPU the
+// calling thread is pinned to is preferred.
+static
+std::optional<unsigned>
+sqpoll_cpu(const std::vector<unsigned>& free_cpus) {
+    if (free_cpus.empty()) {
+        return std::nullopt;
+    }
+    cpu_set_t cs;
+    CPU_ZERO(&cs);
+    if (::sched_getaffinity(0, sizeof(cs), &cs) == 0 && CPU_COUNT(&cs) == 1) {
+        unsigned cpu = 0;
+        while (!CPU_ISSET(cpu, &cs)) {
+            cpu++;
+        }
+        try {
+            auto siblings = resource::parse_cpuset(read_first_line(fmt::format("/sys/devices/system/cpu/cpu{}/topology/thread_siblings_list", cpu)));
+            if (siblings) {
+                for (auto sibling : *siblings) {
+                    if (std::ranges::find(free_cpus, sibling) != free_cpus.end()) {
+                        return sibling;
+                    }
+                }
+            }
+        } catch (...) {
+            // No topology information, any free CPU will do
+        }
+    }
+    return free_cpus.front();
+}
+
+// The ring whose SQPOLL thread the rings of the other shards attach to
+static std::mutex sqpoll_owner_mutex;
+static int sqpoll_owner_ring_fd = -1;
+
 class reactor_backend_uring final : public reactor_backend {
     // s_queue_len is more or less arbitrary. Too low and we'll be
     // issuing too small batches, too high and we require too much locked
     // memory, but otherwise it doesn't matter.
     static constexpr unsigned s_queue_len = 200;
     reactor& _r;
+    bool _sqpoll = false;
     ::io_uring _uring;
     bool _did_work_while_getting_sqe = false;
     bool _has_pending_submissions = false;
+    // When the oldest entry still sitting in the submission queue was queued
+    sched_clock::time_point _oldest_unsubmitted;
     file_desc _hrtimer_timerfd;
     preempt_io_context _preempt_io_context;
 
+    class multishot_recv;
+    class multishot_accept;
+
     class uring_pollable_fd_state : public pollable_fd_state {
         pollable_fd_state_completion _completion_pollin;
         pollable_fd_state_completion _completion_pollout;
         pollable_fd_state_completion _completion_pollrdhup;
     public:
+        // Created on first use with --io-uring-multishot-net
+        multishot_recv* _recv = nullptr;
+        multishot_accept* _accept = nullptr;
+
         explicit uring_pollable_fd_state(file_desc desc, speculation speculate)
                 : pollable_fd_state(std::move(desc), std::move(speculate)) {
         }
@@ -1267,23 +1334,548 @@ class reactor_backend_uring final : public reactor_backend {
 
     using smp_wakeup_completion = recurring_eventfd_or_timerfd_completion;
 
+    // Buffers handed to the kernel for receives that pick their own buffer
+    // (IOSQE_BUFFER_SELECT). Received data is passed up the stack in place,
+    // and each buffer is given back to the kernel when its temporary_buffer
+    // is released. That can happen on another shard, or after the backend
+    // is gone, so the ring is reference counted and buffers released away
+    // from the owning thread are only flagged, to be recycled by the owner.
+    class provided_buffer_ring {
+    public:
+        static constexpr unsigned entries = 1024;
+        static constexpr size_t buffer_size = 16 * 1024;
+        static constexpr int group_id = 0;
+    private:
+        ::io_uring* _uring;
+        ::io_uring_buf_ring* _ring;
+        const std::thread::id _owner = std::this_thread::get_id();
+        std::unique_ptr<char[], free_deleter> _memory;
+        std::unique_ptr<std::atomic<bool>[]> _returned;
+        std::atomic<unsigned> _nr_returned = 0;
+
+        char* buffer(unsigned bid) const noexcept {
+            return _memory.get() + bid * buffer_size;
+        }
+        void recycle(unsigned bid) noexcept {
+            ::io_uring_buf_ring_add(_ring, buffer(bid), buffer_size, bid, ::io_uring_buf_ring_mask(entries), 0);
+            ::io_uring_buf_ring_advance(_ring, 1);
+        }
+        void release(unsigned bid) noexcept {
+            if (std::this_thread::get_id() == _owner && _uring) {
+                recycle(bid);
+            } else {
+                _returned[bid].store(true, std::memory_order_relaxed);
+                _nr_returned.fetch_add(1, std::memory_order_release);
+            }
+        }
+    public:
+        provided_buffer_ring(::io_uring& uring, ::io_uring_buf_ring* ring)
+                : _uring(&uring)
+                , _ring(ring)
+                , _memory(static_cast<char*>(aligned_alloc(memory::page_size, entries * buffer_size)))
+                , _returned(new std::atomic<bool>[entries]) {
+            if (!_memory) {
+                throw std::bad_alloc();
+            }
+            for (unsigned bid = 0; bid < entries; bid++) {
+                _returned[bid].store(false, std::memory_order_relaxed);
+                ::io_uring_buf_ring_add(_ring, buffer(bid), buffer_size, bid, ::io_uring_buf_ring_mask(entries), bid);
+            }
+            ::io_uring_buf_ring_advance(_ring, entries);
+        }
+        // Wraps the buffer the kernel picked for a completion
+        static temporary_buffer<char> take(const std::shared_ptr<provided_buffer_ring>& self, unsigned cqe_flags, size_t len) {
+            unsigned bid = cqe_flags >> IORING_CQE_BUFFER_SHIFT;
+            return temporary_buffer<char>(self->buffer(bid), len, make_deleter([self, bid] () noexcept {
+                self->release(bid);
+            }));
+        }
+        // Recycles buffers released on other threads. Returns true if any were.
+        bool recycle_returned() noexcept {
+            if (_nr_returned.load(std::memory_order_relaxed) == 0) {
+                return false;
+            }
+            auto nr = _nr_returned.exchange(0, std::memory_order_acquire);
+            for (unsigned bid = 0; nr && bid < entries; bid++) {
+                if (_returned[bid].exchange(false, std::memory_order_relaxed)) {
+                    recycle(bid);
+                    nr--;
+                }
+            }
+            if (nr) {
+                // Flagged concurrently with the scan, pick them up next time
+                _nr_returned.fetch_add(nr, std::memory_order_relaxed);
+            }
+            return true;
+        }
+        // Called by the owning backend before the ring is torn down
+        void orphan() noexcept {
+            ::io_uring_free_buf_ring(_uring, _ring, entries, group_id);
+            _uring = nullptr;
+        }
+    };
+
+    // A request that keeps posting completions until it fails or is
+    // cancelled (multishot accept and receive). Its user_data has the low
+    // bit set, to tell it apart from a kernel_completion.
+    class multishot_request {
+    protected:
+        reactor_backend_uring& _be;
+        bool _armed = false;
+        bool _cancelling = false;
+        bool _detached = false;
+    public:
+        static constexpr uint64_t tag = 1;
+
+        explicit multishot_request(reactor_backend_uring& be) noexcept : _be(be) {}
+        virtual ~multishot_request() = default;
+        uint64_t user_data() const noexcept {
+            return reinterpret_cast<uintptr_t>(this) | tag;
+        }
+        void complete_with(int res, unsigned flags) {
+            if (!(flags & IORING_CQE_F_MORE)) {
+                _armed = false;
+                _cancelling = false;
+            }
+            if (_detached) {
+                discard(res, flags);
+                if (!_armed) {
+                    delete this;
+                }
+                return;
+            }
+            handle(res, flags);
+        }
+        // Stops posting new completions. Those already in flight are still
+        // delivered.
+        void cancel() {
+            if (_armed && !_cancelling) {
+                auto sqe = _be.get_sqe();
+                ::io_uring_prep_cancel64(sqe, user_data(), 0);
+                ::io_uring_sqe_set_data(sqe, nullptr);
+                _be._has_pending_submissions = true;
+                _cancelling = true;
+            }
+        }
+        // Called when the file descriptor is forgotten. The request frees
+        // itself once the kernel is done with it.
+        void detach() {
+            _detached = true;
+            cancel();
+            if (!_armed) {
+                delete this;
+            }
+        }
+    protected:
+        void arm(auto prep) {
+            auto sqe = _be.get_sqe();
+            prep(sqe);
+            sqe->user_data = user_data();
+            _be._has_pending_submissions = true;
+            _armed = true;
+        }
+        virtual void handle(int res, unsigned flags) = 0;
+        virtual void discard(int res, unsigned flags) noexcept = 0;
+    };
+
+    class multishot_recv final : public multishot_request {
+        // Stop receiving ahead of the consumer beyond this many buffers,
+        // so that a slow reader doesn't drain the shared buffer ring
+        static constexpr size_t max_queued = 8;
+        pollable_fd_state& _fd;
+        internal::buffer_allocator* _ba = nullptr;
+        circular_buffer<temporary_buffer<char>> _received;
+        std::optional<promise<temporary_buffer<char>>> _waiter;
+        std::exception_ptr _error;
+        bool _eof = false;
+        bool _out_of_buffers = false;
+
+        void arm() {
+            multishot_request::arm([this] (::io_uring_sqe* sqe) {
+                ::io_uring_prep_recv_multishot(sqe, _fd.fd.get(), nullptr, 0, 0);
+                sqe->flags |= IOSQE_BUFFER_SELECT;
+                sqe->buf_group = provided_buffer_ring::group_id;
+            });
+        }
+        void deliver() {
+            if (!_waiter) {
+                return;
+            }
+            if (!_received.empty()) {
+                _waiter->set_value(std::move(_received.front()));
+                _received.pop_front();
+            } else if (_error) {
+                _waiter->set_exception(_error);
+            } else if (_eof) {
+                _waiter->set_value(temporary_buffer<char>());
+            } else if (_armed) {
+                return;
+            } else if (_out_of_buffers) {
+                // All buffers are in use, receive into our own for now
+                _out_of_buffers = false;
+                _be.plain_recv_some(_fd, _ba).forward_to(std::move(*_waiter));
+            } else {
+                arm();
+                return;
+            }
+            _waiter.reset();
+        }
+    protected:
+        virtual void handle(int res, unsigned flags) override {
+            if (res > 0) {
+                _received.push_back(provided_buffer_ring::take(_be._recv_buffers, flags, res));
+                if (_received.size() >= max_queued) {
+                    cancel();
+                }
+            } else if (res == 0) {
+                _eof = true;
+            } else if (res == -ENOBUFS) {
+                _out_of_buffers = true;
+            } else if (res != -ECANCELED) {
+                _error = std::make_exception_ptr(std::system_error(-res, std::system_category()));
+            }
+            deliver();
+        }
+        virtual void discard(int res, unsigned flags) noexcept override {
+            if (res > 0) {
+                provided_buffer_ring::take(_be._recv_buffers, flags, res);
+            }
+        }
+    public:
+        multishot_recv(reactor_backend_uring& be, pollable_fd_state& fd) noexcept
+                : multishot_request(be), _fd(fd) {
+        }
+        future<temporary_buffer<char>> recv(internal::buffer_allocator* ba) {
+            _ba = ba;
+            _waiter.emplace();
+            auto fut = _waiter->get_future();
+            deliver();
+            return fut;
+        }
+    };
+
+    // Zero-copy send. The kernel posts the result first, and a notification
+    // once it no longer references the data, so the packet fragments are
+    // kept alive (through a shared packet) until then.
+    class zerocopy_send final : public multishot_request {
+        pollable_fd_state& _fd;
+        net::packet _data;
+        ::msghdr _mh = {};
+        promise<size_t> _result;
+    protected:
+        virtual void handle(int res, unsigned flags) override {
+            if (flags & IORING_CQE_F_NOTIF) {
+                // The data was released, nothing to do
+            } else if (res >= 0) {
+                if (size_t(res) == _data.len()) {
+                    _fd.speculate_epoll(EPOLLOUT);
+                }
+                _result.set_value(res);
+            } else {
+                _result.set_exception(std::make_exception_ptr(std::system_error(-res, std::system_category())));
+            }
+            if (!_armed) {
+                delete this;
+            }
+        }
+        virtual void discard(int res, unsigned flags) noexcept override {
+        }
+    public:
+        zerocopy_send(reactor_backend_uring& be, pollable_fd_state& fd, net::packet& p)
+                : multishot_request(be), _fd(fd), _data(p.share()) {
+            _mh.msg_iov = reinterpret_cast<iovec*>(_data.fragment_array());
+            _mh.msg_iovlen = std::min<size_t>(_data.nr_frags(), IOV_MAX);
+        }
+        future<size_t> send() {
+            auto fut = _result.get_future();
+            arm([this] (::io_uring_sqe* sqe) {
+                ::io_uring_prep_sendmsg_zc(sqe, _fd.fd.get(), &_mh, MSG_NOSIGNAL);
+            });
+            return fut;
+        }
+    };
+
+    class multishot_accept final : public multishot_request {
+        // Stop accepting ahead of the application beyond this many
+        // connections, leaving the rest in the listen backlog
+        static constexpr size_t max_queued = 128;
+        pollable_fd_state& _listenfd;
+        circular_buffer<file_desc> _accepted;
+        std::optional<promise<std::tuple<pollable_fd, socket_address>>> _waiter;
+        std::exception_ptr _error;
+
+        void arm() {
+            multishot_request::arm([this] (::io_uring_sqe* sqe) {
+                ::io_uring_prep_multishot_accept(sqe, _listenfd.fd.get(), nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            });
+        }
+        void deliver() {
+            if (!_waiter) {
+                return;
+            }
+            if (!_accepted.empty()) {
+                auto fd = std::move(_accepted.front());
+                _accepted.pop_front();
+                try {
+                    auto sa = fd.get_remote_address();
+                    pollable_fd pfd(std::move(fd), pollable_fd::speculation(EPOLLOUT));
+                    _waiter->set_value(std::move(pfd), std::move(sa));
+                } catch (...) {
+                    _waiter->set_exception(std::current_exception());
+                }
+            } else if (_error) {
+                _waiter->set_exception(std::exchange(_error, nullptr));
+            } else if (!_armed) {
+                arm();
+                return;
+            } else {
+                return;
+            }
+            _waiter.reset();
+        }
+    protected:
+        virtual void handle(int res, unsigned flags) override {
+            if (res >= 0) {
+                _accepted.push_back(file_desc::from_fd(res));
+                if (_accepted.size() >= max_queued) {
+                    cancel();
+                }
+            } else if (res != -ECANCELED) {
+                try {
+                    if (res == -EINVAL) {
+                        // The chances are that we shutting down the connection.
+                        _listenfd.maybe_no_more_recv();
+                    }
+                    throw std::system_error(-res, std::system_category());
+                } catch (...) {
+                    _error = std::current_exception();
+                }
+            }
+            deliver();
+        }
+        virtual void discard(int res, unsigned flags) noexcept override {
+            if (res >= 0) {
+                ::close(res);
+            }
+        }
+    public:
+        multishot_accept(reactor_backend_uring& be, pollable_fd_state& listenfd) noexcept
+                : multishot_request(be), _listenfd(listenfd) {
+        }
+        future<std::tuple<pollable_fd, socket_address>> accept() {
+            _waiter.emplace();
+            auto fut = _waiter->get_future();
+            deliver();
+            return fut;
+        }
+    };
+
     hrtimer_completion _hrtimer_completion;
     smp_wakeup_completion _smp_wakeup_completion;
+
+    // Registered ("fixed") files and buffers, see --io-uring-fixed-io.
+    // The kernel caps a single registered buffer at 1GB, so shard memory
+    // is registered as a sequence of 1GB slices and a request can use a
+    // fixed buffer only if it doesn't cross a slice boundary.
+    static constexpr unsigned s_fixed_files = 4096;
+    static constexpr size_t s_fixed_buffer_size = size_t(1) << 30;
+    struct fixed_file {
+        unsigned slot;
+        unsigned refs;
+    };
+    bool _has_fixed_files = false;
+    std::unordered_map<int, fixed_file> _fixed_files;
+    std::vector<unsigned> _free_fixed_file_slots;
+    // Slots of unregistered files. They stay set in the kernel's table
+    // until the requests prepared with them have left the submission ring,
+    // and cannot be handed out again before that.
+    std::vector<unsigned> _released_fixed_file_slots;
+    uintptr_t _fixed_buffers_start = 0;
+    uintptr_t _fixed_buffers_end = 0;
+
+    // Sends of at least this many bytes are zero-copy, see
+    // --io-uring-zerocopy-send-threshold (0 disables)
+    size_t _zerocopy_send_threshold = 0;
+
+    // Multishot accept and receive, see --io-uring-multishot-net
+    bool _multishot_net = false;
+    std::shared_ptr<provided_buffer_ring> _recv_buffers;
 private:
     static file_desc make_timerfd() {
         return file_desc::timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC|TFD_NONBLOCK);
     }
 
+    ::io_uring make_uring() {
+        if (_r._cfg.uring_sqpoll) {
+            auto params = ::io_uring_params{};
+            params.flags = IORING_SETUP_SQPOLL;
+            // Keep the polling thread awake across the polls of a busy
+            // reactor, which come at least once per task quota
+            params.sq_thread_idle = std::max<unsigned>(1, std::chrono::ceil<std::chrono::milliseconds>(2 * _r._cfg.task_quota).count());
+            // One polling thread serves all the shards: the first ring
+            // creates it, the others attach to it
+            auto lock = std::lock_guard(sqpoll_owner_mutex);
+            std::optional<::io_uring> ring;
+            if (sqpoll_owner_ring_fd >= 0) {
+                auto attach_params = params;
+                attach_params.flags |= IORING_SETUP_ATTACH_WQ;
+                attach_params.wq_fd = sqpoll_owner_ring_fd;
+                ring = try_create_uring(s_queue_len, false, attach_params);
+            }
+            if (!ring) {
+                if (auto cpu = sqpoll_cpu(_r._cfg.uring_sqpoll_cpus)) {
+                    params.flags |= IORING_SETUP_SQ_AFF;
+                    params.sq_thread_cpu = *cpu;
+                }
+                ring = try_create_uring(s_queue_len, false, params);
+                if (ring && sqpoll_owner_ring_fd < 0) {
+                    sqpoll_owner_ring_fd = ring->ring_fd;
+                }
+            }
+            if (ring) {
+                _sqpoll = true;
+                return *ring;
+            }
+            if (_r._id == 0) {
+                seastar_logger.warn("io_uring: cannot create a SQPOLL ring (requires Linux 5.11, or CAP_SYS_ADMIN on older kernels),"
+                        " falling back to submitting from the reactor");
+            }
+        }
+        return try_create_uring(s_queue_len, true).value();
+    }
+
+    void setup_fixed_files() {
+        std::vector<int> fds(s_fixed_files, -1);
+        auto r = ::io_uring_register_files(&_uring, fds.data(), fds.size());
+        if (r < 0) {
+            seastar_logger.warn("io_uring: failed to register file table ({}), continuing without fixed files", std::error_code(-r, std::system_category()).message());
+            return;
+        }
+        _free_fixed_file_slots.reserve(s_fixed_files);
+        _released_fixed_file_slots.reserve(s_fixed_files);
+        for (unsigned slot = s_fixed_files; slot > 0; --slot) {
+            _free_fixed_file_slots.push_back(slot - 1);
+        }
+        _has_fixed_files = true;
+    }
+
+    void setup_fixed_buffers() {
+        memory::memory_layout layout;
+        try {
+            layout = memory::get_memory_layout();
+        } catch (...) {
+            seastar_logger.warn("io_uring: cannot register buffers without the seastar allocator, continuing without fixed buffers");
+            return;
+        }
+        std::vector<::iovec> iovs;
+        for (auto p = layout.start; p < layout.end; p += s_fixed_buffer_size) {
+            iovs.push_back(::iovec{reinterpret_cast<void*>(p), std::min<size_t>(s_fixed_buffer_size, layout.end - p)});
+        }
+        auto r = ::io_uring_register_buffers(&_uring, iovs.data(), iovs.size());
+        if (r < 0) {
+            seastar_logger.warn("io_uring: failed to register {} bytes of buffers ({}), continuing without fixed buffers",
+                    layout.end - layout.start, std::error_code(-r, std::system_category()).message());
+            return;
+        }
+        _fixed_buffers_start = layout.start;
+        _fixed_buffers_end = layout.end;
+    }
+
+    void setup_multishot_net() {
+        if (!kernel_uname().whitelisted({"6.0"})) {
+            if (_r._id == 0) {
+                seastar_logger.warn("io_uring: multishot networking requires Linux 6.0, continuing without it");
+            }
+            return;
+        }
+        int err = 0;
+        auto ring = ::io_uring_setup_buf_ring(&_uring, provided_buffer_ring::entries, provided_buffer_ring::group_id, 0, &err);
+        if (!ring) {
+            seastar_logger.warn("io_uring: failed to set up receive buffer ring ({}), continuing without multishot networking",
+                    std::error_code(-err, std::system_category()).message());
+            return;
+        }
+        _recv_buffers = std::make_shared<provided_buffer_ring>(_uring, ring);
+        _multishot_net = true;
+    }
+
+    // Clears the slots of the unregistered files once the kernel has
+    // consumed every request prepared with them. Requests consumed by the
+    // kernel keep the file they were issued against until they complete,
+    // even if the slot is cleared meanwhile.
+    bool release_fixed_file_slots() {
+        if (_released_fixed_file_slots.empty() || ::io_uring_sq_ready(&_uring)) {
+            return false;
+        }
+        for (auto slot : _released_fixed_file_slots) {
+            int none = -1;
+            ::io_uring_register_files_update(&_uring, slot, &none, 1);
+            // Doesn't allocate, capacity for all slots was reserved up front
+            _free_fixed_file_slots.push_back(slot);
+        }
+        _released_fixed_file_slots.clear();
+        return true;
+    }
+
+    // Returns the registered slot of fd, or -1 if it isn't registered
+    int fixed_file_slot(int fd) const noexcept {
+        if (!_has_fixed_files) {
+            return -1;
+        }
+        auto it = _fixed_files.find(fd);
+        return it == _fixed_files.end() ? -1 : int(it->second.slot);
+    }
+
+    // Returns the index of the registered buffer that fully contains
+    // [addr, addr + size), or -1 if there's none
+    int fixed_buffer_index(const void* addr, size_t size) const noexcept {
+        auto start = reinterpret_cast<uintptr_t>(addr);
+        if (start < _fixed_buffers_start || start + size > _fixed_buffers_end || size == 0) {
+            return -1;
+        }
+        auto first = (start - _fixed_buffers_start) / s_fixed_buffer_size;
+        auto last = (start + size - 1 - _fixed_buffers_start) / s_fixed_buffer_size;
+        return first == last ? int(first) : -1;
+    }
+
     // Can fail if the completion queue is full
     ::io_uring_sqe* try_get_sqe() {
+        if (::io_uring_sq_ready(&_uring) == 0) {
+            _oldest_unsubmitted = sched_clock::now();
+        }
         return ::io_uring_get_sqe(&_uring);
     }
 
+    // Hands queued entries over to the kernel. Unless forced, a batch smaller
+    // than --io-uring-submit-batch is held back while the reactor has tasks to
+    // run, for at most a task quota. With SQPOLL submission needs no system
+    // call (unless the polling thread went idle), so nothing is held back.
+    bool submit(bool force) {
+        auto pending = ::io_uring_sq_ready(&_uring);
+        if (pending == 0) {
+            return false;
+        }
+        if (!force && !_sqpoll && pending < _r._cfg.uring_submit_batch && _r.have_more_tasks()
+                && sched_clock::now() - _oldest_unsubmitted < _r._cfg.task_quota) {
+            return false;
+        }
+        auto& stats = _r._io_stats;
+        if (!_sqpoll) {
+            stats.submit_syscalls++;
+        } else if (__atomic_load_n(_uring.sq.kflags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP) {
+            stats.submit_syscalls++;
+            stats.sqpoll_wakeups++;
+        }
+        stats.submitted_requests += pending;
+        ::io_uring_submit(&_uring);
+        return true;
+    }
+
     bool do_flush_submission_ring() {
         if (_has_pending_submissions) {
             _has_pending_submissions = false;
             _did_work_while_getting_sqe = false;
-            io_uring_submit(&_uring);
+            submit(true);
             return true;
         } else {
             return std::exchange(_did_work_while_getting_sqe, false);
@@ -1311,31 +1903,62 @@ class reactor_backend_uring final : public reactor_backend {
 
     void submit_io_request(const internal::io_request& req, io_completion* completion) {
         auto sqe = get_sqe();
+        // Only descriptors announced via register_file() (that is, files
+        // used for disk I/O) can have a slot, sockets never do
+        auto prep_fixed_file = [this, sqe] (int fd, auto prep) {
+            auto slot = fixed_file_slot(fd);
+            if (slot >= 0) {
+                prep(slot, true);
+                ::io_uring_sqe_set_flags(sqe, IOSQE_FIXED_FILE);
+            } else {
+                prep(fd, false);
+            }
+        };
         using o = internal::io_request::operation;
         switch (req.opcode()) {
             case o::read: {
                 const auto& op = req.as<io_request::operation::read>();
-                ::io_uring_prep_read(sqe, op.fd, op.addr, op.size, op.pos);
+                prep_fixed_file(op.fd, [&] (int fd, bool fixed) {
+                    auto buf = fixed ? fixed_buffer_index(op.addr, op.size) : -1;
+                    if (buf >= 0) {
+                        ::io_uring_prep_read_fixed(sqe, fd, op.addr, op.size, op.pos, buf);
+                    } else {
+                        ::io_uring_prep_read(sqe, fd, op.addr, op.size, op.pos);
+                    }
+                });
                 break;
             }
             case o::write: {
                 const auto& op = req.as<io_request::operation::write>();
-                ::io_uring_prep_write(sqe, op.fd, op.addr, op.size, op.pos);
+                prep_fixed_file(op.fd, [&] (int fd, bool fixed) {
+                    auto buf = fixed ? fixed_buffer_index(op.addr, op.size) : -1;
+                    if (buf >= 0) {
+                        ::io_uring_prep_write_fixed(sqe, fd, op.addr, op.size, op.pos, buf);
+                    } else {
+                        ::io_uring_prep_write(sqe, fd, op.addr, op.size, op.pos);
+                    }
+                });
                 break;
             }
             case o::readv: {
                 const auto& op = req.as<io_request::operation::readv>();
-                ::io_uring_prep_readv(sqe, op.fd, op.iovec, op.iov_len, op.pos);
+                prep_fixed_file(op.fd, [&] (int fd, bool) {
+                    ::io_uring_prep_readv(sqe, fd, op.iovec, op.iov_len, op.pos);
+                });
                 break;
             }
             case o::writev: {
                 const auto& op = req.as<io_request::operation::writev>();
-                ::io_uring_prep_writev(sqe, op.fd, op.iovec, op.iov_len, op.pos);
+                prep_fixed_file(op.fd, [&] (int fd, bool) {
+                    ::io_uring_prep_writev(sqe, fd, op.iovec, op.iov_len, op.pos);
+                });
                 break;
             }
             case o::fdatasync: {
                 const auto& op = req.as<io_request::operation::fdatasync>();
-                ::io_uring_prep_fsync(sqe, op.fd, IORING_FSYNC_DATASYNC);
+                prep_fixed_file(op.fd, [&] (int fd, bool) {
+                    ::io_uring_prep_fsync(sqe, fd, IORING_FSYNC_DATASYNC);
+                });
                 break;
             }
             case o::recv: {
@@ -1396,6 +2019,15 @@ class reactor_backend_uring final : public reactor_backend {
     void do_process_ready_kernel_completions(::io_uring_cqe** buf, size_t nr) {
         for (auto p = buf; p != buf + nr; ++p) {
             auto cqe = *p;
+            if (cqe->user_data & multishot_request::tag) {
+                auto request = reinterpret_cast<multishot_request*>(cqe->user_data & ~multishot_request::tag);
+                request->complete_with(cqe->res, cqe->flags);
+                continue;
+            }
+            if (!cqe->user_data) {
+                // Cancellation requests, nobody waits for them
+                continue;
+            }
             auto completion = reinterpret_cast<kernel_completion*>(cqe->user_data);
             completion->complete_with(cqe->res);
         }
@@ -1428,7 +2060,7 @@ class reactor_backend_uring final : public reactor_backend {
 public:
     explicit reactor_backend_uring(reactor& r)
             : _r(r)
-            , _uring(try_create_uring(s_queue_len, true).value())
+            , _uring(make_uring())
             , _hrtimer_timerfd(make_timerfd())
             , _preempt_io_context(_r, _r._task_quota_timer, _hrtimer_timerfd)
             , _hrtimer_completion(_r, _hrtimer_timerfd)
@@ -1437,8 +2069,32 @@ class reactor_backend_uring final : public reactor_backend {
         // expired when it really hasn't, we don't want to block in read(tfd, ...).
         auto tfd = _r._task_quota_timer.get();
         ::fcntl(tfd, F_SETFL, ::fcntl(tfd, F_GETFL) | O_NONBLOCK);
+        if (_r._cfg.uring_fixed_io) {
+            setup_fixed_files();
+            setup_fixed_buffers();
+        }
+        if (_r._cfg.uring_multishot_net) {
+            setup_multishot_net();
+        }
+        if (_r._cfg.uring_zerocopy_send_threshold) {
+            if (uring_opcode_supported(_uring, IORING_OP_SENDMSG_ZC)) {
+                _zerocopy_send_threshold = _r._cfg.uring_zerocopy_send_threshold;
+            } else if (_r._id == 0) {
+                seastar_logger.warn("io_uring: zero-copy send requires Linux 6.1, continuing without it");
+            }
+        }
     }
     ~reactor_backend_uring() {
+        if (_recv_buffers) {
+            _recv_buffers->orphan();
+        }
+        if (_sqpoll) {
+            // The rings attached so far keep the thread, later ones start anew
+            auto lock = std::lock_guard(sqpoll_owner_mutex);
+            if (sqpoll_owner_ring_fd == _uring.ring_fd) {
+                sqpoll_owner_ring_fd = -1;
+            }
+        }
         ::io_uring_queue_exit(&_uring);
     }
     virtual bool reap_kernel_completions() override {
@@ -1448,7 +2104,11 @@ class reactor_backend_uring final : public reactor_backend {
         bool did_work = false;
         did_work |= _preempt_io_context.service_preempting_io();
         did_work |= queue_pending_file_io();
-        did_work |= ::io_uring_submit(&_uring);
+        if (_recv_buffers) {
+            did_work |= _recv_buffers->recycle_returned();
+        }
+        did_work |= submit(false);
+        did_work |= release_fixed_file_slots();
         return did_work;
     }
     virtual bool kernel_events_can_sleep() const override {
@@ -1458,8 +2118,9 @@ class reactor_backend_uring final : public reactor_backend {
     virtual void wait_and_process_events(const sigset_t* active_sigmask) override {
         _smp_wakeup_completion.maybe_rearm(*this);
         _hrtimer_completion.maybe_rearm(*this);
-        ::io_uring_submit(&_uring);
+        submit(true);
         bool did_work = false;
+        did_work |= release_fixed_file_slots();
         did_work |= _preempt_io_context.service_preempting_io();
         did_work |= std::exchange(_did_work_while_getting_sqe, false);
         if (did_work) {
@@ -1495,9 +2156,22 @@ class reactor_backend_uring final : public reactor_backend {
     }
     virtual void forget(pollable_fd_state& fd) noexcept override {
         auto* pfd = static_cast<uring_pollable_fd_state*>(&fd);
+        if (pfd->_recv) {
+            pfd->_recv->detach();
+        }
+        if (pfd->_accept) {
+            pfd->_accept->detach();
+        }
         delete pfd;
     }
     virtual future<std::tuple<pollable_fd, socket_address>> accept(pollable_fd_state& listenfd) override {
+        if (_multishot_net) {
+            auto& ufd = static_cast<uring_pollable_fd_state&>(listenfd);
+            if (!ufd._accept) {
+                ufd._accept = new multishot_accept(*this, listenfd);
+            }
+            return ufd._accept->accept();
+        }
         if (listenfd.take_speculation(POLLIN)) {
             try {
                 listenfd.maybe_no_more_recv();
@@ -1693,6 +2367,17 @@ class reactor_backend_uring final : public reactor_backend {
         });
     }
     virtual future<size_t> sendmsg(pollable_fd_state& fd, net::packet& p) final {
+        if (_zerocopy_send_threshold && p.len() >= _zerocopy_send_threshold && !fd.no_zerocopy_send) {
+            // Copying the data is what zero-copy saves, so don't try the
+            // speculative synchronous send first
+            return (new zerocopy_send(*this, fd, p))->send().handle_exception_type([this, &fd, &p] (const std::system_error& e) {
+                if (e.code().value() != EOPNOTSUPP) {
+                    throw;
+                }
+                fd.no_zerocopy_send = true;
+                return sendmsg(fd, p);
+            });
+        }
         if (fd.take_speculation(EPOLLOUT)) {
             static_assert(offsetof(iovec, iov_base) == offsetof(net::fragment, base) &&
                 sizeof(iovec::iov_base) == sizeof(net::fragment::base) &&
@@ -1792,6 +2477,17 @@ class reactor_backend_uring final : public reactor_backend {
     }
 
     virtual future<temporary_buffer<char>> recv_some(pollable_fd_state& fd, internal::buffer_allocator* ba) override {
+        if (_multishot_net) {
+            auto& ufd = static_cast<uring_pollable_fd_state&>(fd);
+            if (!ufd._recv) {
+                ufd._recv = new multishot_recv(*this, fd);
+            }
+            return ufd._recv->recv(ba);
+        }
+        return plain_recv_some(fd, ba);
+    }
+
+    future<temporary_buffer<char>> plain_recv_some(pollable_fd_state& fd, internal::buffer_allocator* ba) {
         if (fd.take_speculation(POLLIN)) {
             auto buffer = ba->allocate_buffer();
             try {
@@ -1845,6 +2541,46 @@ class reactor_backend_uring final : public reactor_backend {
         return true;
     }
 
+    virtual void register_file(int fd) noexcept override {
+        if (!_has_fixed_files) {
+            return;
+        }
+        auto it = _fixed_files.find(fd);
+        if (it != _fixed_files.end()) {
+            it->second.refs++;
+            return;
+        }
+        if (_free_fixed_file_slots.empty()) {
+            // Table is full, the file will be used without registration
+            return;
+        }
+        auto slot = _free_fixed_file_slots.back();
+        auto r = ::io_uring_register_files_update(&_uring, slot, &fd, 1);
+        if (r < 0) {
+            seastar_logger.debug("io_uring: failed to register fd {}: {}", fd, std::error_code(-r, std::system_category()).message());
+            return;
+        }
+        try {
+            _fixed_files.emplace(fd, fixed_file{slot, 1});
+            _free_fixed_file_slots.pop_back();
+        } catch (...) {
+            int none = -1;
+            ::io_uring_register_files_update(&_uring, slot, &none, 1);
+        }
+    }
+    virtual void unregister_file(int fd) noexcept override {
+        auto it = _fixed_files.find(fd);
+        if (it == _fixed_files.end() || --it->second.refs) {
+            return;
+        }
+        // Requests for the file may still sit in the submission ring with
+        // the slot in them, see release_fixed_file_slots()
+        auto slot = it->second.slot;
+        _fixed_files.erase(it);
+        // Doesn't allocate, capacity for all slots was reserved up front
+        _released_fixed_file_slots.push_back(slot);
+    }
+
     virtual void signal_received(int signo, siginfo_t* siginfo, void* ignore) override {
         _r._signals.action(signo, siginfo, ignore);
     }
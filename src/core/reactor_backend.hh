@@ -209,6 +209,11 @@ class reactor_backend {
     virtual bool do_blocking_io() const {
         return false;
     }
+    // Files used for disk I/O are announced to the backend, which may
+    // register them with the kernel to make submission cheaper. Calls nest:
+    // a descriptor stays registered until unregistered as many times.
+    virtual void register_file(int fd) noexcept {}
+    virtual void unregister_file(int fd) noexcept {}
     virtual void signal_received(int signo, siginfo_t* siginfo, void* ignore) = 0;
     virtual void start_tick() = 0;
     virtual void stop_tick() = 0;
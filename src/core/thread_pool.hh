@@ -36,10 +36,12 @@ enum class thread_pool_submit_reason : size_t {
     file_operation,
     // Used for process operations that don't have non-blocking alternatives.
     process_operation,
+    // Used for the crypto of TLS handshakes, to keep it off the reactor.
+    tls_handshake,
 };
 
 class submit_metrics {
-    uint64_t _counters[static_cast<size_t>(thread_pool_submit_reason::process_operation) + 1]{};
+    uint64_t _counters[static_cast<size_t>(thread_pool_submit_reason::tls_handshake) + 1]{};
 
 public:
     void record_reason(thread_pool_submit_reason reason) {
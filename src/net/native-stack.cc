@@ -232,6 +232,8 @@ native_network_stack::native_network_stack(const native_stack_options& opts, std
     : _netif(std::move(dev))
     , _inet(&_netif) {
     _inet.get_udp().set_queue_size(opts.udpv4_queue_size.get_value());
+    _inet.get_tcp().set_congestion_control(opts.tcp_congestion_control.get_value());
+    _inet.get_tcp().set_sack(opts.tcp_sack.get_value());
     _dhcp = opts.host_ipv4_addr.defaulted()
             && opts.gw_ipv4_addr.defaulted()
             && opts.netmask_ipv4_addr.defaulted() && opts.dhcp.get_value();
@@ -372,6 +374,12 @@ native_stack_options::native_stack_options()
     , lro(*this, "lro",
                 "on",
                 "Enable LRO")
+    , tcp_congestion_control(*this, "tcp-congestion-control",
+                "reno",
+                "TCP congestion control algorithm (reno, cubic or bbr)")
+    , tcp_sack(*this, "tcp-sack",
+                false,
+                "Offer TCP selective acknowledgments (SACK) and recover from losses with them (off by default)")
     , virtio_opts(this)
     , dpdk_opts(this)
 {
@@ -23,8 +23,11 @@
 module;
 #endif
 
+#include <algorithm>
+#include <array>
 #include <chrono>
 #include <cstring>
+#include <deque>
 #include <functional>
 #include <random>
 #include <variant>
@@ -36,6 +39,7 @@ module;
 #include <arpa/inet.h>
 #include <net/route.h>
 #include <netinet/tcp.h>
+#include <netinet/udp.h>
 #include <netinet/sctp.h>
 #include <sys/socket.h>
 #include <seastar/util/assert.hh>
@@ -748,23 +752,33 @@ posix_ap_network_stack::listen(socket_address sa, listen_options opt) {
         server_socket(std::make_unique<posix_ap_server_socket_impl>(protocol, sa, _allocator));
 }
 
-struct cmsg_with_pktinfo {
-    struct cmsghdrcmh;
-    union {
-        struct in_pktinfo pktinfo;
-        struct in6_pktinfo pkt6info;
-    };
+// Control message space for the destination address (IP_PKTINFO) and the
+// segment size of a GRO-coalesced datagram (UDP_GRO).
+struct alignas(struct cmsghdr) cmsg_recv_buffer {
+    char buf[CMSG_SPACE(sizeof(struct in6_pktinfo)) + CMSG_SPACE(sizeof(int))];
+};
+
+// Control message space for the segment size of a GSO send (UDP_SEGMENT).
+struct alignas(struct cmsghdr) cmsg_segment_buffer {
+    char buf[CMSG_SPACE(sizeof(uint16_t))];
 };
 
 class posix_datagram_channel : public datagram_channel_impl {
 private:
     static constexpr int MAX_DATAGRAM_SIZE = 65507;
+    // GRO may coalesce several datagrams into a single receive of up to 64k.
+    static constexpr size_t RECV_BUFFER_SIZE = 65536;
+    // The kernel refuses GSO sends with more segments than this, and with
+    // segments that do not fit the device MTU, which we don't know; sizes
+    // that fit a standard Ethernet frame are safe.
+    static constexpr size_t MAX_GSO_SEGMENTS = 64;
+    static constexpr size_t MAX_GSO_SEGMENT_SIZE = 1452;
     struct recv_ctx {
         struct msghdr _hdr;
         struct iovec _iov;
         socket_address _src_addr;
         char* _buffer;
-        cmsg_with_pktinfo _cmsg;
+        cmsg_recv_buffer _cmsg;
 
         recv_ctx(bool use_pktinfo) {
             memset(&_hdr, 0, sizeof(_hdr));
@@ -787,9 +801,55 @@ class posix_datagram_channel : public datagram_channel_impl {
         recv_ctx(recv_ctx&&) = delete;
 
         void prepare() {
-            _buffer = new char[MAX_DATAGRAM_SIZE];
+            _buffer = new char[RECV_BUFFER_SIZE];
             _iov.iov_base = _buffer;
-            _iov.iov_len = MAX_DATAGRAM_SIZE;
+            _iov.iov_len = RECV_BUFFER_SIZE;
+            // recvmsg() shrinks both to what it wrote last time
+            _hdr.msg_namelen = sizeof(_src_addr.u.sas);
+            if (_hdr.msg_control) {
+                _hdr.msg_controllen = sizeof(_cmsg);
+            }
+        }
+    };
+    // Receive buffers for recvmmsg(). They are allocated on the first
+    // receive_batch() and reused; received datagrams are copied out so
+    // that they don't pin a 64k buffer each.
+    struct recv_batch_ctx {
+        static constexpr size_t max_batch = 16;
+        std::array<struct mmsghdr, max_batch> _msgs;
+        std::array<struct iovec, max_batch> _iovs;
+        std::array<socket_address, max_batch> _src_addrs;
+        std::array<cmsg_recv_buffer, max_batch> _cmsgs;
+        std::unique_ptr<char[]> _buffers;
+        bool _use_cmsg;
+
+        explicit recv_batch_ctx(bool use_cmsg)
+            : _buffers(new char[max_batch * RECV_BUFFER_SIZE])
+            , _use_cmsg(use_cmsg) {
+        }
+
+        recv_batch_ctx(const recv_batch_ctx&) = delete;
+        recv_batch_ctx(recv_batch_ctx&&) = delete;
+
+        char* buffer(size_t i) {
+            return _buffers.get() + i * RECV_BUFFER_SIZE;
+        }
+
+        void prepare(size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                auto& hdr = _msgs[i].msg_hdr;
+                memset(&_msgs[i], 0, sizeof(_msgs[i]));
+                _iovs[i].iov_base = buffer(i);
+                _iovs[i].iov_len = RECV_BUFFER_SIZE;
+                hdr.msg_iov = &_iovs[i];
+                hdr.msg_iovlen = 1;
+                hdr.msg_name = &_src_addrs[i].u.sa;
+                hdr.msg_namelen = sizeof(_src_addrs[i].u.sas);
+                if (_use_cmsg) {
+                    hdr.msg_control = &_cmsgs[i];
+                    hdr.msg_controllen = sizeof(_cmsgs[i]);
+                }
+            }
         }
     };
     struct send_ctx {
@@ -818,6 +878,107 @@ class posix_datagram_channel : public datagram_channel_impl {
         }
     };
 
+    // Groups the datagrams of a send_batch() into sendmmsg() entries. With
+    // GSO, runs of datagrams to the same destination that share a size
+    // (the last one may be shorter) are sent as a single UDP_SEGMENT message
+    // and split by the kernel or the NIC.
+    struct send_batch_ctx {
+        std::vector<outgoing_datagram> _datagrams;
+        std::vector<socket_address> _dsts;
+        std::vector<struct iovec> _iovecs;
+        std::vector<struct mmsghdr> _msgs;
+        std::vector<cmsg_segment_buffer> _cmsgs;
+        // Per message: index of its first datagram, first iovec and the GSO
+        // segment size (0 if it carries a single datagram).
+        std::vector<size_t> _first_datagram;
+        std::vector<size_t> _first_iovec;
+        std::vector<uint16_t> _segment_size;
+        size_t _done = 0;
+
+        explicit send_batch_ctx(std::vector<outgoing_datagram> datagrams) : _datagrams(std::move(datagrams)) {}
+
+        void prepare(bool gso) {
+            _dsts.clear();
+            _iovecs.clear();
+            _msgs.clear();
+            _first_datagram.clear();
+            _first_iovec.clear();
+            _segment_size.clear();
+            _done = 0;
+            size_t segments = 0;
+            size_t bytes = 0;
+            size_t segment_size = 0;
+            for (size_t i = 0; i < _datagrams.size(); i++) {
+                auto& d = _datagrams[i];
+                auto dst = d.dst;
+                resolve_outgoing_address(dst);
+                auto len = d.data.len();
+                bool merge = gso && !_msgs.empty()
+                        && bytes == segments * segment_size
+                        && len > 0 && len <= segment_size
+                        && segments < MAX_GSO_SEGMENTS
+                        && bytes + len <= MAX_DATAGRAM_SIZE
+                        && _iovecs.size() - _first_iovec.back() + d.data.nr_frags() <= IOV_MAX
+                        && dst == _dsts.back();
+                if (!merge) {
+                    _dsts.push_back(dst);
+                    _msgs.emplace_back();
+                    _first_datagram.push_back(i);
+                    _first_iovec.push_back(_iovecs.size());
+                    _segment_size.push_back(0);
+                    segments = 0;
+                    bytes = 0;
+                    segment_size = len <= MAX_GSO_SEGMENT_SIZE ? len : 0;
+                }
+                for (auto& f : d.data.fragments()) {
+                    _iovecs.push_back({f.base, f.size});
+                }
+                segments++;
+                bytes += len;
+                if (segments > 1) {
+                    _segment_size.back() = segment_size;
+                }
+            }
+            _cmsgs.resize(_msgs.size());
+            for (size_t i = 0; i < _msgs.size(); i++) {
+                auto& hdr = _msgs[i].msg_hdr;
+                memset(&_msgs[i], 0, sizeof(_msgs[i]));
+                hdr.msg_name = &_dsts[i].u.sa;
+                hdr.msg_namelen = _dsts[i].addr_length;
+                hdr.msg_iov = _iovecs.data() + _first_iovec[i];
+                hdr.msg_iovlen = (i + 1 < _msgs.size() ? _first_iovec[i + 1] : _iovecs.size()) - _first_iovec[i];
+                if (_segment_size[i]) {
+                    hdr.msg_control = &_cmsgs[i];
+                    hdr.msg_controllen = sizeof(_cmsgs[i]);
+                    auto* cmsg = CMSG_FIRSTHDR(&hdr);
+                    cmsg->cmsg_level = SOL_UDP;
+                    cmsg->cmsg_type = UDP_SEGMENT;
+                    cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                    memcpy(CMSG_DATA(cmsg), &_segment_size[i], sizeof(uint16_t));
+                }
+            }
+        }
+
+        bool done() const {
+            return _done == _msgs.size();
+        }
+
+        bool next_is_segmented() const {
+            return _segment_size[_done] != 0;
+        }
+
+        // Rebuilds the unsent part of the batch without GSO.
+        void restart_without_gso() {
+            _datagrams.erase(_datagrams.begin(), _datagrams.begin() + _first_datagram[_done]);
+            prepare(false);
+        }
+    };
+
+    struct recv_info {
+        std::optional<socket_address> dst;
+        size_t segment_size = 0;
+    };
+
     static bool is_inet(sa_family_t family) {
         return family == AF_INET || family == AF_INET6;
     }
@@ -835,10 +996,31 @@ class posix_datagram_channel : public datagram_channel_impl {
         return fd;
     }
 
+    static bool try_setsockopt(file_desc& fd, int level, int optname, int value) noexcept {
+        return ::setsockopt(fd.get(), level, optname, &value, sizeof(value)) == 0;
+    }
+
+    // Both offloads are best effort: they need Linux 5.0 (GRO) and
+    // 4.18 (GSO) and are only meaningful for UDP.
+    void enable_offloads(file_desc& fd, sa_family_t family) noexcept {
+        if (is_inet(family)) {
+            try_setsockopt(fd, SOL_UDP, UDP_GRO, 1);
+            _gso = try_setsockopt(fd, SOL_UDP, UDP_SEGMENT, 0);
+        }
+    }
+
+    recv_info parse_cmsgs(struct msghdr& hdr) const;
+    template <typename Func>
+    static void for_each_segment(size_t size, size_t segment_size, Func func);
+
     pollable_fd _fd;
     socket_address _address;
     recv_ctx _recv;
     send_ctx _send;
+    std::unique_ptr<recv_batch_ctx> _recv_batch;
+    // Datagrams split off a GRO-coalesced receive() and not yet returned.
+    std::deque<datagram> _pending;
+    bool _gso = false;
     bool _closed;
 public:
     /// Creates a channel that is not bound to any socket address. The channel
@@ -847,6 +1029,7 @@ class posix_datagram_channel : public datagram_channel_impl {
     posix_datagram_channel(sa_family_t family)
         : _recv(is_inet(family)), _closed(false) {
         auto fd = create_socket(family);
+        enable_offloads(fd, family);
 
         _address = fd.get_address();
         _fd = std::move(fd);
@@ -858,6 +1041,7 @@ class posix_datagram_channel : public datagram_channel_impl {
         : _recv(is_inet(local.family())), _closed(false) {
         auto fd = create_socket(local.family());
         fd.bind(local.u.sa, local.addr_length);
+        enable_offloads(fd, local.family());
 
         _address = fd.get_address();
         _fd = std::move(fd);
@@ -867,6 +1051,8 @@ class posix_datagram_channel : public datagram_channel_impl {
     virtual future<datagram> receive() override;
     virtual future<> send(const socket_address& dst, const char *msg) override;
     virtual future<> send(const socket_address& dst, packet p) override;
+    virtual future<std::vector<datagram>> receive_batch(size_t max) override;
+    virtual future<> send_batch(std::vector<outgoing_datagram> batch) override;
     virtual void shutdown_input() override {
         _fd.shutdown(SHUT_RD, pollable_fd::shutdown_kernel_only::no);
     }
@@ -903,6 +1089,39 @@ future<> posix_datagram_channel::send(const socket_address& dst, packet p) {
             .then([len] (size_t size) { SEASTAR_ASSERT(size == len); });
 }
 
+future<> posix_datagram_channel::send_batch(std::vector<outgoing_datagram> batch) {
+    size_t len = 0;
+    for (auto& d : batch) {
+        len += d.data.len();
+    }
+    auto sg_id = internal::scheduling_group_index(current_scheduling_group());
+    bytes_sent[sg_id] += len;
+    return do_with(send_batch_ctx(std::move(batch)), [this] (send_batch_ctx& ctx) {
+        ctx.prepare(_gso);
+        return do_until([&ctx] { return ctx.done(); }, [this, &ctx] {
+            return _fd.sendmmsg(ctx._msgs.data() + ctx._done, ctx._msgs.size() - ctx._done).then([&ctx] (size_t sent) {
+                ctx._done += sent;
+            }).handle_exception([this, &ctx] (std::exception_ptr ep) {
+                // The kernel rejects GSO sends it can't offload (e.g. the
+                // segment doesn't fit the route MTU); fall back to plain
+                // sendmmsg() for the rest of this channel's life.
+                try {
+                    std::rethrow_exception(ep);
+                } catch (const std::system_error& e) {
+                    auto err = e.code().value();
+                    if (ctx.next_is_segmented() && (err == EINVAL || err == EIO)) {
+                        _gso = false;
+                        ctx.restart_without_gso();
+                        return make_ready_future<>();
+                    }
+                } catch (...) {
+                }
+                return make_exception_future<>(std::move(ep));
+            });
+        });
+    });
+}
+
 udp_channel
 posix_network_stack::make_udp_channel(const socket_address& addr) {
     if (!addr.is_unspecified()) {
@@ -956,30 +1175,98 @@ class posix_datagram : public datagram_impl {
     virtual packet& get_data() override { return _p; }
 };
 
+posix_datagram_channel::recv_info
+posix_datagram_channel::parse_cmsgs(struct msghdr& hdr) const {
+    recv_info info;
+    for (auto* cmsg = CMSG_FIRSTHDR(&hdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+        if (cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_PKTINFO) {
+            info.dst = ipv4_addr(copy_reinterpret_cast<in_pktinfo>(CMSG_DATA(cmsg)).ipi_addr, _address.port());
+        } else if (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_PKTINFO) {
+            info.dst = ipv6_addr(copy_reinterpret_cast<in6_pktinfo>(CMSG_DATA(cmsg)).ipi6_addr, _address.port());
+        } else if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+            info.segment_size = copy_reinterpret_cast<int>(CMSG_DATA(cmsg));
+        }
+    }
+    return info;
+}
+
+// Calls func(offset, length) for each datagram of a receive of \c size bytes
+// that GRO coalesced from \c segment_size datagrams (0 if not coalesced).
+template <typename Func>
+void posix_datagram_channel::for_each_segment(size_t size, size_t segment_size, Func func) {
+    if (segment_size == 0 || segment_size >= size) {
+        func(0, size);
+        return;
+    }
+    for (size_t off = 0; off < size; off += segment_size) {
+        func(off, std::min(segment_size, size - off));
+    }
+}
+
 future<datagram>
 posix_datagram_channel::receive() {
+    if (!_pending.empty()) {
+        auto d = std::move(_pending.front());
+        _pending.pop_front();
+        return make_ready_future<datagram>(std::move(d));
+    }
     _recv.prepare();
     return _fd.recvmsg(&_recv._hdr).then([this] (size_t size) {
-        std::optional<socket_address> dst;
-        for (auto* cmsg = CMSG_FIRSTHDR(&_recv._hdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(&_recv._hdr, cmsg)) {
-            if (cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_PKTINFO) {
-                dst = ipv4_addr(copy_reinterpret_cast<in_pktinfo>(CMSG_DATA(cmsg)).ipi_addr, _address.port());
-                break;
-            } else if (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_PKTINFO) {
-                dst = ipv6_addr(copy_reinterpret_cast<in6_pktinfo>(CMSG_DATA(cmsg)).ipi6_addr, _address.port());
-                break;
-            }
-        }
+        auto info = parse_cmsgs(_recv._hdr);
+        auto dst = info.dst ? *info.dst : _address;
         auto sg_id = internal::scheduling_group_index(current_scheduling_group());
         bytes_received[sg_id] += size;
-        return make_ready_future<datagram>(datagram(std::make_unique<posix_datagram>(
-            _recv._src_addr, dst ? *dst : _address, packet(fragment{_recv._buffer, size}, make_deleter([buf = _recv._buffer] { delete[] buf; })))));
+        auto p = packet(fragment{_recv._buffer, size}, make_deleter([buf = _recv._buffer] { delete[] buf; }));
+        if (info.segment_size == 0 || info.segment_size >= size) {
+            return make_ready_future<datagram>(datagram(std::make_unique<posix_datagram>(_recv._src_addr, dst, std::move(p))));
+        }
+        for_each_segment(size, info.segment_size, [&] (size_t off, size_t len) {
+            _pending.emplace_back(std::make_unique<posix_datagram>(_recv._src_addr, dst, p.share(off, len)));
+        });
+        auto d = std::move(_pending.front());
+        _pending.pop_front();
+        return make_ready_future<datagram>(std::move(d));
     }).handle_exception([p = _recv._buffer](auto ep) {
         delete[] p;
         return make_exception_future<datagram>(std::move(ep));
     });
 }
 
+future<std::vector<datagram>>
+posix_datagram_channel::receive_batch(size_t max) {
+    std::vector<datagram> ret;
+    while (!_pending.empty() && ret.size() < max) {
+        ret.push_back(std::move(_pending.front()));
+        _pending.pop_front();
+    }
+    if (!ret.empty()) {
+        return make_ready_future<std::vector<datagram>>(std::move(ret));
+    }
+    if (!_recv_batch) {
+        _recv_batch = std::make_unique<recv_batch_ctx>(is_inet(_address.family()));
+    }
+    auto n = std::clamp<size_t>(max, 1, recv_batch_ctx::max_batch);
+    _recv_batch->prepare(n);
+    return _fd.recvmmsg(_recv_batch->_msgs.data(), n).then([this] (size_t received) {
+        std::vector<datagram> ret;
+        ret.reserve(received);
+        size_t bytes = 0;
+        for (size_t i = 0; i < received; i++) {
+            auto& msg = _recv_batch->_msgs[i];
+            auto info = parse_cmsgs(msg.msg_hdr);
+            auto dst = info.dst ? *info.dst : _address;
+            auto* buf = _recv_batch->buffer(i);
+            for_each_segment(msg.msg_len, info.segment_size, [&] (size_t off, size_t len) {
+                ret.emplace_back(std::make_unique<posix_datagram>(_recv_batch->_src_addrs[i], dst, packet(fragment{buf + off, len})));
+            });
+            bytes += msg.msg_len;
+        }
+        auto sg_id = internal::scheduling_group_index(current_scheduling_group());
+        bytes_received[sg_id] += bytes;
+        return ret;
+    });
+}
+
 network_stack_entry register_posix_stack() {
     return network_stack_entry{
         "posix", std::make_unique<program_options::option_group>(nullptr, "Posix"),
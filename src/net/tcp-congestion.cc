@@ -0,0 +1,352 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2026 ScyllaDB
+ */
+
+#ifdef SEASTAR_MODULE
+module;
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <fmt/format.h>
+module seastar;
+#else
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <optional>
+#include <stdexcept>
+#include <fmt/format.h>
+#include <seastar/net/tcp-congestion.hh>
+#endif
+
+namespace seastar {
+
+namespace net {
+
+namespace {
+
+// RFC 5681
+class reno final : public tcp_congestion_control {
+public:
+    const char* name() const noexcept override {
+        return "reno";
+    }
+    void on_ack(tcp_congestion_window w, const tcp_ack_sample& s) override {
+        // RFC 6582: partial ACKs deflate the window, they don't grow it
+        if (s.in_recovery) {
+            return;
+        }
+        if (w.cwnd < w.ssthresh) {
+            // In slow start phase
+            w.cwnd += std::min(s.acked_bytes, w.mss);
+        } else {
+            // In congestion avoidance phase
+            uint32_t round_up = 1;
+            w.cwnd += std::max(round_up, w.mss * w.mss / w.cwnd);
+        }
+    }
+    void on_loss(tcp_congestion_window w, uint32_t in_flight) override {
+        // RFC5681 Step 3.2
+        w.ssthresh = std::max(in_flight / 2, 2 * w.mss);
+    }
+    void on_timeout(tcp_congestion_window w, uint32_t in_flight, bool first) override {
+        // According to RFC5681
+        // Update ssthresh only for the first retransmit
+        if (first) {
+            w.ssthresh = std::max(in_flight / 2, 2 * w.mss);
+        }
+        // Start the slow start process
+        w.cwnd = w.mss;
+    }
+    void on_recovery_end(tcp_congestion_window w, uint32_t in_flight) override {
+        // Set cwnd to min (ssthresh, max(FlightSize, SMSS) + SMSS)
+        w.cwnd = std::min(w.ssthresh, std::max(in_flight, w.mss) + w.mss);
+    }
+};
+
+// RFC 8312
+//
+// The window grows along a cubic function of the time since the last
+// reduction, centered on the window the loss happened at, so that it gets
+// back there quickly and probes slowly around it. That makes the growth
+// independent of the round-trip time, which is what keeps long fat links
+// busy after a loss where Reno needs one round trip per segment.
+class cubic final : public tcp_congestion_control {
+    using clock_type = std::chrono::steady_clock;
+    static constexpr double c = 0.4;
+    static constexpr double beta = 0.7;
+    // Windows are in segments, as in the RFC
+    double _w_max = 0;
+    // The cubic function plateaus at _origin, _k seconds into the epoch
+    double _origin = 0;
+    double _k = 0;
+    // Window standard TCP would have, see TCP-friendly region
+    double _w_est = 0;
+    std::optional<clock_type::time_point> _epoch_start;
+
+    void reduce(tcp_congestion_window w) {
+        _epoch_start.reset();
+        double cwnd = double(w.cwnd) / w.mss;
+        if (cwnd < _w_max) {
+            // Fast convergence, leave some room for the newer flows
+            _w_max = cwnd * (1 + beta) / 2;
+        } else {
+            _w_max = cwnd;
+        }
+        w.ssthresh = std::max(uint32_t(w.cwnd * beta), 2 * w.mss);
+    }
+public:
+    const char* name() const noexcept override {
+        return "cubic";
+    }
+    void on_ack(tcp_congestion_window w, const tcp_ack_sample& s) override {
+        if (s.in_recovery) {
+            return;
+        }
+        if (w.cwnd < w.ssthresh) {
+            w.cwnd += std::min(s.acked_bytes, w.mss);
+            return;
+        }
+        auto now = clock_type::now();
+        double cwnd = double(w.cwnd) / w.mss;
+        if (!_epoch_start) {
+            _epoch_start = now;
+            if (cwnd < _w_max) {
+                _k = std::cbrt((_w_max - cwnd) / c);
+                _origin = _w_max;
+            } else {
+                _k = 0;
+                _origin = cwnd;
+            }
+            _w_est = cwnd;
+        }
+        // Aim at the window of one round trip from now
+        auto t = std::chrono::duration<double>(now - *_epoch_start + s.srtt).count();
+        auto target = _origin + c * (t - _k) * (t - _k) * (t - _k);
+        // Never grow slower than standard TCP would
+        _w_est += 3 * (1 - beta) / (1 + beta) * s.acked_bytes / w.mss / cwnd;
+        target = std::max(target, _w_est);
+        // Nor faster than slow start
+        target = std::min(target, cwnd * 1.5);
+        if (target > cwnd) {
+            w.cwnd += std::max(1u, uint32_t((target - cwnd) / cwnd * s.acked_bytes));
+        }
+    }
+    void on_loss(tcp_congestion_window w, uint32_t in_flight) override {
+        reduce(w);
+    }
+    void on_timeout(tcp_congestion_window w, uint32_t in_flight, bool first) override {
+        if (first) {
+            reduce(w);
+        }
+        _epoch_start.reset();
+        w.cwnd = w.mss;
+    }
+    void on_recovery_end(tcp_congestion_window w, uint32_t in_flight) override {
+        w.cwnd = std::min(w.ssthresh, std::max(in_flight, w.mss) + w.mss);
+    }
+};
+
+// BBR v1 (draft-cardwell-iccrg-bbr-congestion-control)
+//
+// Keeps a model of the path, its bottleneck bandwidth and its minimum
+// round-trip time, and sizes the window to a multiple of their product
+// instead of reacting to losses. Random losses that aren't caused by
+// congestion thus don't shrink the window.
+//
+// The native stack doesn't pace its output, so the gains the draft applies
+// to the pacing rate are applied to the window instead, and a round is
+// timed from the moment it starts until the data in flight then is
+// delivered, which doubles as the round-trip time sample.
+class bbr final : public tcp_congestion_control {
+    using clock_type = std::chrono::steady_clock;
+    enum class mode { startup, drain, probe_bw, probe_rtt };
+    // 2/ln(2), the smallest gain that doubles the delivery rate every round
+    static constexpr double high_gain = 2.885;
+    static constexpr double cwnd_gain = 2;
+    static constexpr std::array<double, 8> probe_bw_gains = {1.25, 0.75, 1, 1, 1, 1, 1, 1};
+    static constexpr unsigned bw_filter_rounds = 10;
+    static constexpr std::chrono::seconds min_rtt_window{10};
+    static constexpr std::chrono::milliseconds probe_rtt_duration{200};
+    static constexpr uint32_t min_cwnd_segments = 4;
+
+    mode _mode = mode::startup;
+    // Delivery rate of the last rounds, in bytes per second
+    std::array<double, bw_filter_rounds> _bw{};
+    clock_type::duration _min_rtt = clock_type::duration::max();
+    clock_type::time_point _min_rtt_stamp = clock_type::now();
+    uint64_t _delivered = 0;
+    uint64_t _round = 0;
+    bool _round_started = false;
+    clock_type::time_point _round_start;
+    uint64_t _round_start_delivered = 0;
+    uint64_t _round_end_delivered = 0;
+    // Startup ends when the bandwidth stops growing for a few rounds
+    double _full_bw = 0;
+    unsigned _full_bw_rounds = 0;
+    bool _filled_pipe = false;
+    unsigned _cycle = 0;
+    std::optional<clock_type::time_point> _probe_rtt_done;
+    uint32_t _prior_cwnd = 0;
+
+    double max_bw() const {
+        return *std::max_element(_bw.begin(), _bw.end());
+    }
+    // The bandwidth-delay product scaled by gain, or 0 until the path is measured
+    uint32_t target(double gain, uint32_t mss) const {
+        auto bw = max_bw();
+        if (bw == 0 || _min_rtt == clock_type::duration::max()) {
+            return 0;
+        }
+        auto bdp = bw * std::chrono::duration<double>(_min_rtt).count();
+        return std::max(uint32_t(gain * bdp), min_cwnd_segments * mss);
+    }
+    void end_round(tcp_congestion_window w, clock_type::time_point now) {
+        auto rtt = now - _round_start;
+        if (rtt.count() > 0) {
+            _bw[_round % bw_filter_rounds] = (_delivered - _round_start_delivered) / std::chrono::duration<double>(rtt).count();
+            auto expired = now > _min_rtt_stamp + min_rtt_window;
+            if (rtt <= _min_rtt || expired) {
+                _min_rtt = rtt;
+                _min_rtt_stamp = now;
+            }
+            if (expired && _mode != mode::probe_rtt) {
+                // Let the queues drain to see the path's round-trip time again
+                _mode = mode::probe_rtt;
+                _prior_cwnd = std::max(_prior_cwnd, w.cwnd);
+                _probe_rtt_done.reset();
+            }
+        }
+        _round++;
+
+        if (!_filled_pipe) {
+            auto bw = max_bw();
+            if (bw >= _full_bw * 1.25) {
+                _full_bw = bw;
+                _full_bw_rounds = 0;
+            } else if (++_full_bw_rounds >= 3) {
+                _filled_pipe = true;
+            }
+        }
+        if (_mode == mode::startup && _filled_pipe) {
+            _mode = mode::drain;
+        } else if (_mode == mode::probe_bw) {
+            _cycle = (_cycle + 1) % probe_bw_gains.size();
+        }
+    }
+public:
+    const char* name() const noexcept override {
+        return "bbr";
+    }
+    void on_ack(tcp_congestion_window w, const tcp_ack_sample& s) override {
+        auto now = clock_type::now();
+        _delivered += s.acked_bytes;
+        if (_round_started && _delivered >= _round_end_delivered) {
+            _round_started = false;
+            end_round(w, now);
+        }
+        if (!_round_started && s.in_flight >= w.mss) {
+            _round_started = true;
+            _round_start = now;
+            _round_start_delivered = _delivered;
+            _round_end_delivered = _delivered + s.in_flight;
+        }
+
+        auto min_cwnd = min_cwnd_segments * w.mss;
+        if (_mode == mode::drain && s.in_flight <= target(1, w.mss)) {
+            _mode = mode::probe_bw;
+            // Skip the phases that probe for more and drain, that's what was just done
+            _cycle = 2;
+        }
+        if (_mode == mode::probe_rtt) {
+            if (!_probe_rtt_done && s.in_flight <= min_cwnd) {
+                _probe_rtt_done = now + probe_rtt_duration;
+            }
+            if (_probe_rtt_done && now >= *_probe_rtt_done) {
+                _probe_rtt_done.reset();
+                _min_rtt_stamp = now;
+                _mode = _filled_pipe ? mode::probe_bw : mode::startup;
+                w.cwnd = std::max(w.cwnd, _prior_cwnd);
+                _prior_cwnd = 0;
+            }
+        }
+        if (s.in_recovery) {
+            return;
+        }
+
+        switch (_mode) {
+        case mode::startup: {
+            auto t = target(high_gain, w.mss);
+            if (!t || w.cwnd < t) {
+                w.cwnd += s.acked_bytes;
+            }
+            break;
+        }
+        case mode::drain:
+        case mode::probe_bw: {
+            auto t = _mode == mode::drain ? target(1, w.mss) : target(cwnd_gain * probe_bw_gains[_cycle], w.mss);
+            w.cwnd = t ? std::min(w.cwnd + s.acked_bytes, t) : w.cwnd + s.acked_bytes;
+            break;
+        }
+        case mode::probe_rtt:
+            w.cwnd = std::min(w.cwnd, min_cwnd);
+            return;
+        }
+        w.cwnd = std::max(w.cwnd, min_cwnd);
+    }
+    void on_loss(tcp_congestion_window w, uint32_t in_flight) override {
+        // Not a congestion signal by itself, the window only goes down to
+        // what the network has proven to deliver for the time of the recovery
+        _prior_cwnd = std::max(_prior_cwnd, w.cwnd);
+        w.ssthresh = std::max(in_flight, min_cwnd_segments * w.mss);
+    }
+    void on_timeout(tcp_congestion_window w, uint32_t in_flight, bool first) override {
+        // Start over from one segment, the window then grows by the data
+        // acknowledged until it's back to the bandwidth-delay product
+        w.cwnd = w.mss;
+    }
+    void on_recovery_end(tcp_congestion_window w, uint32_t in_flight) override {
+        w.cwnd = std::max(w.cwnd, _prior_cwnd);
+        _prior_cwnd = 0;
+    }
+};
+
+}
+
+std::unique_ptr<tcp_congestion_control> make_tcp_congestion_control(std::string_view name) {
+    if (name == "reno") {
+        return std::make_unique<reno>();
+    } else if (name == "cubic") {
+        return std::make_unique<cubic>();
+    } else if (name == "bbr") {
+        return std::make_unique<bbr>();
+    }
+    throw std::invalid_argument(fmt::format("unknown TCP congestion control algorithm: {}", name));
+}
+
+}
+
+}
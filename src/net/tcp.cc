@@ -88,6 +88,29 @@ void tcp_option::parse(uint8_t* beg1, uint8_t* end1) {
     }
 }
 
+tcp_option::sack_blocks tcp_option::parse_sack_blocks(const uint8_t* beg1, const uint8_t* end1) {
+    const char* beg = reinterpret_cast<const char*>(beg1);
+    const char* end = reinterpret_cast<const char*>(end1);
+    while (beg < end) {
+        auto kind = option_kind(*beg);
+        if (kind == option_kind::eol) {
+            break;
+        } else if (kind == option_kind::nop) {
+            beg += option_len::nop;
+            continue;
+        }
+        auto len = beg + 1 < end ? uint8_t(beg[1]) : 0;
+        if (len < 2 || beg + len > end) {
+            break;
+        }
+        if (kind == option_kind::sack_blocks) {
+            return sack_blocks::read(beg);
+        }
+        beg += len;
+    }
+    return {};
+}
+
 uint8_t tcp_option::fill(void* h, const tcp_hdr* th, uint8_t options_size) {
     auto hdr = reinterpret_cast<char*>(h);
     auto off = hdr + tcp_hdr::len;
@@ -110,6 +133,16 @@ uint8_t tcp_option::fill(void* h, const tcp_hdr* th, uint8_t options_size) {
             off += win_scale.len;
             size += win_scale.len;
         }
+        if (_sack_enabled && (_sack_received || !ack_on)) {
+            auto sack = tcp_option::sack();
+            sack.write(off);
+            off += sack.len;
+            size += sack.len;
+        }
+    } else if (ack_on && _local_sack_blocks.nr) {
+        _local_sack_blocks.write(off);
+        off += _local_sack_blocks.len();
+        size += _local_sack_blocks.len();
     }
     if (size > 0) {
         // Insert NOP option
@@ -138,6 +171,11 @@ uint8_t tcp_option::get_size(bool syn_on, bool ack_on) {
         if (_win_scale_received || !ack_on) {
             size += option_len::win_scale;
         }
+        if (_sack_enabled && (_sack_received || !ack_on)) {
+            size += option_len::sack;
+        }
+    } else if (ack_on && _local_sack_blocks.nr) {
+        size += _local_sack_blocks.len();
     }
     if (size > 0) {
         size += option_len::eol;
@@ -29,15 +29,22 @@ module;
 #include <system_error>
 #include <memory>
 #include <chrono>
+#include <list>
 #include <span>
+#include <unordered_map>
 #include <unordered_set>
 
 #include <seastar/util/assert.hh>
 
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <gnutls/gnutls.h>
 #include <gnutls/x509.h>
+#if __has_include(<linux/tls.h>)
+#include <linux/tls.h>
+#endif
 
 #include <boost/any.hpp>
 #include <boost/range/iterator_range.hpp>
@@ -53,17 +60,23 @@ module seastar;
 #include <seastar/core/reactor.hh>
 #include <seastar/core/seastar.hh>
 #include <seastar/core/file.hh>
+#include <seastar/core/gate.hh>
+#include <seastar/core/lowres_clock.hh>
+#include <seastar/core/sharded.hh>
 #include <seastar/core/thread.hh>
 #include <seastar/core/sstring.hh>
 #include <seastar/core/semaphore.hh>
 #include <seastar/core/timer.hh>
 #include <seastar/core/print.hh>
+#include <seastar/core/with_scheduling_group.hh>
 #include <seastar/core/with_timeout.hh>
 #include <seastar/net/tls.hh>
 #include <seastar/net/stack.hh>
 #include <seastar/util/std-compat.hh>
 #include <seastar/util/variant_utils.hh>
 #include <seastar/core/fsnotify.hh>
+
+#include "core/thread_pool.hh"
 #endif
 
 namespace seastar {
@@ -394,18 +407,21 @@ class tls::certificate_credentials::impl: public gnutlsobj {
     }
 
     void set_x509_trust(const blob& b, x509_crt_format fmt) {
+        check_not_offloading();
         blob_wrapper w(b);
         gtls_chk(
                 gnutls_certificate_set_x509_trust_mem(_creds, &w,
                         gnutls_x509_crt_fmt_t(fmt)));
     }
     void set_x509_crl(const blob& b, x509_crt_format fmt) {
+        check_not_offloading();
         blob_wrapper w(b);
         gtls_chk(
                 gnutls_certificate_set_x509_crl_mem(_creds, &w,
                         gnutls_x509_crt_fmt_t(fmt)));
     }
     void set_x509_key(const blob& cert, const blob& key, x509_crt_format fmt) {
+        check_not_offloading();
         blob_wrapper w1(cert);
         blob_wrapper w2(key);
         gtls_chk(
@@ -414,12 +430,14 @@ class tls::certificate_credentials::impl: public gnutlsobj {
     }
     void set_simple_pkcs12(const blob& b, x509_crt_format fmt,
             const sstring& password) {
+        check_not_offloading();
         blob_wrapper w(b);
         gtls_chk(
                 gnutls_certificate_set_x509_simple_pkcs12_mem(_creds, &w,
                         gnutls_x509_crt_fmt_t(fmt), password.c_str()));
     }
     void dh_params(const tls::dh_params& dh) {
+        check_not_offloading();
 #if GNUTLS_VERSION_NUMBER >= 0x030506
         auto sec_param = dh._impl->sec_param();
         if (sec_param) {
@@ -432,6 +450,7 @@ class tls::certificate_credentials::impl: public gnutlsobj {
         _dh_params = std::move(cpy);
     }
     future<> set_system_trust() {
+        check_not_offloading();
         return async([this] {
             gtls_chk(gnutls_certificate_set_x509_system_trust(_creds));
             _load_system_trust = false; // should only do once, for whatever reason
@@ -444,6 +463,7 @@ class tls::certificate_credentials::impl: public gnutlsobj {
         return _client_auth;
     }
     void set_session_resume_mode(session_resume_mode m, std::span<const uint8_t> key = {}) {
+        check_not_offloading();
         _session_resume_mode = m;
         // (re-)generate session key
         if (m != session_resume_mode::NONE) {
@@ -463,6 +483,7 @@ class tls::certificate_credentials::impl: public gnutlsobj {
         return &_session_resume_key;
     }
     void set_priority_string(const sstring& prio) {
+        check_not_offloading();
         const char * err = prio.c_str();
         try {
             gnutls_priority_t p;
@@ -488,10 +509,40 @@ class tls::certificate_credentials::impl: public gnutlsobj {
         _alpn_protocols = protocols;
     }
 
+    void set_enable_ktls(bool enable) {
+        _enable_ktls = enable;
+    }
+
+    void set_session_cache(sharded<session_cache>* cache) {
+        _session_cache = cache;
+    }
+
+    void set_handshake_scheduling_group(std::optional<scheduling_group> sg) {
+        _handshake_sg = sg;
+    }
+
+    void set_max_concurrent_handshakes(size_t max) {
+        // Handshakes in progress keep the semaphore they got units from
+        _handshake_sem = max ? make_lw_shared<semaphore>(max) : nullptr;
+    }
+
+    void set_offload_handshakes(bool offload) {
+        _offload_handshakes = offload;
+    }
+
 private:
     friend class credentials_builder;
     friend class session;
 
+    // Offloaded handshake steps read the credentials in the syscall
+    // thread, so they must not change meanwhile. Reloads are fine, they
+    // replace the impl the sessions in progress keep a reference to.
+    void check_not_offloading() const {
+        if (_offloaded_steps) {
+            throw std::logic_error("TLS credentials modified while handshake steps are offloaded");
+        }
+    }
+
     bool need_load_system_trust() const {
         return _load_system_trust;
     }
@@ -515,6 +566,12 @@ class tls::certificate_credentials::impl: public gnutlsobj {
     bool _enable_certificate_verification = true;
     gnutls_datum _session_resume_key;
     std::vector<sstring> _alpn_protocols;
+    bool _enable_ktls = false;
+    sharded<session_cache>* _session_cache = nullptr;
+    std::optional<scheduling_group> _handshake_sg;
+    lw_shared_ptr<semaphore> _handshake_sem;
+    bool _offload_handshakes = false;
+    unsigned _offloaded_steps = 0;
 };
 
 tls::certificate_credentials::certificate_credentials()
@@ -596,6 +653,14 @@ void tls::certificate_credentials::set_enable_certificate_verification(bool enab
     _impl->set_enable_certificate_verification(enable);
 }
 
+void tls::certificate_credentials::set_enable_ktls(bool enable) {
+    _impl->set_enable_ktls(enable);
+}
+
+void tls::certificate_credentials::set_session_cache(sharded<session_cache>& cache) {
+    _impl->set_session_cache(&cache);
+}
+
 tls::server_credentials::server_credentials()
 #if GNUTLS_VERSION_NUMBER < 0x030600
     : server_credentials(dh_params{})
@@ -626,6 +691,134 @@ void tls::server_credentials::set_alpn_protocols(const std::vector<sstring>& pro
     _impl->set_alpn_protocols(protocols);
 }
 
+void tls::server_credentials::set_handshake_scheduling_group(scheduling_group sg) {
+    _impl->set_handshake_scheduling_group(sg);
+}
+
+void tls::server_credentials::set_max_concurrent_handshakes(size_t max) {
+    _impl->set_max_concurrent_handshakes(max);
+}
+
+void tls::server_credentials::set_offload_handshakes(bool offload) {
+    _impl->set_offload_handshakes(offload);
+}
+
+class tls::session_cache::impl {
+    struct entry {
+        session_data data;
+        lowres_clock::time_point expiry;
+        std::list<sstring>::iterator lru;
+    };
+
+    const session_cache_options _options;
+    std::unordered_map<sstring, entry> _entries;
+    // Most recently used first
+    std::list<sstring> _lru;
+    gate _gate;
+
+    void insert(const sstring& key, std::span<const uint8_t> data, lowres_clock::time_point expiry) {
+        auto i = _entries.find(key);
+        if (i == _entries.end()) {
+            if (_options.max_entries == 0) {
+                return;
+            }
+            if (_entries.size() >= _options.max_entries) {
+                remove(_lru.back());
+            }
+            _lru.push_front(key);
+            i = _entries.emplace(key, entry{{}, {}, _lru.begin()}).first;
+        } else {
+            _lru.splice(_lru.begin(), _lru, i->second.lru);
+        }
+        i->second.data.assign(data.begin(), data.end());
+        i->second.expiry = expiry;
+    }
+
+    void remove(const sstring& key) {
+        auto i = _entries.find(key);
+        if (i != _entries.end()) {
+            _lru.erase(i->second.lru);
+            _entries.erase(i);
+        }
+    }
+
+    // Applies func to the cache of every other shard, in the background
+    template <typename Func>
+    static void replicate(sharded<session_cache>& cache, Func func) {
+        if (smp::count == 1) {
+            return;
+        }
+        // A session missing from some shard costs a full handshake there
+        (void)try_with_gate(cache.local()._impl->_gate, [&cache, func = std::move(func)] {
+            return cache.invoke_on_others([func] (session_cache& c) {
+                func(*c._impl);
+            });
+        }).handle_exception([] (std::exception_ptr) {});
+    }
+
+public:
+    explicit impl(session_cache_options options)
+        : _options(std::move(options))
+    {}
+
+    const session_cache_options& options() const noexcept {
+        return _options;
+    }
+
+    size_t size() const noexcept {
+        return _entries.size();
+    }
+
+    // The data stays valid until the cache is next modified
+    static const session_data* get(sharded<session_cache>& cache, const sstring& key) {
+        auto& c = *cache.local()._impl;
+        auto i = c._entries.find(key);
+        if (i == c._entries.end()) {
+            return nullptr;
+        }
+        if (i->second.expiry <= lowres_clock::now()) {
+            c.remove(key);
+            return nullptr;
+        }
+        c._lru.splice(c._lru.begin(), c._lru, i->second.lru);
+        return &i->second.data;
+    }
+
+    static void put(sharded<session_cache>& cache, sstring key, std::span<const uint8_t> data) {
+        auto& c = *cache.local()._impl;
+        auto expiry = lowres_clock::now() + c._options.ttl;
+        c.insert(key, data, expiry);
+        replicate(cache, [key = std::move(key), data = session_data(data.begin(), data.end()), expiry] (impl& c) {
+            c.insert(key, data, expiry);
+        });
+    }
+
+    static void erase(sharded<session_cache>& cache, sstring key) {
+        cache.local()._impl->remove(key);
+        replicate(cache, [key = std::move(key)] (impl& c) {
+            c.remove(key);
+        });
+    }
+
+    future<> stop() {
+        return _gate.close();
+    }
+};
+
+tls::session_cache::session_cache(session_cache_options options)
+    : _impl(std::make_unique<impl>(std::move(options)))
+{}
+
+tls::session_cache::~session_cache() = default;
+
+future<> tls::session_cache::stop() {
+    return _impl->stop();
+}
+
+size_t tls::session_cache::size() const noexcept {
+    return _impl->size();
+}
+
 static const sstring dh_level_key = "dh_level";
 static const sstring x509_trust_key = "x509_trust";
 static const sstring x509_crl_key = "x509_crl";
@@ -741,6 +934,26 @@ void tls::credentials_builder::set_alpn_protocols(const std::vector<sstring>& pr
     _alpn_protocols = protocols;
 }
 
+void tls::credentials_builder::set_enable_ktls(bool enable) {
+    _enable_ktls = enable;
+}
+
+void tls::credentials_builder::set_session_cache(sharded<session_cache>& cache) {
+    _session_cache = &cache;
+}
+
+void tls::credentials_builder::set_handshake_scheduling_group(scheduling_group sg) {
+    _handshake_sg = sg;
+}
+
+void tls::credentials_builder::set_max_concurrent_handshakes(size_t max) {
+    _max_concurrent_handshakes = max;
+}
+
+void tls::credentials_builder::set_offload_handshakes(bool offload) {
+    _offload_handshakes = offload;
+}
+
 template<typename Blobs, typename Visitor>
 static void visit_blobs(Blobs& blobs, Visitor&& visitor) {
     auto visit = [&](const sstring& key, auto* vt) {
@@ -794,6 +1007,12 @@ void tls::credentials_builder::apply_to(certificate_credentials& creds) const {
     if (!_alpn_protocols.empty()) {
         creds._impl->set_alpn_protocols(_alpn_protocols);
     }
+
+    creds._impl->set_enable_ktls(_enable_ktls);
+    creds._impl->set_session_cache(_session_cache);
+    creds._impl->set_handshake_scheduling_group(_handshake_sg);
+    creds._impl->set_max_concurrent_handshakes(_max_concurrent_handshakes);
+    creds._impl->set_offload_handshakes(_offload_handshakes);
 }
 
 shared_ptr<tls::certificate_credentials> tls::credentials_builder::build_certificate_credentials() const {
@@ -1113,6 +1332,70 @@ future<shared_ptr<tls::server_credentials>> tls::credentials_builder::build_relo
 
 namespace tls {
 
+#ifdef TLS_TX
+
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+
+union ktls_crypto_info {
+    tls12_crypto_info_aes_gcm_128 aes_gcm_128;
+    tls12_crypto_info_aes_gcm_256 aes_gcm_256;
+#ifdef TLS_CIPHER_CHACHA20_POLY1305
+    tls12_crypto_info_chacha20_poly1305 chacha20_poly1305;
+#endif
+};
+
+/*
+ * Fills in the kernel's description of the session's write state, and
+ * returns its size, or zero if the kernel can't handle the cipher.
+ */
+static size_t get_ktls_crypto_info(gnutls_session_t session, ktls_crypto_info& info) {
+    auto version = gnutls_protocol_get_version(session);
+    if (version != GNUTLS_TLS1_2 && version != GNUTLS_TLS1_3) {
+        return 0;
+    }
+    gnutls_datum_t mac_key, iv, key;
+    unsigned char seq[8];
+    if (gnutls_record_get_state(session, 0, &mac_key, &iv, &key, seq) < 0) {
+        return 0;
+    }
+
+    auto fill = [&] (auto& ci, uint16_t cipher_type) -> size_t {
+        ci.info.version = version == GNUTLS_TLS1_2 ? TLS_1_2_VERSION : TLS_1_3_VERSION;
+        ci.info.cipher_type = cipher_type;
+        // TLS 1.2 AEAD ciphers with a salt send the rest of the nonce
+        // explicitly, gnutls uses the record sequence number for it
+        bool explicit_nonce = version == GNUTLS_TLS1_2 && sizeof(ci.salt) != 0;
+        if (key.size != sizeof(ci.key) || iv.size < sizeof(ci.salt) + (explicit_nonce ? 0 : sizeof(ci.iv))) {
+            return 0;
+        }
+        memcpy(ci.salt, iv.data, sizeof(ci.salt));
+        memcpy(ci.iv, explicit_nonce ? seq : iv.data + sizeof(ci.salt), sizeof(ci.iv));
+        memcpy(ci.rec_seq, seq, sizeof(ci.rec_seq));
+        memcpy(ci.key, key.data, sizeof(ci.key));
+        return sizeof(ci);
+    };
+
+    switch (gnutls_cipher_get(session)) {
+    case GNUTLS_CIPHER_AES_128_GCM:
+        return fill(info.aes_gcm_128, TLS_CIPHER_AES_GCM_128);
+    case GNUTLS_CIPHER_AES_256_GCM:
+        return fill(info.aes_gcm_256, TLS_CIPHER_AES_GCM_256);
+#ifdef TLS_CIPHER_CHACHA20_POLY1305
+    case GNUTLS_CIPHER_CHACHA20_POLY1305:
+        return fill(info.chacha20_poly1305, TLS_CIPHER_CHACHA20_POLY1305);
+#endif
+    default:
+        return 0;
+    }
+}
+
+#endif
+
 /**
  * Session wraps gnutls session, and is the
  * actual conduit for an TLS/SSL data flow.
@@ -1165,6 +1448,15 @@ class session : public enable_lw_shared_from_this<session> {
                     gnutls_session_ticket_enable_server(*this, _creds->get_session_resume_key());
                     break;
             }
+            // and session ID resumption
+            if (_creds->_session_cache) {
+                gnutls_db_set_ptr(*this, this);
+                gnutls_db_set_store_function(*this, &db_store_wrapper);
+                gnutls_db_set_retrieve_function(*this, &db_retrieve_wrapper);
+                gnutls_db_set_remove_function(*this, &db_remove_wrapper);
+                auto ttl = _creds->_session_cache->local()._impl->options().ttl;
+                gnutls_db_set_cache_expiration(*this, std::chrono::duration_cast<std::chrono::seconds>(ttl).count());
+            }
         }
 
         auto prio = _creds->get_priority();
@@ -1186,6 +1478,12 @@ class session : public enable_lw_shared_from_this<session> {
         // if we are a client, check if we have a session ticket to unpack.
         if (_type == type::CLIENT && !_options.session_resume_data.empty()) {
             gtls_chk(gnutls_session_set_data(*this, _options.session_resume_data.data(), _options.session_resume_data.size()));
+        } else if (_type == type::CLIENT && _creds->_session_cache && !_options.server_name.empty()) {
+            auto data = session_cache::impl::get(*_creds->_session_cache, client_cache_key());
+            // Data gnutls can't use any more only costs a full handshake
+            if (data && gnutls_session_set_data(*this, data->data(), data->size()) != GNUTLS_E_SUCCESS) {
+                session_cache::impl::erase(*_creds->_session_cache, client_cache_key());
+            }
         }
         _options.session_resume_data.clear(); // no need to keep around
 
@@ -1214,6 +1512,10 @@ class session : public enable_lw_shared_from_this<session> {
 
     typedef temporary_buffer<char> buf_type;
 
+    // Up to that many full records are corked before being sent
+    static constexpr size_t max_corked_records = 8;
+    static constexpr size_t recv_buffer_size = 32 * 1024;
+
     sstring cert_status_to_string(gnutls_certificate_type_t type, unsigned int status) {
         gnutls_datum_t out;
         gtls_chk(
@@ -1249,8 +1551,15 @@ class session : public enable_lw_shared_from_this<session> {
         if (_type == type::CLIENT && !_options.server_name.empty()) {
             gnutls_server_name_set(*this, GNUTLS_NAME_DNS, _options.server_name.data(), _options.server_name.size());
         }
+        if (offload_handshake()) {
+            return offload_handshake_step(func).then([this, func] (int res) {
+                return handshake_step_done(func, res);
+            });
+        }
+        return handshake_step_done(func, func(*this));
+    }
+    future<> handshake_step_done(int (*func)(gnutls_session_t), int res) {
         try {
-            auto res = func(*this);
             if (res < 0) {
                 switch (res) {
                 case GNUTLS_E_AGAIN:
@@ -1296,12 +1605,44 @@ class session : public enable_lw_shared_from_this<session> {
                 verify();
             }
             _connected = true;
+            maybe_cache_client_session();
             // make sure we reset output_pending
-            return wait_for_output();
+            return wait_for_output().then([this] {
+                maybe_offload_to_kernel();
+            });
         } catch (...) {
             return make_exception_future<>(std::current_exception());
         }
     }
+    bool offload_handshake() const {
+        return _type == type::SERVER && _creds->_offload_handshakes && !_creds->_session_cache;
+    }
+    /*
+     * Runs a handshake step in the syscall thread. Nothing else uses the
+     * session meanwhile, since the handshake holds both semaphores and
+     * the pull function only reads what's already in _input. The records
+     * gnutls pushes are collected and put once the step is done.
+     *
+     * The step holds a reference to the credentials, which a reload
+     * doesn't modify but replaces, and their setters refuse to run until
+     * the step is done, see check_not_offloading().
+     */
+    future<int> offload_handshake_step(int (*func)(gnutls_session_t)) {
+        return wait_for_output().then([this, func] {
+            _batch_output = true;
+            _creds->_offloaded_steps++;
+            return engine()._thread_pool->submit<int>(internal::thread_pool_submit_reason::tls_handshake, [this, func] {
+                return func(*this);
+            }).finally([creds = _creds] {
+                creds->_offloaded_steps--;
+            });
+        }).finally([this] {
+            _batch_output = false;
+            if (!_output_batch.empty()) {
+                _output_pending = _out.put(std::exchange(_output_batch, {}));
+            }
+        });
+    }
     future<> do_handshake() {
         if (_connected) {
             return make_ready_future<>();
@@ -1332,9 +1673,46 @@ class session : public enable_lw_shared_from_this<session> {
         if (_type == type::CLIENT) {
             throw std::system_error(GNUTLS_E_INVALID_REQUEST, error_category(), "re-handshake only applicable for server socket");
         }
+        if (_ktls) {
+            throw std::system_error(GNUTLS_E_INVALID_REQUEST, error_category(), "re-handshake not possible once the kernel encrypts the session");
+        }
         return do_handshake_sync(&session::do_force_rehandshake);
     }
 
+    /*
+     * Hands the encryption of the records we send over to the kernel, if
+     * asked to and the socket and the cipher allow it. Any failure leaves
+     * the session as it was, encrypting in gnutls.
+     *
+     * Decryption is not offloaded. The kernel fails reads at records other
+     * than application data (alerts, TLS 1.3 session tickets and key
+     * updates) unless the reader picks the record type out of the recvmsg()
+     * control messages, which data_source has no way to do.
+     */
+    void maybe_offload_to_kernel() noexcept {
+#ifdef TLS_TX
+        if (!_creds->_enable_ktls || _ktls) {
+            return;
+        }
+        ktls_crypto_info info;
+        auto size = get_ktls_crypto_info(*this, info);
+        if (!size) {
+            return;
+        }
+        try {
+            static constexpr char ulp[] = "tls";
+            _sock->set_sockopt(SOL_TCP, TCP_ULP, ulp, sizeof(ulp));
+            // Without keys the tls ULP passes writes through as they are,
+            // so it's fine to leave it attached if this fails
+            _sock->set_sockopt(SOL_TLS, TLS_TX, &info, size);
+            _ktls = true;
+        } catch (...) {
+            // Not a posix TCP socket, or no tls module or cipher in the kernel
+        }
+        explicit_bzero(&info, sizeof(info));
+#endif
+    }
+
     future<> handshake() {
         // maybe load system certificates before handshake, in case we
         // have not done so yet...
@@ -1343,6 +1721,17 @@ class session : public enable_lw_shared_from_this<session> {
                return handshake();
             });
         }
+        if (_type == type::SERVER && (_creds->_handshake_sg || _creds->_handshake_sem)) {
+            auto sg = _creds->_handshake_sg.value_or(current_scheduling_group());
+            return with_scheduling_group(sg, [this, sem = _creds->_handshake_sem] {
+                if (!sem) {
+                    return do_handshake_sync(&session::do_handshake);
+                }
+                return with_semaphore(*sem, 1, [this] {
+                    return do_handshake_sync(&session::do_handshake);
+                }).finally([sem] {});
+            });
+        }
         return do_handshake_sync(&session::do_handshake);
     }
 
@@ -1374,6 +1763,72 @@ class session : public enable_lw_shared_from_this<session> {
     static session * from_transport_ptr(gnutls_transport_ptr_t ptr) {
         return static_cast<session *>(ptr);
     }
+
+    // Server session ID database, backed by the session cache
+    static sstring server_cache_key(const gnutls_datum_t& id) {
+        return sstring("s") + sstring(reinterpret_cast<const char*>(id.data), id.size);
+    }
+    static int db_store_wrapper(void* ptr, gnutls_datum_t key, gnutls_datum_t data) {
+        try {
+            session_cache::impl::put(*static_cast<session*>(ptr)->_creds->_session_cache, server_cache_key(key), std::span(data.data, data.size));
+            return 0;
+        } catch (...) {
+            return GNUTLS_E_DB_ERROR;
+        }
+    }
+    static gnutls_datum_t db_retrieve_wrapper(void* ptr, gnutls_datum_t key) {
+        try {
+            auto data = session_cache::impl::get(*static_cast<session*>(ptr)->_creds->_session_cache, server_cache_key(key));
+            if (data) {
+                // gnutls takes ownership
+                auto res = static_cast<unsigned char*>(gnutls_malloc(data->size()));
+                if (res) {
+                    std::copy(data->begin(), data->end(), res);
+                    return gnutls_datum_t{res, unsigned(data->size())};
+                }
+            }
+        } catch (...) {
+        }
+        return gnutls_datum_t{nullptr, 0};
+    }
+    static int db_remove_wrapper(void* ptr, gnutls_datum_t key) {
+        try {
+            session_cache::impl::erase(*static_cast<session*>(ptr)->_creds->_session_cache, server_cache_key(key));
+            return 0;
+        } catch (...) {
+            return GNUTLS_E_DB_ERROR;
+        }
+    }
+
+    sstring client_cache_key() const {
+        return "c" + _options.server_name;
+    }
+
+    /*
+     * Keeps what a later connection to the same server needs to resume
+     * this session. TLS 1.2 sessions can be resumed as soon as the
+     * handshake is done. TLS 1.3 servers send tickets after it, so reads
+     * keep checking until one arrives. Each connection replaces what the
+     * previous one to the same server left.
+     */
+    void maybe_cache_client_session() noexcept {
+        if (_type != type::CLIENT || !_creds->_session_cache || _options.server_name.empty() || !_connected || _cached_session) {
+            return;
+        }
+        try {
+            if (gnutls_protocol_get_version(*this) == GNUTLS_TLS1_3
+                    ? (gnutls_session_get_flags(*this) & GNUTLS_SFLAGS_SESSION_TICKET) == 0
+                    : gnutls_session_is_resumed(*this) != 0) {
+                return;
+            }
+            gnutls_datum tmp;
+            gtls_chk(gnutls_session_get_data2(*this, &tmp));
+            session_cache::impl::put(*_creds->_session_cache, client_cache_key(), std::span(tmp.data, tmp.size));
+            _cached_session = true;
+        } catch (...) {
+            // Only means the next connection does a full handshake
+        }
+    }
 #if GNUTLS_VERSION_NUMBER >= 0x030406
     static int verify_wrapper(gnutls_session_t gs) {
         try {
@@ -1469,39 +1924,56 @@ class session : public enable_lw_shared_from_this<session> {
     }
 
     future<temporary_buffer<char>> do_get() {
-        // gnutls might have stuff in its buffers.
-        auto avail = gnutls_record_check_pending(*this);
-        if (avail == 0) {
-            // or we might...
-            avail = in_avail();
-        }
+        // gnutls might have stuff in its buffers, and we might too.
+        auto avail = gnutls_record_check_pending(*this) + in_avail();
         if (avail != 0) {
             // typically, unencrypted data can get smaller (padding),
-            // but not larger.
-            temporary_buffer<char> buf(avail);
-            auto n = gnutls_record_recv(*this, buf.get_write(), buf.size());
-            if (n < 0) {
-                switch (n) {
-                case GNUTLS_E_AGAIN:
+            // but not larger. So this fits all the complete records we
+            // have, which are decrypted in one go.
+            auto& buf = recv_buffer(avail);
+            size_t len = 0;
+            while (len < buf.size()) {
+                auto n = gnutls_record_recv(*this, buf.get_write() + len, buf.size() - len);
+                if (n > 0) {
+                    len += n;
+                    continue;
+                }
+                if (n == 0) {
+                    _eof = true;
+                    break;
+                }
+                if (n == GNUTLS_E_AGAIN) {
                     // Assume we got this because we read to little underlying
                     // data to finish a tls packet
-                    // Our input buffer should be empty now, so just go again
-                    return do_get();
-                case GNUTLS_E_REHANDSHAKE:
+                    if (len == 0) {
+                        // Our input buffer should be empty now, so just go again
+                        return do_get();
+                    }
+                    break;
+                }
+                if (n == GNUTLS_E_REHANDSHAKE) {
+                    if (_ktls) {
+                        // We can't send handshake records any more, and
+                        // a client may ignore a renegotiation request
+                        continue;
+                    }
                     // server requests new HS. must release semaphore, so set new state
-                    // and return nada.
+                    // and return nada (or the data before the request, the next
+                    // get() will do the handshake).
                     _connected = false;
-                    return make_ready_future<temporary_buffer<char>>();
-                default:
-                    _error = std::make_exception_ptr(std::system_error(n, error_category()));
+                    break;
+                }
+                _error = std::make_exception_ptr(std::system_error(n, error_category()));
+                if (len == 0) {
                     return make_exception_future<temporary_buffer<char>>(_error);
                 }
+                // Hand out what we've got, the next get() fails
+                break;
             }
-            buf.trim(n);
-            if (n == 0) {
-                _eof = true;
-            }
-            return make_ready_future<temporary_buffer<char>>(std::move(buf));
+            maybe_cache_client_session();
+            auto res = _recv_buf.share(0, len);
+            _recv_buf.trim_front(len);
+            return make_ready_future<temporary_buffer<char>>(std::move(res));
         }
         if (eof()) {
             return make_ready_future<temporary_buffer<char>>();
@@ -1512,6 +1984,16 @@ class session : public enable_lw_shared_from_this<session> {
         });
     }
 
+    // Plain text is decrypted into the unused tail of a buffer shared by
+    // consecutive gets, so that small records don't each cost an allocation.
+    // Returns that tail, which is at least size bytes long.
+    temporary_buffer<char>& recv_buffer(size_t size) {
+        if (_recv_buf.size() < size) {
+            _recv_buf = temporary_buffer<char>(std::max(size, recv_buffer_size));
+        }
+        return _recv_buf;
+    }
+
     typedef net::fragment* frag_iter;
 
     future<> do_put(frag_iter i, frag_iter e) {
@@ -1525,21 +2007,33 @@ class session : public enable_lw_shared_from_this<session> {
         // To avoid this, we explicitly break the message into 
         // block sized parts (same as normal case in gnutls)
         auto max_record_len = gnutls_record_get_max_size(*this);
+        auto max_corked = max_record_len * max_corked_records;
 
-        return do_for_each(i, e, [this, max_record_len](net::fragment& f) {
+        // The data is corked, so that gnutls packs the fragments into
+        // full sized records, and the records are then pushed together
+        return do_for_each(i, e, [this, max_record_len, max_corked](net::fragment& f) {
             auto ptr = f.base;
             auto size = f.size;
             size_t off = 0; // here to appease eclipse cdt
-            return repeat([this, ptr, size, off, max_record_len]() mutable {
+            return repeat([this, ptr, size, off, max_record_len, max_corked]() mutable {
                 if (off == size) {
                     return make_ready_future<stop_iteration>(stop_iteration::yes);
                 }
-                auto n = std::min(max_record_len, size - off);
+                if (_corked == max_corked) {
+                    return uncork().then([] {
+                        return make_ready_future<stop_iteration>(stop_iteration::no);
+                    });
+                }
+                if (_corked == 0) {
+                    gnutls_record_cork(*this);
+                }
+                auto n = std::min({max_record_len, size - off, max_corked - _corked});
                 auto res = gnutls_record_send(*this, ptr + off, n);
-                if (res > 0) { // don't really need to check, but...
+                if (res > 0) {
                     off += res;
+                    _corked += res;
+                    return make_ready_future<stop_iteration>(stop_iteration::no);
                 }
-                // what will we wait for? error or results...
                 // NOTE: we _can_ get an EAGAIN here since the
                 // addition of force_rehandshake ability (and possibly before)
                 // due to the tls buffering. Just wait + retrying should work
@@ -1552,6 +2046,37 @@ class session : public enable_lw_shared_from_this<session> {
                     return make_ready_future<stop_iteration>(stop_iteration::no);
                 });
             });
+        }).then([this] {
+            return uncork();
+        });
+    }
+    // Encrypts the corked data and sends the records with a single put
+    future<> uncork() {
+        if (_corked == 0) {
+            return wait_for_output();
+        }
+        return wait_for_output().then([this] {
+            return repeat([this] {
+                _batch_output = true;
+                auto res = gnutls_record_uncork(*this, 0);
+                _batch_output = false;
+                if (!_output_batch.empty()) {
+                    _output_pending = _out.put(std::exchange(_output_batch, {}));
+                }
+                if (res >= 0) {
+                    _corked = 0;
+                    return wait_for_output().then([] {
+                        return make_ready_future<stop_iteration>(stop_iteration::yes);
+                    });
+                }
+                auto f = res != GNUTLS_E_AGAIN && res != GNUTLS_E_INTERRUPTED
+                    ? handle_output_error(res)
+                    : wait_for_output()
+                    ;
+                return f.then([] {
+                    return make_ready_future<stop_iteration>(stop_iteration::no);
+                });
+            });
         });
     }
     future<> put(net::packet p) {
@@ -1566,16 +2091,11 @@ class session : public enable_lw_shared_from_this<session> {
                return put(std::move(p));
             });
         }
-
-        // We want to make sure that we call gnutls_record_send with as large
-        // packets as possible. This is because each call to gnutls_record_send
-        // translates to a sendmsg syscall. Further it results in larger TLS
-        // records which makes encryption/decryption faster. Hence to avoid
-        // cases where we would do an extra syscall for something like a 100
-        // bytes header we linearize the packet if it's below the max TLS record
-        // size.
-        if (p.nr_frags() > 1 && p.len() <= gnutls_record_get_max_size(*this)) {
-            p.linearize();
+        if (_ktls) {
+            // The kernel cuts the plain text into records as it goes
+            return with_semaphore(_out_sem, 1, [this, p = std::move(p)] () mutable {
+                return _out.put(p.release());
+            });
         }
 
         auto i = p.fragments().begin();
@@ -1599,6 +2119,22 @@ class session : public enable_lw_shared_from_this<session> {
         return n;
     }
     ssize_t vec_push(const giovec_t * iov, int iovcnt) {
+        if (_batch_output) {
+            // Records of an uncork, uncork() puts them all at once
+            ssize_t n = 0;
+            for (int i = 0; i < iovcnt; ++i) {
+                _output_batch.emplace_back(reinterpret_cast<const char*>(iov[i].iov_base), iov[i].iov_len);
+                n += iov[i].iov_len;
+            }
+            return n;
+        }
+        if (_ktls) {
+            // gnutls replying to a TLS 1.3 key update request. Its records
+            // would be encrypted again by the kernel, and it would switch
+            // to write keys the kernel doesn't have
+            gnutls_transport_set_errno(*this, EPROTO);
+            return -1;
+        }
         if (!_output_pending.available()) {
             gnutls_transport_set_errno(*this, EAGAIN);
             return -1;
@@ -1662,6 +2198,12 @@ class session : public enable_lw_shared_from_this<session> {
         if (_error || !_connected) {
             return make_ready_future();
         }
+        if (_ktls) {
+            // The kernel sends an alert record only when asked through a
+            // sendmsg() control message, so there's no close_notify.
+            // Closing the socket still ends the stream
+            return make_ready_future();
+        }
         auto res = gnutls_bye(*this, GNUTLS_SHUT_WR);
         if (res < 0) {
             switch (res) {
@@ -1785,6 +2327,11 @@ class session : public enable_lw_shared_from_this<session> {
             return gnutls_session_is_resumed(*this) != 0;
         });
     }
+    future<bool> uses_ktls() {
+        return state_checked_access([this] {
+            return _ktls;
+        });
+    }
     future<session_data> get_session_resume_data() {
         return state_checked_access([this] {
             /**
@@ -1974,10 +2521,21 @@ class session : public enable_lw_shared_from_this<session> {
     bool _eof = false;
     bool _shutdown = false;
     bool _connected = false;
+    // The kernel encrypts what we send, see maybe_offload_to_kernel()
+    bool _ktls = false;
     std::exception_ptr _error;
 
     future<> _output_pending;
     buf_type _input;
+    // See recv_buffer()
+    buf_type _recv_buf;
+    // Bytes passed to gnutls since the session was corked, see do_put()
+    size_t _corked = 0;
+    // Set while uncork() collects the records pushed into _output_batch
+    bool _batch_output = false;
+    // The session data or ticket went to the session cache
+    bool _cached_session = false;
+    std::vector<temporary_buffer<char>> _output_batch;
 
     // modify this to a unique_ptr to handle exceptions in our constructor.
     std::unique_ptr<std::remove_pointer_t<gnutls_session_t>, void(*)(gnutls_session_t)> _session;
@@ -2069,6 +2627,9 @@ class tls_connected_socket_impl : public net::connected_socket_impl, public sess
     future<bool> check_session_is_resumed() {
         return _session->is_resumed();
     }
+    future<bool> check_session_uses_ktls() {
+        return _session->uses_ktls();
+    }
     future<session_data> get_session_resume_data() {
         return _session->get_session_resume_data();
     }
@@ -2280,6 +2841,10 @@ future<bool> tls::check_session_is_resumed(connected_socket& socket) {
     return get_tls_socket(socket)->check_session_is_resumed();
 }
 
+future<bool> tls::check_session_uses_ktls(connected_socket& socket) {
+    return get_tls_socket(socket)->check_session_uses_ktls();
+}
+
 future<tls::session_data> tls::get_session_resume_data(connected_socket& socket) {
     return get_tls_socket(socket)->get_session_resume_data();
 }
@@ -292,6 +292,7 @@ export module seastar;
 #include <seastar/net/posix-stack.hh>
 #include <seastar/net/socket_defs.hh>
 #include <seastar/net/tcp.hh>
+#include <seastar/net/tcp-congestion.hh>
 #include <seastar/net/udp.hh>
 #include <seastar/net/tls.hh>
 
@@ -131,3 +131,57 @@ PERF_TEST_F(perf_fair_queue, contended_shared)
 {
     return test(false);
 }
+
+// Dispatching from many classes, heap vs calendar class selection
+struct perf_fair_queue_classes {
+    static constexpr unsigned nr_requests = 1 << 16;
+
+    std::vector<seastar::fair_queue_entry> entries;
+
+    perf_fair_queue_classes() {
+        entries.reserve(nr_requests);
+        for (unsigned i = 0; i < nr_requests; i++) {
+            entries.emplace_back(fair_queue_entry::capacity_t(1000 + (i % 7) * 300));
+        }
+    }
+
+    size_t test(seastar::fair_queue::config::class_selection sel, unsigned nr_classes) {
+        seastar::fair_queue::config cfg;
+        cfg.selection = sel;
+        seastar::fair_queue fq(cfg);
+        for (unsigned c = 0; c < nr_classes; c++) {
+            fq.register_priority_class(c, 100 + (c % 10) * 100);
+        }
+        for (unsigned i = 0; i < nr_requests; i++) {
+            fq.queue(i % nr_classes, entries[i]);
+        }
+
+        perf_tests::start_measuring_time();
+        while (fq.top() != nullptr) {
+            fq.pop_front();
+        }
+        perf_tests::stop_measuring_time();
+
+        for (unsigned c = 0; c < nr_classes; c++) {
+            fq.unregister_priority_class(c);
+        }
+        return nr_requests;
+    }
+};
+
+PERF_TEST_F(perf_fair_queue_classes, heap_16_classes)
+{
+    return test(fair_queue::config::class_selection::heap, 16);
+}
+PERF_TEST_F(perf_fair_queue_classes, calendar_16_classes)
+{
+    return test(fair_queue::config::class_selection::calendar, 16);
+}
+PERF_TEST_F(perf_fair_queue_classes, heap_4096_classes)
+{
+    return test(fair_queue::config::class_selection::heap, 4096);
+}
+PERF_TEST_F(perf_fair_queue_classes, calendar_4096_classes)
+{
+    return test(fair_queue::config::class_selection::calendar, 4096);
+}
@@ -0,0 +1,96 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2026 ScyllaDB
+ */
+
+#include <seastar/core/app-template.hh>
+#include <seastar/core/file.hh>
+#include <seastar/core/file_copy.hh>
+#include <seastar/core/seastar.hh>
+#include <seastar/core/thread.hh>
+#include <seastar/util/closeable.hh>
+#include <fmt/printf.h>
+#include <chrono>
+#include <string>
+
+using namespace seastar;
+
+int main(int ac, char** av) {
+    app_template at;
+    namespace bpo = boost::program_options;
+    at.add_options()
+            ("file-size", bpo::value<size_t>()->default_value(256 << 20), "Size of the file to copy")
+            ("chunk-size", bpo::value<size_t>()->default_value(1 << 20), "Size of the chunks")
+            ("concurrency", bpo::value<unsigned>()->default_value(4), "Chunks in flight")
+            ("kernel-copy", bpo::value<bool>()->default_value(false), "Let the kernel copy the data if it can")
+            ;
+    return at.run(ac, av, [&at] {
+        return seastar::async([&at] {
+            auto file_size = at.configuration()["file-size"].as<size_t>();
+            auto chunk_size = at.configuration()["chunk-size"].as<size_t>();
+            auto concurrency = at.configuration()["concurrency"].as<unsigned>();
+            auto kernel_copy = at.configuration()["kernel-copy"].as<bool>();
+
+            {
+                auto f = open_file_dma("testfile.tmp", open_flags::wo | open_flags::create | open_flags::exclusive).get();
+                auto close_f = deferred_close(f);
+                auto buf = temporary_buffer<char>::aligned(f.memory_dma_alignment(), chunk_size);
+                std::fill(buf.get_write(), buf.get_write() + buf.size(), 'x');
+                for (size_t pos = 0; pos < file_size; pos += chunk_size) {
+                    f.dma_write(pos, buf.get(), chunk_size).get();
+                }
+                f.truncate(file_size).get();
+                f.flush().get();
+            }
+
+            auto run = [&] (const char* op, unsigned depth, auto func) {
+                file_copy_options options;
+                options.chunk_size = chunk_size;
+                options.concurrency = depth;
+                options.kernel_copy = kernel_copy;
+                auto in = open_file_dma("testfile.tmp", open_flags::ro).get();
+                auto close_in = deferred_close(in);
+                auto start = std::chrono::steady_clock::now();
+                func(in, options);
+                auto end = std::chrono::steady_clock::now();
+                using fseconds = std::chrono::duration<float, std::ratio<1, 1>>;
+                auto mbps = file_size / std::chrono::duration_cast<fseconds>(end - start).count() / (1 << 20);
+                fmt::print("{:10} {:10d} {:10d} {:12.1f}\n", op, chunk_size, depth, mbps);
+            };
+            auto copy = [] (file& in, file_copy_options options) {
+                auto out = open_file_dma("testfile.copy.tmp", open_flags::wo | open_flags::create | open_flags::truncate).get();
+                auto close_out = deferred_close(out);
+                copy_file_contents(in, out, std::move(options)).get();
+            };
+            auto checksum = [] (file& in, file_copy_options options) {
+                checksum_file(in, std::move(options)).get();
+            };
+
+            fmt::print("{:10} {:10} {:10} {:12}\n", "op", "chunk", "iodepth", "MB/s");
+            // Queue depth 1 is what a plain read/write loop gets
+            for (auto depth : {1u, concurrency}) {
+                run("copy", depth, copy);
+                run("checksum", depth, checksum);
+            }
+
+            remove_file("testfile.copy.tmp").get();
+            remove_file("testfile.tmp").get();
+        });
+    });
+}
@@ -0,0 +1,127 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2026 ScyllaDB
+ */
+
+/*
+ * The test streams data from a TLS client to a TLS server on one shard,
+ * over an "in-memory" connection (see loopback_socket.hh), so what it
+ * measures is the cost of the TLS session itself.
+ *
+ * For every write size the client either flushes once at the end, or
+ * after every write, like a request/response protocol would.
+ */
+
+#include <seastar/core/app-template.hh>
+#include <seastar/core/memory.hh>
+#include <seastar/core/reactor.hh>
+#include <seastar/core/thread.hh>
+#include <seastar/core/when_all.hh>
+#include <seastar/net/tls.hh>
+#include <../../tests/unit/loopback_socket.hh>
+#include <fmt/printf.h>
+#include <chrono>
+#include <string>
+
+using namespace seastar;
+
+static future<> receive(connected_socket s, uint64_t total) {
+    auto in = s.input();
+    auto out = s.output();
+    uint64_t received = 0;
+    while (received < total) {
+        auto buf = co_await in.read();
+        if (buf.empty()) {
+            throw std::runtime_error("Unexpected EOF");
+        }
+        received += buf.size();
+    }
+    // So that the sender measures the whole transfer
+    co_await out.write("k", 1);
+    co_await out.flush();
+    co_await out.close();
+    co_await in.close();
+}
+
+static future<> send(connected_socket s, uint64_t total, size_t write_size, bool flush_each) {
+    auto in = s.input();
+    auto out = s.output();
+    temporary_buffer<char> chunk(write_size);
+    std::fill(chunk.get_write(), chunk.get_write() + chunk.size(), 'x');
+    for (uint64_t sent = 0; sent < total; sent += write_size) {
+        co_await out.write(chunk.get(), chunk.size());
+        if (flush_each) {
+            co_await out.flush();
+        }
+    }
+    co_await out.flush();
+    co_await in.read();
+    co_await out.close();
+    co_await in.close();
+}
+
+int main(int ac, char** av) {
+    app_template at;
+    namespace bpo = boost::program_options;
+    at.add_options()
+            ("total-size", bpo::value<size_t>()->default_value(256 << 20), "Bytes to send for every write size")
+            ("cert", bpo::value<std::string>()->default_value("tests/unit/test.crt"), "Server certificate (PEM)")
+            ("key", bpo::value<std::string>()->default_value("tests/unit/test.key"), "Server key (PEM)")
+            ;
+    return at.run(ac, av, [&at] {
+        return seastar::async([&at] {
+            auto total = at.configuration()["total-size"].as<size_t>();
+            auto cert = at.configuration()["cert"].as<std::string>();
+            auto key = at.configuration()["key"].as<std::string>();
+
+            tls::credentials_builder b;
+            b.set_x509_key_file(cert, key, tls::x509_crt_format::PEM).get();
+            auto server_creds = b.build_server_credentials();
+            auto client_creds = ::make_shared<tls::certificate_credentials>();
+            client_creds->set_enable_certificate_verification(false);
+
+            loopback_connection_factory lcf(1);
+            auto server = lcf.get_server_socket();
+            loopback_socket_impl lsi(lcf);
+
+            fmt::print("{:10} {:>10} {:>12} {:>12}\n", "flush", "write", "MB/s", "allocs/MB");
+            for (auto flush_each : {false, true}) {
+                for (size_t write_size : {512, 4096, 16384, 65536}) {
+                    auto accepted = server.accept();
+                    auto c = lsi.connect(socket_address(ipv4_addr()), socket_address(ipv4_addr())).get();
+                    auto s = accepted.get();
+                    auto client = tls::wrap_client(client_creds, std::move(c)).get();
+                    auto srv = tls::wrap_server(server_creds, std::move(s.connection)).get();
+
+                    auto mallocs = memory::stats().mallocs();
+                    auto start = std::chrono::steady_clock::now();
+                    when_all_succeed(receive(std::move(srv), total), send(std::move(client), total, write_size, flush_each)).get();
+                    auto end = std::chrono::steady_clock::now();
+
+                    using fseconds = std::chrono::duration<float, std::ratio<1, 1>>;
+                    auto mb = float(total) / (1 << 20);
+                    fmt::print("{:10} {:10d} {:12.1f} {:12.1f}\n", flush_each ? "every" : "end", write_size,
+                            mb / std::chrono::duration_cast<fseconds>(end - start).count(),
+                            (memory::stats().mallocs() - mallocs) / mb);
+                }
+            }
+            server.abort_accept();
+        });
+    });
+}
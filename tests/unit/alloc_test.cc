@@ -20,15 +20,19 @@
  */
 
 #include <seastar/core/memory.hh>
+#include <seastar/core/scheduling.hh>
 #include <seastar/core/shard_id.hh>
 #include <seastar/core/smp.hh>
 #include <seastar/core/temporary_buffer.hh>
+#include <seastar/core/with_scheduling_group.hh>
 #include <seastar/testing/perf_tests.hh>
 #include <seastar/testing/test_case.hh>
 #include <seastar/testing/thread_test_case.hh>
+#include <seastar/util/defer.hh>
 #include <seastar/util/log.hh>
 #include <seastar/util/memory_diagnostics.hh>
 
+#include <algorithm>
 #include <memory>
 #include <new>
 #include <vector>
@@ -100,6 +104,31 @@ SEASTAR_TEST_CASE(test_live_objects_counter_with_cross_cpu_free) {
     });
 }
 
+SEASTAR_TEST_CASE(test_cross_cpu_free_batching) {
+#ifndef SEASTAR_DEFAULT_ALLOCATOR
+    if (smp::count < 2) {
+        return make_ready_future<>();
+    }
+    return smp::submit_to(1, [] {
+        auto ret = std::vector<std::unique_ptr<int>>(10000);
+        for (auto& o : ret) {
+            o = std::make_unique<int>(0);
+        }
+        return ret;
+    }).then([] (auto&& vec) {
+        auto before = memory::stats();
+        vec.clear(); // cause cross-cpu free
+        auto after = memory::stats();
+        auto frees = after.cross_cpu_frees() - before.cross_cpu_frees();
+        auto batches = after.cross_cpu_free_batches() - before.cross_cpu_free_batches();
+        BOOST_REQUIRE_EQUAL(frees, 10000);
+        BOOST_REQUIRE_LE(batches, frees / 64);
+    });
+#else
+    return make_ready_future<>();
+#endif
+}
+
 SEASTAR_TEST_CASE(test_aligned_alloc) {
     for (size_t align = sizeof(void*); align <= 65536; align <<= 1) {
         for (size_t size = align; size <= align * 2; size <<= 1) {
@@ -661,6 +690,39 @@ SEASTAR_TEST_CASE(test_change_sample_rate)
     return seastar::make_ready_future();
 }
 
+SEASTAR_THREAD_TEST_CASE(test_sampled_heap_stats_per_scheduling_group)
+{
+    auto sg = create_scheduling_group("heapprof_test", 100).get();
+    auto destroy_sg = defer([sg] () noexcept { destroy_scheduling_group(sg).get(); });
+    auto before = seastar::memory::sampled_heap_stats(sg);
+
+    std::vector<volatile char*> ptrs(100);
+    with_scheduling_group(sg, [&ptrs] {
+        seastar::memory::set_heap_profiling_sampling_rate(100);
+        for (auto& ptr : ptrs) {
+            ptr = malloc_wrapper(10);
+        }
+        seastar::memory::set_heap_profiling_sampling_rate(0);
+    }).get();
+
+    auto during = seastar::memory::sampled_heap_stats(sg);
+    auto sampled = during.sampled_allocations - before.sampled_allocations;
+    BOOST_REQUIRE_GT(sampled, 0);
+    BOOST_REQUIRE_EQUAL(during.live_bytes - before.live_bytes, sampled * 100);
+    BOOST_REQUIRE_EQUAL(during.allocated_bytes - before.allocated_bytes, sampled * 100);
+    for (auto& site : seastar::memory::sampled_memory_profile()) {
+        BOOST_REQUIRE_EQUAL(site.scheduling_group_index, internal::scheduling_group_index(sg));
+    }
+
+    seastar::memory::set_heap_profiling_sampling_rate(100);
+    for (auto ptr : ptrs) {
+        free((void*)ptr);
+    }
+    seastar::memory::set_heap_profiling_sampling_rate(0);
+
+    auto after = seastar::memory::sampled_heap_stats(sg);
+    BOOST_REQUIRE_EQUAL(after.live_bytes, before.live_bytes);
+}
 
 #endif // SEASTAR_HEAPPROF
 
@@ -682,3 +744,44 @@ SEASTAR_TEST_CASE(test_large_allocation_warning_off_by_one) {
 #endif
     return make_ready_future<>();
 }
+
+SEASTAR_TEST_CASE(test_large_span_cache_reuse) {
+#ifndef SEASTAR_DEFAULT_ALLOCATOR
+    auto old_limit = memory::large_span_cache_size();
+    memory::set_large_span_cache_size(16 << 20);
+    auto free_before = memory::free_memory();
+
+    // A freed 128k buffer is cached and handed out again to the next
+    // allocation of the same size; cached memory still counts as free.
+    auto p1 = malloc(128 * 1024);
+    free(p1);
+    BOOST_REQUIRE_EQUAL(memory::free_memory(), free_before);
+    auto p2 = malloc(128 * 1024 - 100);
+    BOOST_REQUIRE_EQUAL(p1, p2);
+    free(p2);
+
+    // Disabling the cache returns everything to the page allocator.
+    memory::set_large_span_cache_size(0);
+    BOOST_REQUIRE_EQUAL(memory::large_span_cache_size(), 0);
+    BOOST_REQUIRE_EQUAL(memory::free_memory(), free_before);
+    memory::set_large_span_cache_size(old_limit);
+#endif
+    return make_ready_future<>();
+}
+
+SEASTAR_TEST_CASE(test_size_class_tuning) {
+#ifndef SEASTAR_DEFAULT_ALLOCATOR
+    std::vector<std::unique_ptr<char[]>> objs;
+    for (int i = 0; i < 100000; i++) {
+        objs.emplace_back(new char[200]);
+    }
+    auto tuning = memory::profile_size_classes();
+    auto it = std::find_if(tuning.begin(), tuning.end(), [] (const memory::size_class_tuning& t) {
+        return t.object_size >= 200 && t.object_size < 256;
+    });
+    BOOST_REQUIRE(it != tuning.end());
+    BOOST_REQUIRE_GE(it->max_free, 100000 / 8);
+    memory::tune_size_classes(tuning);
+#endif
+    return make_ready_future<>();
+}
@@ -66,9 +66,10 @@ class test_env {
     unsigned _nr_groups = 0;
     std::vector<request> _inflight;
 
-    static fair_queue::config fq_config() {
+    static fair_queue::config fq_config(fair_queue::config::class_selection sel) {
         fair_queue::config cfg;
         cfg.forgiving_factor = 50 * test_weight_scale;
+        cfg.selection = sel;
         return cfg;
     }
 
@@ -76,8 +77,8 @@ class test_env {
         do {} while (tick() != 0);
     }
 public:
-    test_env()
-        : _fq(fq_config())
+    test_env(fair_queue::config::class_selection sel = fair_queue::config::class_selection::heap)
+        : _fq(fq_config(sel))
     {
     }
 
@@ -294,6 +295,30 @@ SEASTAR_THREAD_TEST_CASE(test_fair_queue_different_weights) {
     env.verify("different_weights_more", {1, 2});
 }
 
+// Same as above, but with many classes and O(1) class selection
+SEASTAR_THREAD_TEST_CASE(test_fair_queue_calendar_shares_and_weights) {
+    test_env env(fair_queue::config::class_selection::calendar);
+
+    constexpr unsigned nr_classes = 1000;
+    for (unsigned c = 0; c < nr_classes; c++) {
+        env.register_priority_class(c % 2 == 0 ? 10 : 20);
+    }
+    for (int i = 0; i < 40; ++i) {
+        for (unsigned c = 0; c < nr_classes; c++) {
+            env.do_op(c, c % 4 < 2 ? 2 : 1);
+        }
+    }
+    yield().get();
+    env.tick(10 * nr_classes);
+    std::vector<unsigned> ratios;
+    for (unsigned c = 0; c < nr_classes; c++) {
+        // shares 10:20:10:20, weights 2:2:1:1
+        static constexpr unsigned r[] = { 1, 2, 2, 4 };
+        ratios.push_back(r[c % 4]);
+    }
+    env.verify("calendar_shares_and_weights", std::move(ratios));
+}
+
 // Class2 pushes many requests over. Right after, don't expect Class2 to be able to push anything else.
 SEASTAR_THREAD_TEST_CASE(test_fair_queue_dominant_queue) {
     test_env env;
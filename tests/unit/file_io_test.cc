@@ -32,6 +32,10 @@
 #include <seastar/core/condition-variable.hh>
 #include <seastar/core/file.hh>
 #include <seastar/core/layered_file.hh>
+#include <seastar/core/caching_file.hh>
+#include <seastar/core/append_log.hh>
+#include <seastar/core/file_copy.hh>
+#include <seastar/core/loop.hh>
 #include <seastar/core/thread.hh>
 #include <seastar/core/stall_sampler.hh>
 #include <seastar/core/aligned_buffer.hh>
@@ -44,6 +48,7 @@
 #include <seastar/util/internal/iovec_utils.hh>
 
 #include <boost/range/adaptor/transformed.hpp>
+#include <boost/range/irange.hpp>
 #include <iostream>
 #include <sys/statfs.h>
 #include <fcntl.h>
@@ -649,6 +654,240 @@ SEASTAR_TEST_CASE(test_underlying_file) {
     });
 }
 
+SEASTAR_TEST_CASE(test_caching_file) {
+    return tmp_dir::do_with_thread([] (tmp_dir& t) {
+        sstring filename = (t.get_path() / "testfile.tmp").native();
+        auto f = open_file_dma(filename, open_flags::rw | open_flags::create).get();
+        auto close_f = deferred_close(f);
+        constexpr size_t block_size = 4096;
+        constexpr size_t file_size = 4 * block_size;
+        auto wbuf = temporary_buffer<char>::aligned(f.memory_dma_alignment(), file_size);
+        for (size_t i = 0; i < file_size; i++) {
+            wbuf.get_write()[i] = char(i % 251);
+        }
+        f.dma_write(0, wbuf.get(), file_size).get();
+        // Leave a short last block
+        f.truncate(file_size - 100).get();
+
+        file_block_cache cache(file_block_cache::config{ .block_size = block_size, .max_size = 3 * block_size });
+        auto cf = make_caching_file(f, cache);
+
+        auto check = [&] (uint64_t pos, size_t len, size_t expected) {
+            std::vector<char> rbuf(len);
+            auto n = cf.dma_read(pos, rbuf.data(), len).get();
+            BOOST_REQUIRE_EQUAL(n, expected);
+            for (size_t i = 0; i < n; i++) {
+                BOOST_REQUIRE_EQUAL(rbuf[i], char((pos + i) % 251));
+            }
+        };
+
+        // Unaligned, spanning two blocks
+        check(100, block_size, block_size);
+        BOOST_REQUIRE_EQUAL(cache.get_stats().misses, 2);
+        check(block_size + 1, 10, 10);
+        BOOST_REQUIRE_EQUAL(cache.get_stats().hits, 1);
+
+        // Concurrent misses of the same block share one read
+        auto f1 = cf.dma_read_bulk<char>(2 * block_size, 512);
+        auto f2 = cf.dma_read_bulk<char>(2 * block_size + 512, 512);
+        auto b1 = f1.get();
+        auto b2 = f2.get();
+        BOOST_REQUIRE_EQUAL(b1.size(), 512);
+        BOOST_REQUIRE_EQUAL(b2.size(), 512);
+        BOOST_REQUIRE_EQUAL(b2[0], char((2 * block_size + 512) % 251));
+        BOOST_REQUIRE_EQUAL(cache.get_stats().misses, 3);
+        BOOST_REQUIRE_EQUAL(cache.get_stats().coalesced_misses, 1);
+        // The buffers are the callers', writing to them leaves the cache alone
+        b1.get_write()[0] = ~b1[0];
+        BOOST_REQUIRE_EQUAL(cf.dma_read_bulk<char>(2 * block_size, 1).get()[0], char((2 * block_size) % 251));
+
+        // Reads are cut at the end of file, and over the size limit the
+        // least recently used block goes away
+        check(file_size - 200, 200, 100);
+        BOOST_REQUIRE_EQUAL(cache.get_stats().evictions, 1);
+        BOOST_REQUIRE_LE(cache.memory_used(), 3 * block_size);
+
+        // Writes through the caching file drop the stale blocks
+        auto zeros = temporary_buffer<char>::aligned(f.memory_dma_alignment(), block_size);
+        std::memset(zeros.get_write(), 0, block_size);
+        cf.dma_write(2 * block_size, zeros.get(), block_size).get();
+        auto b3 = cf.dma_read_bulk<char>(2 * block_size, 16).get();
+        BOOST_REQUIRE_EQUAL(b3[0], 0);
+
+        file_block_cache unaligned_cache(file_block_cache::config{ .block_size = 1000 });
+        BOOST_REQUIRE_THROW(make_caching_file(f, unaligned_cache), std::invalid_argument);
+
+        // Closing waits for the block reads in flight, which don't get cached
+        cache.clear();
+        auto cf2 = make_caching_file(open_file_dma(filename, open_flags::ro).get(), cache);
+        auto pending = cf2.dma_read_bulk<char>(0, 16);
+        cf2.close().get();
+        BOOST_REQUIRE_EQUAL(pending.get()[0], char(0));
+        BOOST_REQUIRE_EQUAL(cache.memory_used(), 0);
+    });
+}
+
+// Counts the writes, and cuts them short once `short_writes` is set
+class write_counting_file : public layered_file_impl {
+public:
+    unsigned writes = 0;
+    bool short_writes = false;
+
+    explicit write_counting_file(file f) : layered_file_impl(std::move(f)) {}
+    virtual future<size_t> write_dma(uint64_t pos, const void* buffer, size_t len, io_intent* intent) override {
+        writes++;
+        if (short_writes) {
+            return make_ready_future<size_t>(0);
+        }
+        return _underlying_file.dma_write(pos, static_cast<const char*>(buffer), len, intent);
+    }
+    virtual future<size_t> write_dma(uint64_t pos, std::vector<iovec> iov, io_intent*) override {
+        abort();
+    }
+    virtual future<size_t> read_dma(uint64_t pos, void* buffer, size_t len, io_intent* intent) override {
+        return _underlying_file.dma_read(pos, static_cast<char*>(buffer), len, intent);
+    }
+    virtual future<size_t> read_dma(uint64_t pos, std::vector<iovec> iov, io_intent* intent) override {
+        return _underlying_file.dma_read(pos, std::move(iov), intent);
+    }
+    virtual future<> flush(void) override {
+        return _underlying_file.flush();
+    }
+    virtual future<struct stat> stat(void) override {
+        return _underlying_file.stat();
+    }
+    virtual future<> truncate(uint64_t length) override {
+        return _underlying_file.truncate(length);
+    }
+    virtual future<> discard(uint64_t offset, uint64_t length) override {
+        return _underlying_file.discard(offset, length);
+    }
+    virtual future<> allocate(uint64_t position, uint64_t length) override {
+        return _underlying_file.allocate(position, length);
+    }
+    virtual future<uint64_t> size(void) override {
+        return _underlying_file.size();
+    }
+    virtual future<> close() override {
+        return _underlying_file.close();
+    }
+    virtual subscription<directory_entry> list_directory(std::function<future<> (directory_entry de)> next) override {
+        return _underlying_file.list_directory(std::move(next));
+    }
+    virtual future<temporary_buffer<uint8_t>> dma_read_bulk(uint64_t offset, size_t range_size, io_intent* intent) override {
+        return _underlying_file.dma_read_bulk<uint8_t>(offset, range_size, intent);
+    }
+};
+
+SEASTAR_TEST_CASE(test_append_log) {
+    return tmp_dir::do_with_thread([] (tmp_dir& t) {
+        sstring filename = (t.get_path() / "testfile.tmp").native();
+        auto record = [] (unsigned i) { return format("record-{:04d};", i); };
+        constexpr unsigned nr_records = 200;
+        const size_t record_size = record(0).size();
+
+        auto counting = make_shared<write_counting_file>(open_file_dma(filename, open_flags::rw | open_flags::create).get());
+        auto log = make_append_log(file(counting), 0, append_log_options{ .max_group_size = 1024 });
+        std::vector<uint64_t> offsets(nr_records);
+        parallel_for_each(boost::irange(0u, nr_records), [&] (unsigned i) {
+            return log.append(record(i)).then([&, i] (uint64_t offset) {
+                offsets[i] = offset;
+            });
+        }).get();
+        BOOST_REQUIRE_EQUAL(log.durable_size(), nr_records * record_size);
+        // Appends made while a group is being written are committed
+        // together, up to max_group_size bytes per write
+        BOOST_REQUIRE_GT(counting->writes, 1);
+        BOOST_REQUIRE_LE(counting->writes, nr_records / 10);
+        BOOST_REQUIRE_EQUAL(log.size(), log.durable_size());
+        log.close().get();
+
+        auto check = [&] (size_t expected_size) {
+            auto f = open_file_dma(filename, open_flags::ro).get();
+            auto close_f = deferred_close(f);
+            BOOST_REQUIRE_EQUAL(f.size().get(), expected_size);
+            auto buf = f.dma_read_exactly<char>(0, expected_size).get();
+            for (unsigned i = 0; i < nr_records; i++) {
+                BOOST_REQUIRE_EQUAL(std::string_view(buf.get() + offsets[i], record_size), record(i));
+            }
+            return buf;
+        };
+        check(nr_records * record_size);
+
+        // Reopened logs continue after the unaligned end without
+        // damaging the last block
+        log = make_append_log(open_file_dma(filename, open_flags::rw).get(), nr_records * record_size);
+        BOOST_REQUIRE_EQUAL(log.append(std::string_view("end")).get(), nr_records * record_size);
+        log.close().get();
+        auto buf = check(nr_records * record_size + 3);
+        BOOST_REQUIRE_EQUAL(std::string_view(buf.get() + nr_records * record_size, 3), "end");
+
+        // A write that makes no progress fails the log instead of being retried
+        counting = make_shared<write_counting_file>(open_file_dma(filename, open_flags::rw).get());
+        counting->short_writes = true;
+        log = make_append_log(file(counting), nr_records * record_size + 3);
+        BOOST_REQUIRE_THROW(log.append(std::string_view("lost")).get(), std::runtime_error);
+        BOOST_REQUIRE_EQUAL(counting->writes, 1);
+        BOOST_REQUIRE_THROW(log.append(std::string_view("lost")).get(), std::runtime_error);
+        log.close().get();
+        check(nr_records * record_size + 3);
+    });
+}
+
+SEASTAR_TEST_CASE(test_copy_and_checksum_file) {
+    return tmp_dir::do_with_thread([] (tmp_dir& t) {
+        auto path = [&] (const char* name) { return (t.get_path() / name).native(); };
+        auto read_all = [] (sstring name) {
+            auto f = open_file_dma(name, open_flags::ro).get();
+            auto close_f = deferred_close(f);
+            return f.dma_read_exactly<char>(0, f.size().get()).get();
+        };
+
+        {
+            auto f = open_file_dma(path("check"), open_flags::rw | open_flags::create).get();
+            auto close_f = deferred_close(f);
+            auto buf = temporary_buffer<char>::aligned(f.memory_dma_alignment(), f.disk_write_dma_alignment());
+            std::memcpy(buf.get_write(), "123456789", 9);
+            f.dma_write(0, buf.get(), buf.size()).get();
+            f.truncate(9).get();
+            // The CRC32C check value
+            BOOST_REQUIRE_EQUAL(checksum_file(f).get(), 0xe3069283);
+        }
+
+        constexpr size_t size = (3 << 20) + 123;
+        {
+            auto f = open_file_dma(path("src"), open_flags::rw | open_flags::create).get();
+            auto close_f = deferred_close(f);
+            auto buf = temporary_buffer<char>::aligned(f.memory_dma_alignment(), align_up(size, size_t(f.disk_write_dma_alignment())));
+            for (size_t i = 0; i < buf.size(); i++) {
+                buf.get_write()[i] = char(i % 251);
+            }
+            f.dma_write(0, buf.get(), buf.size()).get();
+            f.truncate(size).get();
+        }
+        auto expected = read_all(path("src"));
+
+        for (bool kernel_copy : {false, true}) {
+            auto in = open_file_dma(path("src"), open_flags::ro).get();
+            auto out = open_file_dma(path("dst"), open_flags::rw | open_flags::create | open_flags::truncate).get();
+            auto close_in = deferred_close(in);
+            auto close_out = deferred_close(out);
+            uint64_t progress = 0;
+            file_copy_options options;
+            options.chunk_size = 256 << 10;
+            options.kernel_copy = kernel_copy;
+            options.progress = [&] (uint64_t done, uint64_t total) {
+                BOOST_REQUIRE_EQUAL(total, size);
+                progress = std::max(progress, done);
+            };
+            BOOST_REQUIRE_EQUAL(copy_file_contents(in, out, options).get(), size);
+            BOOST_REQUIRE_GE(progress, size);
+            BOOST_REQUIRE(read_all(path("dst")) == expected);
+            BOOST_REQUIRE_EQUAL(checksum_file(in, options).get(), checksum_file(out).get());
+        }
+    });
+}
+
 SEASTAR_TEST_CASE(test_file_stat_method_with_file) {
     return tmp_dir::do_with_thread([] (tmp_dir& t) {
         auto oflags = open_flags::rw | open_flags::create | open_flags::truncate;
@@ -28,6 +28,7 @@
 #include <seastar/core/app-template.hh>
 #include <seastar/core/do_with.hh>
 #include <seastar/core/seastar.hh>
+#include <seastar/core/reactor.hh>
 #include <seastar/core/semaphore.hh>
 #include <seastar/testing/random.hh>
 #include <seastar/testing/test_case.hh>
@@ -539,6 +540,59 @@ SEASTAR_TEST_CASE(test_fstream_slow_start) {
     });
 }
 
+SEASTAR_TEST_CASE(test_fstream_adaptive_read_ahead) {
+    return tmp_dir::do_with_thread([] (tmp_dir& t) {
+        static constexpr size_t block_size = 4096;
+        static constexpr size_t nr_blocks = 256;
+        static constexpr size_t stride = 4;
+        auto block_char = [] (size_t block) { return char(block % 251); };
+
+        auto filename = (t.get_path() / "testfile.tmp").native();
+        auto f = open_file_dma(filename, open_flags::rw | open_flags::create | open_flags::truncate).get();
+        auto w = writer::make(std::move(f)).get();
+        for (size_t b = 0; b < nr_blocks; b++) {
+            std::vector<char> vec(block_size, block_char(b));
+            w->out.write(vec.data(), vec.size()).get();
+        }
+        w->out.close().get();
+
+        file_input_stream_options options;
+        options.buffer_size = block_size;
+        options.read_ahead = 8;
+        options.adaptive_read_ahead = true;
+        f = open_file_dma(filename, open_flags::ro).get();
+        auto in = make_file_input_stream(std::move(f), options);
+        auto close_in = deferred_close(in);
+
+        auto check_block = [&] (size_t b) {
+            auto buf = in.read_exactly(block_size).get();
+            BOOST_REQUIRE_EQUAL(buf.size(), block_size);
+            BOOST_REQUIRE(std::all_of(buf.begin(), buf.end(), [&] (char c) { return c == block_char(b); }));
+        };
+
+        // Read one block out of every stride. Once the pattern is recognized
+        // only the records are read, so nothing is read ahead in vain.
+        auto& stats = engine().get_io_stats();
+        uint64_t discarded_after_warmup = 0;
+        size_t b = 0;
+        for (; b < nr_blocks / 2; b += stride) {
+            check_block(b);
+            in.skip((stride - 1) * block_size).get();
+            if (b == 4 * stride) {
+                discarded_after_warmup = stats.fstream_read_ahead_discarded_bytes;
+            }
+        }
+        BOOST_REQUIRE_EQUAL(stats.fstream_read_ahead_discarded_bytes, discarded_after_warmup);
+
+        // The consumer stops skipping, the stream has to fall back to
+        // sequential reads without losing data
+        for (; b < nr_blocks; b++) {
+            check_block(b);
+        }
+        BOOST_REQUIRE(in.read().get().empty());
+    });
+}
+
 #ifdef SEASTAR_ENABLE_ALLOC_FAILURE_INJECTION
 
 SEASTAR_TEST_CASE(test_close_error) {
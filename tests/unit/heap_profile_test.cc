@@ -0,0 +1,202 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2026 ScyllaDB
+ */
+
+#include <seastar/testing/test_case.hh>
+#include <seastar/testing/thread_test_case.hh>
+
+#include <seastar/core/heap_profile.hh>
+#include <seastar/core/memory.hh>
+#include <seastar/core/scheduling.hh>
+#include <seastar/core/thread.hh>
+#include <seastar/core/vector-data-sink.hh>
+#include <seastar/core/with_scheduling_group.hh>
+#include <seastar/http/client.hh>
+#include <seastar/http/httpd.hh>
+#include <seastar/util/defer.hh>
+#include <seastar/util/short_streams.hh>
+#include "loopback_socket.hh"
+
+#include <fmt/format.h>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace seastar;
+
+namespace {
+
+#if defined(SEASTAR_HEAPPROF) && !defined(SEASTAR_DEFAULT_ALLOCATOR)
+constexpr bool heap_profiling = true;
+#else
+constexpr bool heap_profiling = false;
+#endif
+
+[[gnu::noinline]]
+char* sampled_alloc(size_t size) {
+    auto ret = static_cast<char*>(malloc(size));
+    *ret = 'c'; // to prevent compiler from considering this a dead allocation and optimizing it out
+    return ret;
+}
+
+// Allocations sampled at a rate that catches about all of them
+class sampled_allocations {
+    std::vector<char*> _ptrs;
+public:
+    sampled_allocations() : _ptrs(100) {
+        memory::set_heap_profiling_sampling_rate(100);
+        for (auto& ptr : _ptrs) {
+            ptr = sampled_alloc(1000);
+        }
+        memory::set_heap_profiling_sampling_rate(0);
+    }
+    ~sampled_allocations() {
+        memory::set_heap_profiling_sampling_rate(100);
+        for (auto ptr : _ptrs) {
+            free(ptr);
+        }
+        memory::set_heap_profiling_sampling_rate(0);
+    }
+};
+
+// What the profile has after the counts of the site
+std::string site_frames(const memory::allocation_site& site) {
+    std::string frames = "@";
+    for (auto& f : site.backtrace.frames()) {
+        frames += fmt::format(" {:#x}", f.so->begin + f.addr);
+    }
+    return frames + "\n";
+}
+
+class loopback_http_factory : public http::experimental::connection_factory {
+    loopback_socket_impl lsi;
+public:
+    explicit loopback_http_factory(loopback_connection_factory& f) : lsi(f) {}
+    virtual future<connected_socket> make(abort_source* as) override {
+        return lsi.connect(socket_address(ipv4_addr()), socket_address(ipv4_addr()));
+    }
+};
+
+// Runs the requests against a server with the heap profile route
+void with_heap_profile_server(std::function<void (http::experimental::client&)> func) {
+    loopback_connection_factory lcf(1);
+    httpd::http_server server("test");
+    httpd::http_server_tester::listeners(server).emplace_back(lcf.get_server_socket());
+    heap_profile::add_heap_profile_routes(server).get();
+    server.do_accepts(0).get();
+    auto stop_server = defer([&server] () noexcept { server.stop().get(); });
+
+    auto cln = http::experimental::client(std::make_unique<loopback_http_factory>(lcf));
+    auto close_client = defer([&cln] () noexcept { cln.close().get(); });
+    func(cln);
+}
+
+std::pair<http::reply::status_type, std::string> get(http::experimental::client& cln, sstring url) {
+    auto req = http::request::make("GET", "test", std::move(url));
+    http::reply::status_type status;
+    std::string body;
+    cln.make_request(std::move(req), [&] (const http::reply& rep, input_stream<char>&& in) {
+        status = rep._status;
+        return do_with(std::move(in), [&body] (input_stream<char>& in) {
+            return util::read_entire_stream_contiguous(in).then([&body] (sstring s) {
+                body = std::string(s);
+            });
+        });
+    }).get();
+    return {status, std::move(body)};
+}
+
+}
+
+SEASTAR_THREAD_TEST_CASE(test_write_pprof) {
+    if (!heap_profiling) {
+        BOOST_TEST_WARN(0, "Skipping this test because heap profiling is not compiled in");
+        return;
+    }
+    sampled_allocations allocs;
+    auto sites = memory::sampled_memory_profile();
+    BOOST_REQUIRE(!sites.empty());
+
+    std::vector<net::packet> packets;
+    output_stream<char> out(data_sink(std::make_unique<vector_data_sink>(packets)), 4096);
+    heap_profile::write_pprof(sites, out).get();
+    out.close().get();
+    std::string profile;
+    for (auto& p : packets) {
+        for (auto& f : p.fragments()) {
+            profile.append(f.base, f.size);
+        }
+    }
+
+    size_t total_count = 0;
+    size_t total_size = 0;
+    for (auto& site : sites) {
+        BOOST_REQUIRE_GT(site.count, 0);
+        BOOST_REQUIRE(!site.backtrace.frames().empty());
+        auto line = fmt::format("\n{}: {} [{}: {}] {}", site.count, site.size, site.count, site.size, site_frames(site));
+        BOOST_REQUIRE_NE(profile.find(line), std::string::npos);
+        total_count += site.count;
+        total_size += site.size;
+    }
+    auto header = fmt::format("heap profile: {}: {} [{}: {}] @ heapprofile\n", total_count, total_size, total_count, total_size);
+    BOOST_REQUIRE(profile.starts_with(header));
+    // pprof symbolizes the addresses with the memory map
+    BOOST_REQUIRE_NE(profile.find("\nMAPPED_LIBRARIES:\n"), std::string::npos);
+    BOOST_REQUIRE_NE(profile.find("[stack]"), std::string::npos);
+}
+
+SEASTAR_THREAD_TEST_CASE(test_heap_profile_route) {
+    if (!heap_profiling) {
+        BOOST_TEST_WARN(0, "Skipping this test because heap profiling is not compiled in");
+        return;
+    }
+    auto sg = create_scheduling_group("heapprof_route", 100).get();
+    auto destroy_sg = defer([sg] () noexcept { destroy_scheduling_group(sg).get(); });
+    std::optional<sampled_allocations> allocs;
+    with_scheduling_group(sg, [&allocs] {
+        allocs.emplace();
+    }).get();
+    std::vector<std::string> frames;
+    for (auto& site : memory::sampled_memory_profile()) {
+        if (site.scheduling_group_index == internal::scheduling_group_index(sg)) {
+            frames.push_back(site_frames(site));
+        }
+    }
+    BOOST_REQUIRE(!frames.empty());
+
+    with_heap_profile_server([&] (http::experimental::client& cln) {
+        for (auto url : {"/debug/pprof/heap", "/debug/pprof/heap?shard=0", "/debug/pprof/heap?group=heapprof_route"}) {
+            auto [status, profile] = get(cln, url);
+            BOOST_REQUIRE_EQUAL(status, http::reply::status_type::ok);
+            BOOST_REQUIRE(profile.starts_with("heap profile: "));
+            for (auto& f : frames) {
+                BOOST_REQUIRE_NE(profile.find(f), std::string::npos);
+            }
+        }
+
+        auto [status, profile] = get(cln, "/debug/pprof/heap?group=no_such_group");
+        BOOST_REQUIRE_EQUAL(status, http::reply::status_type::ok);
+        BOOST_REQUIRE(profile.starts_with("heap profile: 0: 0 [0: 0] @ heapprofile\n"));
+
+        BOOST_REQUIRE_EQUAL(get(cln, fmt::format("/debug/pprof/heap?shard={}", smp::count)).first, http::reply::status_type::bad_request);
+        BOOST_REQUIRE_EQUAL(get(cln, "/debug/pprof/heap?shard=x").first, http::reply::status_type::bad_request);
+    });
+}
@@ -33,6 +33,7 @@
 #include <seastar/core/file.hh>
 #include <seastar/core/io_queue.hh>
 #include <seastar/core/io_intent.hh>
+#include <seastar/core/timed_out_error.hh>
 #include <seastar/core/disk_params.hh>
 #include <seastar/core/internal/io_request.hh>
 #include <seastar/core/internal/io_sink.hh>
@@ -118,6 +119,10 @@ struct io_queue_for_tests {
     bool is_class_registered(internal::priority_class pc) const noexcept {
         return queue._priority_classes.size() > pc.id() && (queue._priority_classes[pc.id()] != nullptr);
     }
+
+    void adapt_cost_model(const internal::io_cost_model_stats& st) {
+        group->adapt_cost_model(st);
+    }
 };
 
 internal::priority_class get_default_pc() {
@@ -144,6 +149,108 @@ SEASTAR_THREAD_TEST_CASE(test_basic_flow) {
     f.get();
 }
 
+static io_queue::config merging_config() {
+    io_queue::config cfg{0};
+    cfg.merge_reads = true;
+    return cfg;
+}
+
+SEASTAR_THREAD_TEST_CASE(test_adjacent_reads_merge) {
+    io_queue_for_tests tio(merging_config());
+    char buf[3][512];
+    auto read_dnl = internal::io_direction_and_length(internal::io_direction_and_length::read_idx, sizeof(buf[0]));
+
+    std::vector<future<size_t>> futs;
+    for (unsigned i = 0; i < 3; i++) {
+        futs.push_back(tio.queue_request(get_default_pc(), read_dnl, internal::io_request::make_read(0, i * sizeof(buf[0]), buf[i], sizeof(buf[0]), false), nullptr, {}));
+    }
+    // Not adjacent to any of the above
+    futs.push_back(tio.queue_request(get_default_pc(), read_dnl, internal::io_request::make_read(0, 8192, buf[0], sizeof(buf[0]), false), nullptr, {}));
+
+    seastar::sleep(std::chrono::milliseconds(500)).get();
+    tio.queue.poll_io_queue();
+    std::vector<internal::io_request::operation> ops;
+    tio.sink.drain([&] (const internal::io_request& rq, io_completion* desc) -> bool {
+        ops.push_back(rq.opcode());
+        if (rq.opcode() == internal::io_request::operation::readv) {
+            const auto& op = rq.as<internal::io_request::operation::readv>();
+            BOOST_REQUIRE_EQUAL(op.pos, 0);
+            BOOST_REQUIRE_EQUAL(op.iov_len, 3);
+            for (unsigned i = 0; i < 3; i++) {
+                BOOST_REQUIRE_EQUAL(op.iovec[i].iov_base, buf[i]);
+            }
+            // Short read, the last merged request gets only part of its data
+            desc->complete_with(2 * sizeof(buf[0]) + 100);
+        } else {
+            desc->complete_with(rq.as<internal::io_request::operation::read>().size);
+        }
+        return true;
+    });
+
+    BOOST_REQUIRE_EQUAL(ops.size(), 2);
+    BOOST_REQUIRE_EQUAL(futs[0].get(), sizeof(buf[0]));
+    BOOST_REQUIRE_EQUAL(futs[1].get(), sizeof(buf[0]));
+    BOOST_REQUIRE_EQUAL(futs[2].get(), 100);
+    BOOST_REQUIRE_EQUAL(futs[3].get(), sizeof(buf[0]));
+}
+
+SEASTAR_THREAD_TEST_CASE(test_adjacent_reads_no_merge_by_default) {
+    io_queue_for_tests tio;
+    char buf[2][512];
+    auto read_dnl = internal::io_direction_and_length(internal::io_direction_and_length::read_idx, sizeof(buf[0]));
+
+    std::vector<future<size_t>> futs;
+    for (unsigned i = 0; i < 2; i++) {
+        futs.push_back(tio.queue_request(get_default_pc(), read_dnl, internal::io_request::make_read(0, i * sizeof(buf[0]), buf[i], sizeof(buf[0]), false), nullptr, {}));
+    }
+
+    seastar::sleep(std::chrono::milliseconds(500)).get();
+    tio.queue.poll_io_queue();
+    auto drained = tio.sink.drain([&] (const internal::io_request& rq, io_completion* desc) -> bool {
+        BOOST_REQUIRE(rq.opcode() == internal::io_request::operation::read);
+        desc->complete_with(rq.as<internal::io_request::operation::read>().size);
+        return true;
+    });
+
+    BOOST_REQUIRE_EQUAL(drained, 2);
+    for (auto& f : futs) {
+        BOOST_REQUIRE_EQUAL(f.get(), sizeof(buf[0]));
+    }
+}
+
+SEASTAR_THREAD_TEST_CASE(test_merged_read_failure_retries_parts) {
+    io_queue_for_tests tio(merging_config());
+    char buf[3][512];
+    auto read_dnl = internal::io_direction_and_length(internal::io_direction_and_length::read_idx, sizeof(buf[0]));
+
+    std::vector<future<size_t>> futs;
+    for (unsigned i = 0; i < 3; i++) {
+        futs.push_back(tio.queue_request(get_default_pc(), read_dnl, internal::io_request::make_read(0, i * sizeof(buf[0]), buf[i], sizeof(buf[0]), false), nullptr, {}));
+    }
+
+    seastar::sleep(std::chrono::milliseconds(500)).get();
+    tio.queue.poll_io_queue();
+    std::vector<internal::io_request::operation> ops;
+    tio.sink.drain([&] (const internal::io_request& rq, io_completion* desc) -> bool {
+        ops.push_back(rq.opcode());
+        if (rq.opcode() == internal::io_request::operation::readv) {
+            desc->complete_with(-EIO);
+            return true;
+        }
+        // The parts come back one by one, only the middle one is bad
+        const auto& op = rq.as<internal::io_request::operation::read>();
+        BOOST_REQUIRE_EQUAL(op.addr, buf[op.pos / sizeof(buf[0])]);
+        desc->complete_with(op.pos == sizeof(buf[0]) ? -EIO : ssize_t(op.size));
+        return true;
+    });
+
+    BOOST_REQUIRE_EQUAL(ops.size(), 4);
+    BOOST_REQUIRE(ops[0] == internal::io_request::operation::readv);
+    BOOST_REQUIRE_EQUAL(futs[0].get(), sizeof(buf[0]));
+    BOOST_REQUIRE_THROW(futs[1].get(), std::system_error);
+    BOOST_REQUIRE_EQUAL(futs[2].get(), sizeof(buf[0]));
+}
+
 enum class part_flaw { none, partial, error };
 
 static void do_test_large_request_flow(part_flaw flaw) {
@@ -256,6 +363,41 @@ SEASTAR_THREAD_TEST_CASE(test_intent_safe_ref) {
     BOOST_REQUIRE(ref_empty_2.retrieve() == nullptr);
 }
 
+SEASTAR_THREAD_TEST_CASE(test_io_deadlines) {
+    io_queue_for_tests tio;
+    fake_file file;
+    auto now = io_intent::clock_type::now();
+
+    io_intent late(now + std::chrono::hours(2));
+    io_intent early(now + std::chrono::hours(1));
+    io_intent expired(now - std::chrono::seconds(1));
+    int vals[4] = { 0, 1, 2, 3 };
+    auto dnl = internal::io_direction_and_length(internal::io_direction_and_length::write_idx, 0);
+
+    // Queued in this order, the ones with deadlines are expected to be
+    // dispatched earliest deadline first, then the one without one
+    auto f0 = tio.queue_request(get_default_pc(), dnl, file.make_write_req(0, &vals[0]), nullptr, {});
+    auto f1 = tio.queue_request(get_default_pc(), dnl, file.make_write_req(1, &vals[1]), &late, {});
+    auto f2 = tio.queue_request(get_default_pc(), dnl, file.make_write_req(2, &vals[2]), &early, {});
+    auto f3 = tio.queue_request(get_default_pc(), dnl, file.make_write_req(3, &vals[3]), &expired, {});
+
+    seastar::sleep(std::chrono::milliseconds(500)).get();
+    tio.queue.poll_io_queue();
+    std::vector<int> order;
+    tio.sink.drain([&] (const internal::io_request& rq, io_completion* desc) -> bool {
+        order.push_back(*reinterpret_cast<int*>(rq.as<internal::io_request::operation::write>().addr));
+        file.execute_write_req(rq, desc);
+        return true;
+    });
+
+    BOOST_REQUIRE_EQUAL(order, (std::vector<int>{2, 1, 0}));
+    f0.get();
+    f1.get();
+    f2.get();
+    BOOST_REQUIRE_THROW(f3.get(), timed_out_error);
+    BOOST_REQUIRE(!file.data.contains(3));
+}
+
 static constexpr int nr_requests = 24;
 
 SEASTAR_THREAD_TEST_CASE(test_io_cancellation) {
@@ -542,6 +684,33 @@ SEASTAR_TEST_CASE(test_request_iovec_split) {
     return make_ready_future<>();
 }
 
+SEASTAR_THREAD_TEST_CASE(test_capacity_lending_threshold) {
+    io_throttler::config cfg;
+    cfg.capacity_lending = true;
+    io_throttler lending(cfg, 4);
+    auto limit = lending.maximum_capacity();
+    auto share = lending.per_tick_grab_threshold();
+    BOOST_REQUIRE_EQUAL(share, limit / 4);
+
+    // A lone backlogged queue may reserve the whole bucket, more
+    // backlogged queues split it until they are all back to their share
+    lending.on_backlog_start();
+    BOOST_REQUIRE_EQUAL(lending.lending_grab_threshold(), limit);
+    lending.on_backlog_start();
+    BOOST_REQUIRE_EQUAL(lending.lending_grab_threshold(), limit / 2);
+    lending.on_backlog_start();
+    lending.on_backlog_start();
+    BOOST_REQUIRE_EQUAL(lending.lending_grab_threshold(), share);
+    for (unsigned i = 0; i < 4; i++) {
+        lending.on_backlog_end();
+    }
+
+    cfg.capacity_lending = false;
+    io_throttler plain(cfg, 4);
+    plain.on_backlog_start();
+    BOOST_REQUIRE_EQUAL(plain.lending_grab_threshold(), plain.per_tick_grab_threshold());
+}
+
 SEASTAR_THREAD_TEST_CASE(test_tb_params) {
     internal::disk_config_params disk_config(1);
     internal::disk_params d;
@@ -592,6 +761,65 @@ SEASTAR_THREAD_TEST_CASE(test_tb_params) {
     }
 }
 
+SEASTAR_THREAD_TEST_CASE(test_adaptive_cost_model) {
+    internal::disk_config_params disk_config(1);
+    internal::disk_params d;
+    d.read_bytes_rate = 1ull << 30;
+    d.write_bytes_rate = 1ull << 30;
+    d.read_req_rate = 100000;
+    d.write_req_rate = 100000;
+    d.duplex = true;
+    auto io_config = disk_config.generate_config(d, 0, 1);
+    io_config.rate_limit_duration = std::chrono::milliseconds(1);
+    io_config.adaptive_cost_model = true;
+    io_queue_for_tests tio(io_config);
+
+    constexpr auto read = internal::io_direction_and_length::read_idx;
+    constexpr auto write = internal::io_direction_and_length::write_idx;
+    const auto& tb = internal::get_throttler(tio.queue, read).token_bucket();
+    const auto nominal_rate = tb.rate();
+    const auto read_cost = tio.queue.request_capacity(internal::io_direction_and_length(read, 4096));
+    const auto write_cost = tio.queue.request_capacity(internal::io_direction_and_length(write, 4096));
+    auto micro_tokens = [&] (unsigned idx, uint64_t nr) -> uint64_t {
+        return internal::request_tokens(internal::io_direction_and_length(idx, 4096), io_config) * 1e6 * nr;
+    };
+
+    // Too few completions to tell anything
+    internal::io_cost_model_stats st;
+    st.completed[read] = 4;
+    st.latency_ns[read] = 4ull * 10'000'000;
+    st.micro_tokens[read] = micro_tokens(read, 4);
+    tio.adapt_cost_model(st);
+    BOOST_REQUIRE_EQUAL(tio.group->rate_ratio(), 1.0);
+
+    // Requests take 4x the latency goal: back off, at most by half per step
+    st.completed[read] = 1000;
+    st.latency_ns[read] = 1000ull * 4'000'000;
+    st.micro_tokens[read] = micro_tokens(read, 1000);
+    tio.adapt_cost_model(st);
+    BOOST_REQUIRE_EQUAL(tio.group->rate_ratio(), 0.5);
+    BOOST_REQUIRE_LT(tb.rate(), nominal_rate);
+
+    // Held back by the model with plenty of latency headroom: speed up again
+    st.latency_ns[read] = 1000ull * 100'000;
+    st.throttled = 10;
+    tio.adapt_cost_model(st);
+    BOOST_REQUIRE_GT(tio.group->rate_ratio(), 0.5);
+
+    // Writes are twice as slow per predicted token as reads: they get more expensive
+    st.completed[write] = 1000;
+    st.latency_ns[write] = 2 * st.latency_ns[read];
+    st.micro_tokens[write] = micro_tokens(write, 1000);
+    st.throttled = 0;
+    for (int i = 0; i < 10; i++) {
+        tio.adapt_cost_model(st);
+    }
+    BOOST_REQUIRE_GT(tio.group->cost_factor(write), 1.0);
+    BOOST_REQUIRE_LT(tio.group->cost_factor(read), 1.0);
+    BOOST_REQUIRE_GT(tio.queue.request_capacity(internal::io_direction_and_length(write, 4096)), write_cost);
+    BOOST_REQUIRE_LT(tio.queue.request_capacity(internal::io_direction_and_length(read, 4096)), read_cost);
+}
+
 SEASTAR_THREAD_TEST_CASE(test_unconfigured_io_queue) {
     io_queue_for_tests tio;
 
@@ -23,6 +23,13 @@
 #include <seastar/core/smp.hh>
 #include <seastar/core/app-template.hh>
 #include <seastar/core/print.hh>
+#include <seastar/core/when_all.hh>
+#include <seastar/core/do_with.hh>
+#include <seastar/core/metrics_api.hh>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <semaphore>
 
 using namespace seastar;
 
@@ -58,6 +65,63 @@ future<bool> test_smp_exception() {
     });
 }
 
+future<bool> test_smp_submit_anywhere() {
+    return do_with(std::vector<future<uint64_t>>(), [] (std::vector<future<uint64_t>>& futs) {
+        for (uint64_t i = 0; i < 1000; i++) {
+            futs.push_back(smp::submit_anywhere(current_scheduling_group(), [i] () noexcept {
+                uint64_t sum = 0;
+                for (uint64_t j = 0; j <= i; j++) {
+                    sum += j;
+                }
+                return sum;
+            }));
+        }
+        return when_all_succeed(futs.begin(), futs.end()).then([] (std::vector<uint64_t> sums) {
+            for (uint64_t i = 0; i < sums.size(); i++) {
+                if (sums[i] != i * (i + 1) / 2) {
+                    return make_ready_future<bool>(false);
+                }
+            }
+            return make_ready_future<bool>(true);
+        });
+    });
+}
+
+uint64_t stolen_tasks() {
+    const auto& values = seastar::metrics::impl::get_value_map();
+    auto mf = values.find("smp_stealable_tasks_stolen");
+    if (mf == values.end() || mf->second.empty()) {
+        return 0;
+    }
+    return mf->second.begin()->second->get_function()().ui();
+}
+
+// While this shard is too busy to run its queued items, its siblings steal them
+future<bool> test_smp_submit_anywhere_steals() {
+    if (smp::count < 2) {
+        return make_ready_future<bool>(true);
+    }
+    auto stolen_before = stolen_tasks();
+    auto origin = this_shard_id();
+    auto stolen = std::make_unique<std::counting_semaphore<>>(0);
+    std::vector<future<unsigned>> futs;
+    for (unsigned i = 0; i < 64; i++) {
+        futs.push_back(smp::submit_anywhere(current_scheduling_group(), [origin, stolen = stolen.get()] () noexcept {
+            if (this_shard_id() != origin) {
+                stolen->release();
+            }
+            return this_shard_id();
+        }));
+    }
+    // Block the reactor so that it can't run its own items, only a sibling
+    // can let it go. The timeout only keeps a broken build from hanging.
+    auto signaled = stolen->try_acquire_for(std::chrono::seconds(30));
+    return when_all_succeed(futs.begin(), futs.end()).then([signaled, origin, stolen_before, stolen = std::move(stolen)] (std::vector<unsigned> shards) {
+        auto elsewhere = std::ranges::count_if(shards, [origin] (unsigned shard) { return shard != origin; });
+        return make_ready_future<bool>(signaled && elsewhere > 0 && stolen_tasks() >= stolen_before + elsewhere);
+    });
+}
+
 int tests, fails;
 
 future<>
@@ -73,6 +137,10 @@ int main(int ac, char** av) {
     return app_template().run_deprecated(ac, av, [] {
        return report("smp call", test_smp_call()).then([] {
            return report("smp exception", test_smp_exception());
+       }).then([] {
+           return report("smp submit anywhere", test_smp_submit_anywhere());
+       }).then([] {
+           return report("smp submit anywhere steals", test_smp_submit_anywhere_steals());
        }).then([] {
            fmt::print("\n{:d} tests / {:d} failures\n", tests, fails);
            engine().exit(fails ? 1 : 0);
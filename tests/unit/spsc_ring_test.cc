@@ -0,0 +1,100 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2026 ScyllaDB
+ */
+
+#define BOOST_TEST_MODULE core
+
+#include <boost/test/unit_test.hpp>
+#include <thread>
+#include <vector>
+
+#include <seastar/core/internal/spsc_ring.hh>
+
+using namespace seastar;
+
+BOOST_AUTO_TEST_CASE(test_capacity_is_rounded_up) {
+    internal::spsc_ring<int> ring(100);
+    BOOST_REQUIRE_EQUAL(ring.capacity(), 128);
+}
+
+BOOST_AUTO_TEST_CASE(test_push_pop_wraparound) {
+    internal::spsc_ring<int> ring(8);
+    BOOST_REQUIRE(ring.empty());
+    BOOST_REQUIRE(ring.drained());
+
+    int next_push = 0;
+    int next_pop = 0;
+    for (int round = 0; round < 10; ++round) {
+        std::vector<int> batch;
+        for (int i = 0; i < 11; ++i) {
+            batch.push_back(next_push + i);
+        }
+        // only 8 fit
+        auto it = ring.push(batch.begin(), batch.end());
+        BOOST_REQUIRE_EQUAL(it - batch.begin(), 8);
+        BOOST_REQUIRE(!ring.push(42));
+        next_push += 8;
+        BOOST_REQUIRE(!ring.empty());
+        BOOST_REQUIRE(!ring.drained());
+
+        int out[5];
+        auto nr = ring.pop(out, 5);
+        BOOST_REQUIRE_EQUAL(nr, 5);
+        for (int i = 0; i < 5; ++i) {
+            BOOST_REQUIRE_EQUAL(out[i], next_pop++);
+        }
+        auto consumed = ring.consume_all([&] (int v) {
+            BOOST_REQUIRE_EQUAL(v, next_pop++);
+        });
+        BOOST_REQUIRE_EQUAL(consumed, 3);
+        BOOST_REQUIRE(ring.empty());
+        BOOST_REQUIRE(ring.drained());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_concurrent_producer_consumer) {
+    internal::spsc_ring<unsigned> ring(16);
+    constexpr unsigned count = 100000;
+
+    std::thread producer([&ring] {
+        unsigned next = 0;
+        while (next < count) {
+            if (ring.push(next)) {
+                ++next;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    unsigned expected = 0;
+    unsigned buf[7];
+    while (expected < count) {
+        auto nr = ring.pop(buf, std::size(buf));
+        if (!nr) {
+            std::this_thread::yield();
+        }
+        for (size_t i = 0; i < nr; ++i) {
+            BOOST_REQUIRE_EQUAL(buf[i], expected++);
+        }
+    }
+    producer.join();
+    BOOST_REQUIRE(ring.empty());
+}
@@ -0,0 +1,277 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2026 ScyllaDB
+ */
+
+#include <seastar/testing/test_case.hh>
+#include <seastar/testing/thread_test_case.hh>
+
+#include <seastar/core/internal/poll.hh>
+#include <seastar/core/sleep.hh>
+#include <seastar/net/tcp.hh>
+#include <seastar/net/tcp-congestion.hh>
+
+#include <chrono>
+#include <deque>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+using namespace seastar;
+using namespace net;
+using namespace std::chrono_literals;
+
+namespace {
+
+class emulated_link;
+
+// Plugs tcp<> into the link below instead of an ipv4 stack: both ends of
+// the connections live in the same tcp<> and talk to its own address
+struct link_traits {
+    using address_type = ipv4_address;
+    using inet_type = emulated_link;
+    using l4packet = ipv4_traits::l4packet;
+    using packet_provider_type = ipv4_traits::packet_provider_type;
+    static void tcp_pseudo_header_checksum(checksummer& csum, ipv4_address src, ipv4_address dst, uint16_t len) {
+        ipv4_traits::tcp_pseudo_header_checksum(csum, src, dst, len);
+    }
+    static constexpr uint8_t ip_hdr_len_min = ipv4_traits::ip_hdr_len_min;
+};
+
+// Delays every segment and drops some of the ones carrying data
+class emulated_link {
+    struct interface {
+        struct device {
+            unsigned hash2cpu(uint32_t) {
+                return this_shard_id();
+            }
+            rss_key_type rss_key() const {
+                return default_rsskey_40bytes;
+            }
+        } _dev;
+        net::hw_features _hw_features;
+        ipv4_address _addr;
+
+        const net::hw_features& hw_features() const {
+            return _hw_features;
+        }
+        ipv4_address host_address() const {
+            return _addr;
+        }
+        device* netif() {
+            return &_dev;
+        }
+    };
+    struct in_flight {
+        std::chrono::steady_clock::time_point deliver_at;
+        packet p;
+    };
+
+    std::chrono::microseconds _delay;
+    double _loss;
+    std::mt19937 _rng{0x5eed};
+    std::deque<in_flight> _wire;
+    link_traits::packet_provider_type _provider;
+    internal::poller _poller;
+    // End of the highest data sent from each port
+    std::unordered_map<uint16_t, net::tcp_seq> _sent_end;
+public:
+    interface _inet;
+    size_t dropped = 0;
+    // FINs sent on segments that don't end the stream sent so far
+    size_t early_fins = 0;
+    // Last, so that the connections go before the link
+    std::unique_ptr<tcp<link_traits>> _tcp;
+
+    emulated_link(std::chrono::microseconds delay, double loss)
+        : _delay(delay)
+        , _loss(loss)
+        , _poller(internal::poller::simple([this] { return poll(); })) {
+        _inet._hw_features.rx_csum_offload = true;
+        _inet._hw_features.tx_csum_l4_offload = true;
+        _inet._addr = ipv4_address("10.0.0.1");
+        _tcp = std::make_unique<tcp<link_traits>>(*this);
+    }
+    void register_packet_provider(link_traits::packet_provider_type func) {
+        _provider = std::move(func);
+    }
+    future<ethernet_address> get_l2_dst_address(ipv4_address) {
+        return make_ready_future<ethernet_address>(ethernet_address{});
+    }
+private:
+    bool poll() {
+        bool work = false;
+        auto now = std::chrono::steady_clock::now();
+        while (auto l4p = _provider ? _provider() : std::nullopt) {
+            work = true;
+            auto& p = l4p->p;
+            auto h = tcp_hdr::read(p.get_header(0, tcp_hdr::len));
+            auto header_len = size_t(h.data_offset) * 4;
+            auto end = h.seq + int32_t(p.len() - header_len);
+            auto [it, first] = _sent_end.try_emplace(h.src_port, end);
+            if (!first && it->second < end) {
+                it->second = end;
+            }
+            if (h.f_fin && end < it->second) {
+                early_fins++;
+            }
+            if (p.len() > header_len && std::uniform_real_distribution<>(0, 1)(_rng) < _loss) {
+                dropped++;
+                continue;
+            }
+            // Copied, the sender keeps the data for retransmission
+            p.linearize();
+            auto f = p.frag(0);
+            _wire.push_back(in_flight{now + _delay, packet(f.base, f.size)});
+        }
+        while (!_wire.empty() && _wire.front().deliver_at <= now) {
+            work = true;
+            auto p = std::move(_wire.front().p);
+            _wire.pop_front();
+            _tcp->received(std::move(p), _inet._addr, _inet._addr);
+        }
+        return work;
+    }
+};
+
+sstring make_payload(size_t size) {
+    sstring data = uninitialized_string(size);
+    for (size_t i = 0; i < size; i++) {
+        data[i] = 'a' + i % 23;
+    }
+    return data;
+}
+
+// Returns the number of segments retransmitted in SACK based loss recovery
+uint64_t transfer(const char* congestion_control, bool sack, double loss) {
+    emulated_link link(1ms, loss);
+    auto& t = *link._tcp;
+    t.set_congestion_control(congestion_control);
+    t.set_sack(sack);
+
+    {
+        auto listener = t.listen(5000);
+        auto client = t.connect(socket_address(ipv4_addr("10.0.0.1", 5000)));
+        auto server = listener.accept().get();
+        client.connected().get();
+
+        auto payload = make_payload(512 * 1024);
+        for (size_t pos = 0; pos < payload.size(); pos += 64 * 1024) {
+            client.send(packet(payload.data() + pos, std::min(size_t(64 * 1024), payload.size() - pos))).get();
+        }
+        client.close_write();
+
+        sstring received;
+        for (;;) {
+            server.wait_for_data().get();
+            auto p = server.read();
+            if (!p.len()) {
+                break;
+            }
+            p.linearize();
+            received.append(p.frag(0).base, p.frag(0).size);
+        }
+        BOOST_REQUIRE_EQUAL(received.size(), payload.size());
+        BOOST_REQUIRE(received == payload);
+        if (loss > 0) {
+            BOOST_REQUIRE_GT(link.dropped, 0);
+        }
+        BOOST_REQUIRE_EQUAL(link.early_fins, 0);
+
+        server.close_write();
+        client.wait_input_shutdown().get();
+    }
+    // Let the last segments through before the link goes away
+    sleep(10ms).get();
+    return t.sack_retransmits();
+}
+
+}
+
+SEASTAR_THREAD_TEST_CASE(test_make_congestion_control) {
+    for (auto name : {"reno", "cubic", "bbr"}) {
+        BOOST_REQUIRE_EQUAL(std::string(make_tcp_congestion_control(name)->name()), name);
+    }
+    BOOST_REQUIRE_THROW(make_tcp_congestion_control("vegas"), std::invalid_argument);
+}
+
+SEASTAR_THREAD_TEST_CASE(test_loss_reduces_window) {
+    const uint32_t mss = 1000;
+    auto loss = [&] (const char* name) {
+        uint32_t cwnd = 100 * mss;
+        uint32_t ssthresh = 1000 * mss;
+        auto cc = make_tcp_congestion_control(name);
+        cc->on_loss(tcp_congestion_window{cwnd, ssthresh, mss}, cwnd);
+        return ssthresh;
+    };
+    BOOST_REQUIRE_EQUAL(loss("reno"), 50 * mss);
+    auto cubic = loss("cubic");
+    BOOST_REQUIRE(cubic >= 69 * mss && cubic <= 70 * mss);
+    // BBR keeps the window around the measured bandwidth-delay product
+    BOOST_REQUIRE_GE(loss("bbr"), 4 * mss);
+}
+
+SEASTAR_THREAD_TEST_CASE(test_slow_start) {
+    const uint32_t mss = 1000;
+    for (auto name : {"reno", "cubic"}) {
+        uint32_t cwnd = 2 * mss;
+        uint32_t ssthresh = 1000 * mss;
+        auto cc = make_tcp_congestion_control(name);
+        cc->on_ack(tcp_congestion_window{cwnd, ssthresh, mss}, tcp_ack_sample{mss, 0, 1ms, false});
+        BOOST_REQUIRE_EQUAL(cwnd, 3 * mss);
+    }
+}
+
+SEASTAR_THREAD_TEST_CASE(test_no_growth_in_recovery) {
+    const uint32_t mss = 1000;
+    for (auto name : {"reno", "cubic", "bbr"}) {
+        uint32_t cwnd = 10 * mss;
+        uint32_t ssthresh = 1000 * mss;
+        auto cc = make_tcp_congestion_control(name);
+        cc->on_ack(tcp_congestion_window{cwnd, ssthresh, mss}, tcp_ack_sample{mss, 5 * mss, 1ms, true});
+        BOOST_REQUIRE_EQUAL(cwnd, 10 * mss);
+    }
+}
+
+SEASTAR_THREAD_TEST_CASE(test_transfer_without_loss) {
+    for (auto name : {"reno", "cubic", "bbr"}) {
+        transfer(name, true, 0);
+    }
+}
+
+SEASTAR_THREAD_TEST_CASE(test_transfer_with_loss) {
+    uint64_t sack_retransmits = 0;
+    for (auto name : {"reno", "cubic", "bbr"}) {
+        sack_retransmits += transfer(name, true, 0.01);
+        BOOST_REQUIRE_EQUAL(transfer(name, false, 0.01), 0);
+    }
+    // Some of the losses were repaired from the SACK scoreboard rather
+    // than by waiting for the retransmission timeout
+    BOOST_REQUIRE_GT(sack_retransmits, 0);
+}
+
+// The sender closes while most of the data is still in flight, so the
+// losses are repaired after the FIN is first sent. Retransmissions from
+// the middle of the window must not carry it.
+SEASTAR_THREAD_TEST_CASE(test_close_with_loss) {
+    for (auto sack : {true, false}) {
+        transfer("reno", sack, 0.05);
+    }
+}
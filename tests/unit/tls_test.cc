@@ -21,7 +21,9 @@
  */
 
 #include <ranges>
+#include <fstream>
 #include <iostream>
+#include <string>
 
 #include <seastar/core/do_with.hh>
 #include <seastar/core/sstring.hh>
@@ -30,6 +32,8 @@
 #include <seastar/core/memory.hh>
 #include <seastar/core/sharded.hh>
 #include <seastar/core/thread.hh>
+#include <seastar/core/sleep.hh>
+#include <seastar/core/metrics_api.hh>
 #include <seastar/core/gate.hh>
 #include <seastar/core/temporary_buffer.hh>
 #include <seastar/core/iostream.hh>
@@ -42,6 +46,7 @@
 #include <seastar/net/inet_address.hh>
 #include <seastar/testing/test_case.hh>
 #include <seastar/testing/thread_test_case.hh>
+#include <seastar/util/closeable.hh>
 #include <seastar/util/defer.hh>
 
 #include <boost/dll.hpp>
@@ -50,6 +55,9 @@
 #include "tmpdir.hh"
 
 #include <gnutls/gnutls.h>
+#if __has_include(<linux/tls.h>)
+#include <linux/tls.h>
+#endif
 
 #if 0
 
@@ -265,6 +273,159 @@ SEASTAR_TEST_CASE(test_alpn_client_server) {
     co_return;
 }
 
+static future<> tls_echo(connected_socket s, size_t size) {
+    auto in = s.input();
+    auto out = s.output();
+    auto buf = co_await in.read_exactly(size);
+    BOOST_REQUIRE_EQUAL(buf.size(), size);
+    co_await out.write(buf.get(), buf.size());
+    co_await out.flush();
+    co_await out.close();
+    co_await in.close();
+}
+
+static future<> tls_echo_server(server_socket& server, size_t size) {
+    auto s = co_await server.accept();
+    co_await tls_echo(std::move(s.connection), size);
+}
+
+static future<> tls_echo_client(::shared_ptr<tls::certificate_credentials> creds, socket_address addr, sstring msg, bool require_ktls = false) {
+    auto c = co_await tls::connect(std::move(creds), addr, tls::tls_options{ .server_name = "test.scylladb.org" });
+    auto in = c.input();
+    auto out = c.output();
+    co_await out.write(msg);
+    co_await out.flush();
+    auto buf = co_await in.read_exactly(msg.size());
+    BOOST_REQUIRE_EQUAL(sstring(buf.get(), buf.size()), msg);
+    auto uses_ktls = co_await tls::check_session_uses_ktls(c);
+    BOOST_TEST_MESSAGE(fmt::format("kTLS {}", uses_ktls ? "on" : "off"));
+    if (require_ktls) {
+        BOOST_REQUIRE(uses_ktls);
+    }
+    co_await out.close();
+    co_await in.close();
+}
+
+// The kernel lists the upper layer protocols it has loaded. It may still
+// load the tls one on demand when it isn't listed.
+static bool ktls_available() {
+#ifdef TLS_TX
+    std::ifstream ulps("/proc/sys/net/ipv4/tcp_available_ulp");
+    std::string ulp;
+    while (ulps >> ulp) {
+        if (ulp == "tls") {
+            return true;
+        }
+    }
+#endif
+    return false;
+}
+
+// The data must get through whether the kernel takes the session over or
+// not, and the kernel must take it over when it has the tls module
+SEASTAR_TEST_CASE(test_ktls_client_server) {
+    tls::credentials_builder b;
+    co_await b.set_x509_key_file(certfile("test.crt"), certfile("test.key"), tls::x509_crt_format::PEM);
+    co_await b.set_x509_trust_file(certfile("catest.pem"), tls::x509_crt_format::PEM);
+    b.set_enable_ktls(true);
+
+    ::listen_options opts;
+    opts.reuse_address = true;
+    auto addr = ::make_ipv4_address({0x7f000001, 4712});
+    auto server = tls::listen(b.build_server_credentials(), addr, opts);
+
+    // Several records each way
+    sstring msg(sstring::initialized_later(), 100000);
+    for (size_t i = 0; i < msg.size(); i++) {
+        msg[i] = 'a' + i % 26;
+    }
+    auto [fs, fc] = co_await when_all(tls_echo_server(server, msg.size()), tls_echo_client(b.build_certificate_credentials(), addr, msg, ktls_available()));
+    fs.get();
+    fc.get();
+}
+
+static future<> tls_echo_servers(server_socket& server, size_t count, size_t size) {
+    std::vector<future<>> servers;
+    for (size_t i = 0; i < count; i++) {
+        auto s = co_await server.accept();
+        servers.push_back(tls_echo(std::move(s.connection), size));
+    }
+    co_await when_all_succeed(servers.begin(), servers.end());
+}
+
+// Waits for a handshake the peer never starts
+static future<> tls_fail_handshake(connected_socket s) {
+    auto in = s.input();
+    BOOST_REQUIRE_THROW(co_await in.read(), std::exception);
+}
+
+static uint64_t offloaded_handshake_steps() {
+    const auto& values = seastar::metrics::impl::get_value_map();
+    auto mf = values.find("reactor_io_threaded_fallbacks");
+    if (mf == values.end()) {
+        return 0;
+    }
+    for (const auto& [id, m] : mf->second) {
+        if (id.labels().at("reason") == "tls_handshake") {
+            return m->get_function()().ui();
+        }
+    }
+    return 0;
+}
+
+SEASTAR_TEST_CASE(test_handshake_scheduling_and_offload) {
+    auto steps_before = offloaded_handshake_steps();
+    auto sg = co_await create_scheduling_group("tls_handshake", 100);
+    tls::credentials_builder b;
+    co_await b.set_x509_key_file(certfile("test.crt"), certfile("test.key"), tls::x509_crt_format::PEM);
+    co_await b.set_x509_trust_file(certfile("catest.pem"), tls::x509_crt_format::PEM);
+    b.set_handshake_scheduling_group(sg);
+    b.set_max_concurrent_handshakes(2);
+    b.set_offload_handshakes(true);
+
+    ::listen_options opts;
+    opts.reuse_address = true;
+    auto addr = ::make_ipv4_address({0x7f000001, 4712});
+    auto serv = b.build_server_credentials();
+    auto server = tls::listen(serv, addr, opts);
+    sstring msg = "hello world";
+
+    // Two peers that never say hello hold both handshake slots, so the
+    // third handshake waits until one of them goes away
+    std::vector<connected_socket> silent;
+    std::vector<future<>> silent_servers;
+    for (size_t i = 0; i < 2; i++) {
+        silent.push_back(co_await seastar::connect(addr));
+        auto s = co_await server.accept();
+        silent_servers.push_back(tls_fail_handshake(std::move(s.connection)));
+    }
+    auto third = tls_echo_client(b.build_certificate_credentials(), addr, msg);
+    auto third_server = tls_echo_server(server, msg.size());
+    co_await sleep(std::chrono::milliseconds(100));
+    BOOST_REQUIRE(!third.available());
+    silent[0].shutdown_output();
+    co_await std::move(third);
+    co_await std::move(third_server);
+    silent[1].shutdown_output();
+    co_await when_all_succeed(silent_servers.begin(), silent_servers.end());
+    silent.clear();
+
+    // More clients than handshakes allowed at once
+    constexpr size_t clients = 8;
+    std::vector<future<>> fc;
+    for (size_t i = 0; i < clients; i++) {
+        fc.push_back(tls_echo_client(b.build_certificate_credentials(), addr, msg));
+    }
+    auto fs = tls_echo_servers(server, clients, msg.size());
+    co_await when_all_succeed(fc.begin(), fc.end());
+    co_await std::move(fs);
+    server = {};
+    co_await destroy_scheduling_group(sg);
+
+    // The steps ran in the syscall thread
+    BOOST_REQUIRE_GT(offloaded_handshake_steps(), steps_before);
+}
+
 class https_server {
     const sstring _cert;
     const std::string _addr = "127.0.0.1";
@@ -1742,6 +1903,113 @@ SEASTAR_THREAD_TEST_CASE(test_tls13_session_tickets_retain_session_key) {
     do_test_tls13_session_tickets(true);
 }
 
+// Connects without resume data, exchanges some data, and tells whether
+// the session was resumed from the cache
+static bool session_cache_connect(::shared_ptr<tls::certificate_credentials> creds, server_socket& server, socket_address addr) {
+    auto sa = server.accept();
+    auto c = tls::connect(creds, addr, tls::tls_options{ .server_name = "test.scylladb.org" }).get();
+    auto s = sa.get();
+
+    auto in = s.connection.input();
+    auto cin = c.input();
+    output_stream<char> out(c.output().detach(), 1024);
+    output_stream<char> sout(s.connection.output().detach(), 1024);
+
+    // The client gets TLS 1.3 tickets by reading
+    out.write("nils").get();
+    auto fin = in.read();
+    out.flush().get();
+    fin.get();
+
+    sout.write("banan").get();
+    fin = cin.read();
+    sout.flush().get();
+    fin.get();
+
+    auto resumed = tls::check_session_is_resumed(c).get();
+
+    in.close().get();
+    out.close().get();
+
+    s.connection.shutdown_input();
+    s.connection.shutdown_output();
+
+    c.shutdown_input();
+    c.shutdown_output();
+    return resumed;
+}
+
+static void do_test_session_cache(sstring priority, tls::session_resume_mode mode) {
+    sharded<tls::session_cache> cache;
+    cache.start().get();
+    auto stop_cache = deferred_stop(cache);
+
+    tls::credentials_builder b;
+
+    b.set_x509_key_file(certfile("test.crt"), certfile("test.key"), tls::x509_crt_format::PEM).get();
+    b.set_x509_trust_file(certfile("catest.pem"), tls::x509_crt_format::PEM).get();
+    b.set_session_resume_mode(mode);
+    b.set_priority_string(priority);
+    b.set_session_cache(cache);
+
+    auto creds = b.build_certificate_credentials();
+    auto serv = b.build_server_credentials();
+
+    ::listen_options opts;
+    opts.reuse_address = true;
+    opts.set_fixed_cpu(this_shard_id());
+
+    auto addr = ::make_ipv4_address( {0x7f000001, 4712});
+    auto server = tls::listen(serv, addr, opts);
+
+    BOOST_REQUIRE(!session_cache_connect(creds, server, addr));
+    BOOST_REQUIRE(session_cache_connect(creds, server, addr));
+    BOOST_REQUIRE_GT(cache.local().size(), 0);
+
+    if (smp::count == 1) {
+        return;
+    }
+
+    // The sessions reach the other shards in the background, after which
+    // a reconnect landing on another shard resumes there
+    auto other = (this_shard_id() + 1) % smp::count;
+    auto other_size = [&] {
+        return cache.invoke_on(other, [] (tls::session_cache& c) { return c.size(); }).get();
+    };
+    for (unsigned i = 0; i < 1000 && other_size() < cache.local().size(); i++) {
+        sleep(10ms).get();
+    }
+    BOOST_REQUIRE_EQUAL(other_size(), cache.local().size());
+
+    auto resumed = smp::submit_to(other, [b] {
+        return seastar::async([b] {
+            auto creds = b.build_certificate_credentials();
+            auto serv = b.build_server_credentials();
+
+            ::listen_options opts;
+            opts.reuse_address = true;
+            opts.set_fixed_cpu(this_shard_id());
+
+            auto addr = ::make_ipv4_address( {0x7f000001, 4713});
+            auto server = tls::listen(serv, addr, opts);
+            return session_cache_connect(creds, server, addr);
+        });
+    }).get();
+    BOOST_REQUIRE(resumed);
+}
+
+/**
+ * Test client and server side session caching, with TLS 1.3 session
+ * tickets and TLS 1.2 session IDs.
+*/
+SEASTAR_THREAD_TEST_CASE(test_session_cache_tls13) {
+    do_test_session_cache("SECURE128:+SECURE192:-VERS-TLS-ALL:+VERS-TLS1.3", tls::session_resume_mode::TLS13_SESSION_TICKET);
+}
+
+SEASTAR_THREAD_TEST_CASE(test_session_cache_tls12) {
+    do_test_session_cache("SECURE128:+SECURE192:-VERS-TLS-ALL:+VERS-TLS1.2:%NO_TICKETS", tls::session_resume_mode::NONE);
+}
+
 SEASTAR_THREAD_TEST_CASE(test_tls13_session_tickets_invalidated_by_reload) {
     tls::credentials_builder b;
     tmpdir tmp;
@@ -0,0 +1,94 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2026 ScyllaDB
+ */
+
+// Runs with --io-uring-fixed-io, which registers the files opened for
+// DMA with io_uring when it is the reactor backend, and once more with
+// --io-uring-sqpoll on top, where the shards share a submission polling
+// thread or fall back to submitting themselves
+
+#include <seastar/testing/test_case.hh>
+#include <seastar/testing/thread_test_case.hh>
+
+#include <seastar/core/file.hh>
+#include <seastar/core/loop.hh>
+#include <seastar/core/seastar.hh>
+#include <seastar/core/smp.hh>
+#include <seastar/core/thread.hh>
+#include <seastar/core/temporary_buffer.hh>
+#include <seastar/util/closeable.hh>
+#include <seastar/util/tmp_file.hh>
+
+#include <boost/range/irange.hpp>
+
+using namespace seastar;
+
+namespace {
+
+constexpr size_t block_size = 4096;
+constexpr unsigned nr_blocks = 64;
+
+temporary_buffer<char> make_block(file& f, unsigned file_id, unsigned block) {
+    auto buf = temporary_buffer<char>::aligned(f.memory_dma_alignment(), block_size);
+    std::fill(buf.get_write(), buf.get_write() + buf.size(), char('a' + (file_id * nr_blocks + block) % 26));
+    return buf;
+}
+
+// Files are closed and reopened while the other ones have requests in
+// flight, so the descriptors and the registered slots keep being reused
+void reopen_with_requests_in_flight(std::filesystem::path dir) {
+    constexpr unsigned nr_files = 4;
+    auto name = [&dir] (unsigned id) {
+        return (dir / fmt::format("file{}-{}", this_shard_id(), id)).native();
+    };
+    parallel_for_each(boost::irange(0u, nr_files), [&] (unsigned id) {
+        return seastar::async([&, id] {
+            for (unsigned block = 0; block < nr_blocks; block++) {
+                auto f = open_file_dma(name(id), open_flags::rw | open_flags::create).get();
+                auto close_f = deferred_close(f);
+                auto buf = make_block(f, id, block);
+                auto written = f.dma_write(block * block_size, buf.get(), buf.size()).get();
+                BOOST_REQUIRE_EQUAL(written, block_size);
+            }
+        });
+    }).get();
+
+    for (unsigned id = 0; id < nr_files; id++) {
+        auto f = open_file_dma(name(id), open_flags::ro).get();
+        auto close_f = deferred_close(f);
+        for (unsigned block = 0; block < nr_blocks; block++) {
+            auto buf = f.dma_read_exactly<char>(block * block_size, block_size).get();
+            auto expected = make_block(f, id, block);
+            BOOST_REQUIRE(std::equal(buf.begin(), buf.end(), expected.begin(), expected.end()));
+        }
+    }
+}
+
+}
+
+SEASTAR_THREAD_TEST_CASE(test_reopen_with_requests_in_flight) {
+    tmp_dir::do_with_thread([] (tmp_dir& t) {
+        smp::invoke_on_all([dir = t.get_path()] {
+            return seastar::async([dir] {
+                reopen_with_requests_in_flight(dir);
+            });
+        }).get();
+    }).get();
+}
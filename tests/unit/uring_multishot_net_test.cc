@@ -0,0 +1,221 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2026 ScyllaDB
+ */
+
+// Runs with --io-uring-multishot-net, where the io_uring backend keeps
+// one multishot accept armed per listening socket and one multishot
+// receive, into a per-shard ring of kernel-provided buffers, per
+// connected socket
+
+#include <seastar/testing/test_case.hh>
+#include <seastar/testing/thread_test_case.hh>
+
+#include <seastar/core/internal/uname.hh>
+#include <seastar/core/seastar.hh>
+#include <seastar/core/sleep.hh>
+#include <seastar/core/temporary_buffer.hh>
+#include <seastar/core/thread.hh>
+#include <seastar/net/api.hh>
+
+#include "core/reactor_backend.hh"
+
+#include <set>
+#include <vector>
+
+using namespace seastar;
+using namespace std::chrono_literals;
+
+namespace {
+
+// The backend quietly falls back to plain requests without the kernel
+// support, which the other socket tests already cover
+bool multishot_supported() {
+    return reactor_backend_selector::default_backend().name() == "io_uring"
+            && internal::kernel_uname().whitelisted({"6.0"});
+}
+
+listen_options test_listen_options() {
+    return listen_options{
+        .reuse_address = true,
+        .lba = server_socket::load_balancing_algorithm::fixed,
+        .listen_backlog = 256,
+    };
+}
+
+char pattern(uint64_t offset) {
+    return char(offset % 251);
+}
+
+temporary_buffer<char> make_data(uint64_t offset, size_t size) {
+    temporary_buffer<char> buf(size);
+    for (size_t i = 0; i < size; i++) {
+        buf.get_write()[i] = pattern(offset + i);
+    }
+    return buf;
+}
+
+// Returns the stream offset past the buffer
+uint64_t check_data(const temporary_buffer<char>& buf, uint64_t offset) {
+    bool matches = true;
+    for (size_t i = 0; i < buf.size(); i++) {
+        matches &= buf[i] == pattern(offset + i);
+    }
+    BOOST_REQUIRE(matches);
+    return offset + buf.size();
+}
+
+}
+
+// More connections wait in the backlog than the backend takes ahead of
+// the application, so the accept is cancelled and armed again on the way
+SEASTAR_THREAD_TEST_CASE(test_accept_several) {
+    if (!multishot_supported()) {
+        BOOST_TEST_WARN(0, "Skipping this test because multishot networking needs io_uring on Linux 6.0");
+        return;
+    }
+    constexpr uint32_t nr_connections = 200;
+    auto ss = seastar::listen(socket_address(ipv4_addr("127.0.0.1", 0)), test_listen_options());
+    auto addr = ss.local_address();
+
+    std::vector<connected_socket> clients;
+    std::vector<output_stream<char>> outs;
+    for (uint32_t id = 0; id < nr_connections; id++) {
+        clients.push_back(connect(addr).get());
+        outs.push_back(clients.back().output());
+        outs.back().write(reinterpret_cast<const char*>(&id), sizeof(id)).get();
+        outs.back().flush().get();
+    }
+
+    std::set<uint32_t> ids;
+    for (uint32_t i = 0; i < nr_connections; i++) {
+        auto server = ss.accept().get().connection;
+        auto in = server.input();
+        auto buf = in.read_exactly(sizeof(uint32_t)).get();
+        BOOST_REQUIRE_EQUAL(buf.size(), sizeof(uint32_t));
+        uint32_t id;
+        std::copy_n(buf.get(), sizeof(id), reinterpret_cast<char*>(&id));
+        ids.insert(id);
+        in.close().get();
+    }
+    BOOST_REQUIRE_EQUAL(ids.size(), nr_connections);
+    BOOST_REQUIRE_EQUAL(*ids.rbegin(), nr_connections - 1);
+
+    for (auto& out : outs) {
+        out.close().get();
+    }
+    ss.abort_accept();
+}
+
+// The reader holds on to what it received until the shard's buffer ring
+// runs dry, then lets it go so that the ring fills up again
+SEASTAR_THREAD_TEST_CASE(test_receive_across_buffer_exhaustion) {
+    if (!multishot_supported()) {
+        BOOST_TEST_WARN(0, "Skipping this test because multishot networking needs io_uring on Linux 6.0");
+        return;
+    }
+    // Twice the 1024 16KB buffers of the ring
+    constexpr uint64_t phase = 32 << 20;
+    constexpr size_t chunk = 64 << 10;
+    auto ss = seastar::listen(socket_address(ipv4_addr("127.0.0.1", 0)), test_listen_options());
+    auto client = connect(ss.local_address()).get();
+    auto server = ss.accept().get().connection;
+    auto out = client.output();
+    auto in = server.input();
+
+    auto writer = seastar::async([&out] {
+        for (uint64_t offset = 0; offset < 2 * phase; offset += chunk) {
+            out.write(make_data(offset, chunk)).get();
+        }
+        out.close().get();
+    });
+
+    uint64_t offset = 0;
+    std::vector<temporary_buffer<char>> held;
+    while (offset < phase) {
+        auto buf = in.read().get();
+        BOOST_REQUIRE(!buf.empty());
+        offset = check_data(buf, offset);
+        held.push_back(std::move(buf));
+    }
+    held.clear();
+    while (true) {
+        auto buf = in.read().get();
+        if (buf.empty()) {
+            break;
+        }
+        offset = check_data(buf, offset);
+    }
+    BOOST_REQUIRE_EQUAL(offset, 2 * phase);
+
+    writer.get();
+    in.close().get();
+    ss.abort_accept();
+}
+
+// The sockets go away while their accept and receive are armed, with
+// received data still queued. The requests are cancelled, and the ring
+// buffers that data was in are returned.
+SEASTAR_THREAD_TEST_CASE(test_close_with_requests_armed) {
+    if (!multishot_supported()) {
+        BOOST_TEST_WARN(0, "Skipping this test because multishot networking needs io_uring on Linux 6.0");
+        return;
+    }
+    constexpr size_t size = 64 << 10;
+    socket_address addr;
+    {
+        auto ss = seastar::listen(socket_address(ipv4_addr("127.0.0.1", 0)), test_listen_options());
+        addr = ss.local_address();
+        auto client = connect(addr).get();
+        auto server = ss.accept().get().connection;
+        auto out = client.output();
+        auto in = server.input();
+        out.write(make_data(0, size)).get();
+        out.flush().get();
+        auto buf = in.read_exactly(1).get();
+        check_data(buf, 0);
+        out.write(make_data(size, size)).get();
+        out.flush().get();
+        // Let the rest be received and queued
+        sleep(10ms).get();
+        out.close().get();
+    }
+    // The final completions of the cancelled requests
+    sleep(10ms).get();
+
+    // The same address is taken again and the ring still has buffers
+    auto ss = seastar::listen(addr, test_listen_options());
+    auto client = connect(addr).get();
+    auto server = ss.accept().get().connection;
+    auto out = client.output();
+    auto in = server.input();
+    out.write(make_data(0, size)).get();
+    out.close().get();
+    uint64_t offset = 0;
+    while (true) {
+        auto buf = in.read().get();
+        if (buf.empty()) {
+            break;
+        }
+        offset = check_data(buf, offset);
+    }
+    BOOST_REQUIRE_EQUAL(offset, size);
+    in.close().get();
+    ss.abort_accept();
+}
@@ -0,0 +1,131 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2026 ScyllaDB
+ */
+
+// Runs with --io-uring-zerocopy-send-threshold, where the io_uring
+// backend sends the packets at least that large without copying them
+
+#include <seastar/testing/test_case.hh>
+#include <seastar/testing/thread_test_case.hh>
+
+#include <seastar/core/seastar.hh>
+#include <seastar/core/temporary_buffer.hh>
+#include <seastar/core/thread.hh>
+#include <seastar/net/api.hh>
+#include <seastar/util/defer.hh>
+
+#include "core/reactor_backend.hh"
+
+#ifdef SEASTAR_HAVE_URING
+#include <liburing.h>
+#endif
+
+#include <span>
+#include <vector>
+
+using namespace seastar;
+
+namespace {
+
+// The backend sends with a copy when the kernel can't do without, which
+// the other socket tests already cover
+bool zerocopy_send_supported() {
+#ifdef SEASTAR_HAVE_URING
+    if (reactor_backend_selector::default_backend().name() != "io_uring") {
+        return false;
+    }
+    auto probe = ::io_uring_get_probe();
+    if (!probe) {
+        return false;
+    }
+    auto free_probe = defer([probe] () noexcept { ::io_uring_free_probe(probe); });
+    return ::io_uring_opcode_supported(probe, IORING_OP_SENDMSG_ZC);
+#else
+    return false;
+#endif
+}
+
+char pattern(uint64_t offset) {
+    return char(offset % 251);
+}
+
+temporary_buffer<char> make_data(uint64_t offset, size_t size) {
+    temporary_buffer<char> buf(size);
+    for (size_t i = 0; i < size; i++) {
+        buf.get_write()[i] = pattern(offset + i);
+    }
+    return buf;
+}
+
+}
+
+// Each packet is well over the threshold and made of several fragments.
+// The sender lets go of them as soon as the send completes, the data must
+// still be intact when the kernel gets to it.
+SEASTAR_THREAD_TEST_CASE(test_large_packets) {
+    if (!zerocopy_send_supported()) {
+        BOOST_TEST_WARN(0, "Skipping this test because io_uring can't send without copying on this system");
+        return;
+    }
+    constexpr unsigned nr_packets = 64;
+    constexpr unsigned nr_fragments = 8;
+    constexpr size_t fragment_size = 128 << 10;
+    constexpr uint64_t total = uint64_t(nr_packets) * nr_fragments * fragment_size;
+    auto ss = seastar::listen(socket_address(ipv4_addr("127.0.0.1", 0)), listen_options{
+        .reuse_address = true,
+        .lba = server_socket::load_balancing_algorithm::fixed,
+    });
+    auto client = connect(ss.local_address()).get();
+    auto server = ss.accept().get().connection;
+    auto out = client.output();
+    auto in = server.input();
+
+    auto writer = seastar::async([&out] {
+        uint64_t offset = 0;
+        for (unsigned i = 0; i < nr_packets; i++) {
+            std::vector<temporary_buffer<char>> bufs;
+            for (unsigned j = 0; j < nr_fragments; j++) {
+                bufs.push_back(make_data(offset, fragment_size));
+                offset += fragment_size;
+            }
+            out.write(std::span(bufs)).get();
+        }
+        out.close().get();
+    });
+
+    uint64_t offset = 0;
+    while (true) {
+        auto buf = in.read().get();
+        if (buf.empty()) {
+            break;
+        }
+        bool matches = true;
+        for (size_t i = 0; i < buf.size(); i++) {
+            matches &= buf[i] == pattern(offset + i);
+        }
+        BOOST_REQUIRE(matches);
+        offset += buf.size();
+    }
+    BOOST_REQUIRE_EQUAL(offset, total);
+
+    writer.get();
+    in.close().get();
+    ss.abort_accept();
+}